@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Raw RFAL analog configuration table as exchanged by rfalAnalogConfigListReadRaw/WriteRaw: a
+// sequence of entries {ModeID u16 (big-endian), num u8, num x {addr[2], mask, val}}. Helpers to walk
+// it and to merge an override table into the device's table in place. Arduino-independent so host
+// tools and simulators share it.
+namespace AnalogConfig
+{
+    constexpr size_t HeaderSize = 3;
+    constexpr size_t RegSetSize = 4;
+    constexpr size_t MaxTableLen = 1024; // host-side buffer; RFAL allows up to 1024 register sets
+
+    struct Entry
+    {
+        uint16_t id;
+        uint8_t num;
+        const uint8_t* regs; // num x {addr[2], mask, val}
+
+        size_t size() const { return HeaderSize + num * RegSetSize; }
+    };
+
+    class Iterator
+    {
+    public:
+        Iterator(const uint8_t* tbl, size_t len) : _tbl(tbl), _len(len) {}
+
+        // Returns false at the end of the table or on a truncated entry (check malformed()).
+        bool next(Entry& out)
+        {
+            if (_ofs >= _len)
+                return false;
+            if (_len - _ofs < HeaderSize)
+            {
+                _malformed = true;
+                return false;
+            }
+            out.id = static_cast<uint16_t>((_tbl[_ofs] << 8) | _tbl[_ofs + 1]);
+            out.num = _tbl[_ofs + 2];
+            out.regs = _tbl + _ofs + HeaderSize;
+            if (_len - _ofs < out.size())
+            {
+                _malformed = true;
+                return false;
+            }
+            _ofs += out.size();
+            return true;
+        }
+
+        size_t offset() const { return _ofs; }
+        bool malformed() const { return _malformed; }
+
+    private:
+        const uint8_t* _tbl;
+        size_t _len;
+        size_t _ofs = 0;
+        bool _malformed = false;
+    };
+
+    inline bool valid(const uint8_t* tbl, size_t len)
+    {
+        Iterator it(tbl, len);
+        Entry e;
+        while (it.next(e))
+        {
+        }
+        return !it.malformed();
+    }
+
+    // FNV-1a over the raw bytes; identifies an override table in the persisted cache.
+    inline uint32_t fingerprint(const uint8_t* tbl, size_t len)
+    {
+        uint32_t h = 2166136261UL;
+        for (size_t i = 0; i < len; ++i)
+        {
+            h ^= tbl[i];
+            h *= 16777619UL;
+        }
+        return h;
+    }
+
+    // Replaces (or appends) every entry of overrides in the table at tbl, in place. Entries that
+    // are already identical are left alone and not counted. Returns the number of entries that
+    // changed, or -1 if the result would not fit in cap or either table is malformed.
+    inline int merge(uint8_t* tbl, size_t& len, size_t cap, const uint8_t* overrides, size_t overridesLen)
+    {
+        if (!valid(tbl, len))
+            return -1;
+
+        int changed = 0;
+        Iterator src(overrides, overridesLen);
+        Entry want;
+        while (src.next(want))
+        {
+            Iterator dst(tbl, len);
+            Entry have;
+            size_t at = len;
+            size_t haveSize = 0;
+            while (dst.next(have))
+            {
+                if (have.id == want.id)
+                {
+                    at = dst.offset() - have.size();
+                    haveSize = have.size();
+                    break;
+                }
+            }
+
+            if (haveSize == want.size() && memcmp(tbl + at, want.regs - HeaderSize, haveSize) == 0)
+                continue;
+            if (len - haveSize + want.size() > cap)
+                return -1;
+
+            // Resize the slot, then copy the override over it.
+            memmove(tbl + at + want.size(), tbl + at + haveSize, len - at - haveSize);
+            len = len - haveSize + want.size();
+            memcpy(tbl + at, want.regs - HeaderSize, want.size());
+            changed++;
+        }
+        return src.malformed() ? -1 : changed;
+    }
+
+    // Last table this host wrote, persisted per reader in the KVStore as a raw blob. hashRam is the
+    // device's SysGetConfigHashes RAM hash right after the write: while the device still reports it
+    // and the overrides are unchanged, there is nothing to read or write.
+    struct Cache
+    {
+        static constexpr uint16_t Magic = 0x4143; // "AC"
+        static constexpr uint8_t Version = 1;
+
+        uint16_t magic = 0; // Magic once a write was confirmed
+        uint8_t version = Version;
+        uint8_t reserved = 0;
+        uint32_t overridesFingerprint = 0;
+        uint32_t hashRam = 0;
+
+        bool valid() const
+        {
+            return magic == Magic && version == Version;
+        }
+    };
+}
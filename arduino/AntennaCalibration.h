@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Result of St25r200Reader::calibrateAntenna(), persisted per reader in the KVStore as a raw blob.
+// Bump Version when the layout changes; stale blobs are then ignored and the reader keeps the
+// RFO from its analog configuration until it is calibrated again.
+struct AntennaCalibration
+{
+    static constexpr uint16_t Magic = 0x5243; // "RC"
+    static constexpr uint8_t Version = 1;
+
+    uint16_t magic = 0; // Magic once filled in by a calibration
+    uint8_t version = Version;
+    uint8_t rfo = 0;         // chosen RFO driver resistance (higher = weaker field)
+    uint8_t successPct = 0;  // reference tag read rate at rfo
+    uint8_t amplitude = 0;   // rfalChipMeasureAmplitude at rfo, for drift checks at startup
+    uint8_t phase = 0;       // rfalChipMeasurePhase at rfo
+    uint8_t reserved = 0;
+    uint16_t regulators = 0; // rfalAdjustRegulators result
+    uint32_t meanRttUs = 0;  // mean reference tag presence check round trip at rfo
+
+    bool valid() const
+    {
+        return magic == Magic && version == Version;
+    }
+};
@@ -0,0 +1,107 @@
+#include "CaptureRecorder.h"
+
+void CaptureRecorder::attach(HardwareSerial* inner, Print* out)
+{
+    _inner = inner;
+    _out = out;
+    _lastUs = micros();
+    _rxLen = 0;
+}
+
+void CaptureRecorder::noteEvent(const char* kind, const String& uid)
+{
+    flushRx();
+    _out->print("E ");
+    _out->print(kind);
+    _out->print(" ");
+    _out->println(uid);
+}
+
+void CaptureRecorder::begin(unsigned long baudRate)
+{
+    _inner->begin(baudRate);
+}
+
+void CaptureRecorder::begin(unsigned long baudRate, uint16_t config)
+{
+    _inner->begin(baudRate, config);
+}
+
+void CaptureRecorder::end()
+{
+    flushRx();
+    _inner->end();
+}
+
+int CaptureRecorder::available()
+{
+    return _inner->available();
+}
+
+int CaptureRecorder::peek()
+{
+    return _inner->peek();
+}
+
+int CaptureRecorder::read()
+{
+    int b = _inner->read();
+    if (b < 0)
+        return b;
+
+    if (_rxLen == 0)
+        _rxStartUs = micros();
+    _rx[_rxLen++] = static_cast<uint8_t>(b);
+    if (_rxLen == sizeof(_rx))
+        flushRx();
+    return b;
+}
+
+void CaptureRecorder::flush()
+{
+    _inner->flush();
+}
+
+size_t CaptureRecorder::write(uint8_t b)
+{
+    return write(&b, 1);
+}
+
+size_t CaptureRecorder::write(const uint8_t* buffer, size_t size)
+{
+    flushRx();
+    unsigned long now = micros();
+    writeRecord('T', now - _lastUs, buffer, size);
+    _lastUs = now;
+    return _inner->write(buffer, size);
+}
+
+CaptureRecorder::operator bool()
+{
+    return _inner && static_cast<bool>(*_inner);
+}
+
+void CaptureRecorder::flushRx()
+{
+    if (_rxLen == 0)
+        return;
+
+    writeRecord('R', _rxStartUs - _lastUs, _rx, _rxLen);
+    _lastUs = _rxStartUs;
+    _rxLen = 0;
+}
+
+void CaptureRecorder::writeRecord(char type, unsigned long deltaUs, const uint8_t* bytes, size_t len)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    _out->print(type);
+    _out->print(" ");
+    _out->print(deltaUs);
+    _out->print(" ");
+    for (size_t i = 0; i < len; ++i)
+    {
+        _out->print(hex[(bytes[i] >> 4) & 0x0F]);
+        _out->print(hex[bytes[i] & 0x0F]);
+    }
+    _out->println();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Serial tap that records every TX/RX frame (and presence events) as text lines.
+// Capture format, one record per line:
+//   T <deltaUs> <hex>        host -> device bytes
+//   R <deltaUs> <hex>        device -> host bytes
+//   E <placed|removed> <uid> presence event published by the reader
+// deltaUs is the time since the previous T/R record; captures replay with ReplaySerial.
+class CaptureRecorder : public HardwareSerial
+{
+public:
+    CaptureRecorder() = default;
+
+    void attach(HardwareSerial* inner, Print* out);
+    void noteEvent(const char* kind, const String& uid);
+
+    void begin(unsigned long baudRate) override;
+    void begin(unsigned long baudRate, uint16_t config) override;
+    void end() override;
+    int available() override;
+    int peek() override;
+    int read() override;
+    void flush() override;
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    operator bool() override;
+
+private:
+    void flushRx();
+    void writeRecord(char type, unsigned long deltaUs, const uint8_t* bytes, size_t len);
+
+    HardwareSerial* _inner = nullptr;
+    Print* _out = nullptr;
+    unsigned long _lastUs = 0;
+    unsigned long _rxStartUs = 0;
+    uint8_t _rx[64] = {0};
+    size_t _rxLen = 0;
+};
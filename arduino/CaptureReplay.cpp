@@ -0,0 +1,300 @@
+#include "CaptureReplay.h"
+
+namespace
+{
+    int hexNibble(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    void skipSpaces(const char*& p)
+    {
+        while (*p == ' ' || *p == '\t')
+            ++p;
+    }
+
+    void skipLine(const char*& p)
+    {
+        while (*p && *p != '\n')
+            ++p;
+        if (*p == '\n')
+            ++p;
+    }
+}
+
+ReplaySerial::ReplaySerial(const char* capture, ReplayMode mode)
+    : _cursor(capture)
+    , _mode(mode)
+{
+    advance();
+}
+
+bool ReplaySerial::finished() const
+{
+    return _type == 0;
+}
+
+bool ReplaySerial::matchEvent(const char* kind, const String& uid)
+{
+    bool placed = strcmp(kind, "placed") == 0;
+    if (_eventCount > 0)
+    {
+        const ExpectedEvent& e = _events[_eventHead];
+        if (e.placed == placed && e.uid == uid)
+        {
+            _eventHead = (_eventHead + 1) % 32;
+            _eventCount--;
+            _eventsMatched++;
+            return true;
+        }
+    }
+    _eventsUnexpected++;
+    return false;
+}
+
+void ReplaySerial::finish(ReplayReport& report) const
+{
+    report.txFrames = _txFrames;
+    report.txMismatches = _txMismatches;
+    report.txUnexpected = _txUnexpected;
+    report.rxBytes = _rxBytes;
+    report.eventsExpected = _eventsExpected;
+    report.eventsMatched = _eventsMatched;
+    report.eventsUnexpected = _eventsUnexpected;
+    report.eventsMissing = static_cast<uint32_t>(_eventCount);
+}
+
+void ReplaySerial::begin(unsigned long)
+{
+}
+
+void ReplaySerial::begin(unsigned long, uint16_t)
+{
+}
+
+void ReplaySerial::end()
+{
+}
+
+int ReplaySerial::available()
+{
+    return rxReady() ? static_cast<int>(_len - _pos) : 0;
+}
+
+int ReplaySerial::peek()
+{
+    return rxReady() ? _data[_pos] : -1;
+}
+
+int ReplaySerial::read()
+{
+    if (!rxReady())
+        return -1;
+
+    if (_pos == 0)
+        _clockUs += _deltaUs;
+    uint8_t b = _data[_pos++];
+    _rxBytes++;
+    if (_pos == _len)
+        advance();
+    return b;
+}
+
+void ReplaySerial::flush()
+{
+}
+
+size_t ReplaySerial::write(uint8_t b)
+{
+    return write(&b, 1);
+}
+
+size_t ReplaySerial::write(const uint8_t* buffer, size_t size)
+{
+    _txFrames++;
+    if (_type != 'T')
+    {
+        // The reader sent more than the trace holds (or wrote while a reply was pending).
+        _txUnexpected++;
+        return size;
+    }
+
+    if (size != _len || memcmp(buffer, _data, size) != 0)
+        _txMismatches++;
+    _clockUs += _deltaUs;
+
+    advance();
+    return size;
+}
+
+ReplaySerial::operator bool()
+{
+    return true;
+}
+
+void ReplaySerial::advance()
+{
+    _type = 0;
+    _len = 0;
+    _pos = 0;
+
+    while (*_cursor)
+    {
+        if (parseRecord(_cursor))
+            break;
+    }
+
+    if (_type == 'R')
+        _readyAtUs = micros() + (_mode == ReplayMode::Timed ? _deltaUs : 0);
+}
+
+bool ReplaySerial::parseRecord(const char*& p)
+{
+    skipSpaces(p);
+    char type = *p;
+
+    if (type == 'E')
+    {
+        ++p;
+        skipSpaces(p);
+        bool placed = strncmp(p, "placed", 6) == 0;
+        while (*p && *p != ' ' && *p != '\n')
+            ++p;
+        skipSpaces(p);
+        const char* uidStart = p;
+        while (*p && *p != '\n' && *p != '\r' && *p != ' ')
+            ++p;
+
+        String uid;
+        for (const char* c = uidStart; c < p; ++c)
+            uid += *c;
+        skipLine(p);
+
+        if (_eventCount < 32)
+        {
+            ExpectedEvent& e = _events[(_eventHead + _eventCount) % 32];
+            e.placed = placed;
+            e.uid = uid;
+            _eventCount++;
+            _eventsExpected++;
+        }
+        return false;
+    }
+
+    if (type != 'T' && type != 'R')
+    {
+        skipLine(p);
+        return false;
+    }
+
+    ++p;
+    skipSpaces(p);
+    unsigned long delta = strtoul(p, const_cast<char**>(&p), 10);
+    skipSpaces(p);
+
+    size_t len = 0;
+    while (len < sizeof(_data))
+    {
+        int hi = hexNibble(p[0]);
+        int lo = hi >= 0 ? hexNibble(p[1]) : -1;
+        if (lo < 0)
+            break;
+        _data[len++] = static_cast<uint8_t>((hi << 4) | lo);
+        p += 2;
+    }
+    skipLine(p);
+
+    if (len == 0)
+        return false;
+
+    _type = type;
+    _deltaUs = delta;
+    _len = len;
+    return true;
+}
+
+bool ReplaySerial::rxReady() const
+{
+    if (_type != 'R' || _pos >= _len)
+        return false;
+    return static_cast<long>(micros() - _readyAtUs) >= 0;
+}
+
+ReplayNotifier::ReplayNotifier(ReplaySerial& serial)
+    : RestNotifier(RestConfig())
+    , _serial(serial)
+{
+}
+
+void ReplayNotifier::postPlaced(const String& uid, Stream& logStream, uint8_t logLevel)
+{
+    if (!_serial.matchEvent("placed", uid) && logLevel >= 1)
+    {
+        logStream.print("Replay: unexpected placed ");
+        logStream.println(uid);
+    }
+}
+
+void ReplayNotifier::postRemoved(const String& uid, Stream& logStream, uint8_t logLevel)
+{
+    if (!_serial.matchEvent("removed", uid) && logLevel >= 1)
+    {
+        logStream.print("Replay: unexpected removed ");
+        logStream.println(uid);
+    }
+}
+
+ReplayReport runCaptureReplay(const char* capture, ReplayMode mode, St25r200Reader::Options options,
+                              Stream& logStream)
+{
+    ReplaySerial serial(capture, mode);
+    ReplayNotifier notifier(serial);
+
+    options.serial = &serial;
+    options.nowMs = &ReplaySerial::nowMs;
+    options.nowMsContext = &serial;
+    options.loopDelayMs = 0;
+    options.captureOut = nullptr;
+
+    St25r200Reader reader(options, notifier, logStream);
+    ReplayReport report;
+
+    unsigned long start = micros();
+    reader.begin();
+    reader.startDiscovery();
+    while (!serial.finished())
+    {
+        reader.runCycle();
+        report.cycles++;
+    }
+    report.elapsedUs = micros() - start;
+    serial.finish(report);
+
+    logStream.print("Replay ");
+    logStream.print(report.passed() ? "PASS" : "FAIL");
+    logStream.print(" cycles=");
+    logStream.print(report.cycles);
+    logStream.print(" elapsedUs=");
+    logStream.print(report.elapsedUs);
+    logStream.print(" tx=");
+    logStream.print(report.txFrames);
+    logStream.print(" txMismatch=");
+    logStream.print(report.txMismatches);
+    logStream.print(" txUnexpected=");
+    logStream.print(report.txUnexpected);
+    logStream.print(" rxBytes=");
+    logStream.print(report.rxBytes);
+    logStream.print(" events=");
+    logStream.print(report.eventsMatched);
+    logStream.print("/");
+    logStream.print(report.eventsExpected);
+    logStream.print(" unexpected=");
+    logStream.print(report.eventsUnexpected);
+    logStream.print(" missing=");
+    logStream.println(report.eventsMissing);
+
+    return report;
+}
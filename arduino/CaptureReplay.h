@@ -0,0 +1,111 @@
+#pragma once
+
+#include <Arduino.h>
+#include "RestNotifier.h"
+#include "St25r200Reader.h"
+
+// Deterministic replay of a CaptureRecorder trace through St25r200Reader.
+// The capture text is served by ReplaySerial; presence events are checked by ReplayNotifier.
+enum class ReplayMode : uint8_t
+{
+    Timed,          // RX records become readable after their recorded delay
+    AsFastAsPossible,
+};
+
+struct ReplayReport
+{
+    uint32_t cycles = 0;
+    uint32_t txFrames = 0;
+    uint32_t txMismatches = 0;
+    uint32_t txUnexpected = 0;
+    uint32_t rxBytes = 0;
+    uint32_t eventsExpected = 0;
+    uint32_t eventsMatched = 0;
+    uint32_t eventsUnexpected = 0;
+    uint32_t eventsMissing = 0;
+    unsigned long elapsedUs = 0;
+
+    bool passed() const
+    {
+        return eventsUnexpected == 0 && eventsMissing == 0;
+    }
+};
+
+class ReplaySerial : public HardwareSerial
+{
+public:
+    ReplaySerial(const char* capture, ReplayMode mode);
+
+    bool finished() const;
+    bool matchEvent(const char* kind, const String& uid);
+    void finish(ReplayReport& report) const;
+
+    // Capture time: the sum of the deltas of the records consumed so far. Passed to the reader as
+    // Options::nowMs, so absence and wake-up timeouts fire as recorded in either mode.
+    unsigned long clockMs() const { return static_cast<unsigned long>(_clockUs / 1000); }
+    static unsigned long nowMs(void* serial) { return static_cast<ReplaySerial*>(serial)->clockMs(); }
+
+    void begin(unsigned long baudRate) override;
+    void begin(unsigned long baudRate, uint16_t config) override;
+    void end() override;
+    int available() override;
+    int peek() override;
+    int read() override;
+    void flush() override;
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    operator bool() override;
+
+private:
+    struct ExpectedEvent
+    {
+        bool placed;
+        String uid;
+    };
+
+    void advance();
+    bool parseRecord(const char*& p);
+    bool rxReady() const;
+
+    const char* _cursor;
+    ReplayMode _mode;
+
+    char _type = 0;
+    unsigned long _deltaUs = 0;
+    uint8_t _data[520] = {0};
+    size_t _len = 0;
+    size_t _pos = 0;
+    unsigned long _readyAtUs = 0;
+    uint64_t _clockUs = 0;
+
+    ExpectedEvent _events[32];
+    size_t _eventHead = 0;
+    size_t _eventCount = 0;
+
+    uint32_t _txFrames = 0;
+    uint32_t _txMismatches = 0;
+    uint32_t _txUnexpected = 0;
+    uint32_t _rxBytes = 0;
+    uint32_t _eventsExpected = 0;
+    uint32_t _eventsMatched = 0;
+    uint32_t _eventsUnexpected = 0;
+};
+
+class ReplayNotifier : public RestNotifier
+{
+public:
+    explicit ReplayNotifier(ReplaySerial& serial);
+
+    void postPlaced(const String& uid, Stream& logStream, uint8_t logLevel) override;
+    void postRemoved(const String& uid, Stream& logStream, uint8_t logLevel) override;
+
+private:
+    ReplaySerial& _serial;
+};
+
+// Runs the reader against a capture until it is exhausted and prints a summary to logStream.
+// options.serial and options.nowMs are replaced by the replay serial and its clock; loopDelayMs is
+// forced to 0.
+ReplayReport runCaptureReplay(const char* capture, ReplayMode mode, St25r200Reader::Options options,
+                              Stream& logStream);
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "RfalEnums.h"
+
+// Picks techs2Find for each rfalNfcDiscover run from the recent hit rate of every technology.
+// Each technology keeps an exponentially decaying score (+32 per run that found it, -1/8 per run
+// that polled it): technologies with a recent hit are polled every run, the rest only every
+// rareEvery-th run so an arriving tag of a quiet technology is still found. Single-threaded; owned
+// by the reader thread.
+class DiscoveryScheduler
+{
+public:
+    static constexpr size_t TechCount = 5;
+    static constexpr uint8_t HitBoost = 32;
+    static constexpr uint8_t ActiveScore = 8;  // at or above: polled every run
+    static constexpr uint8_t InitialScore = 32; // a fresh reader polls everything for ~11 runs
+
+    DiscoveryScheduler()
+    {
+        for (size_t i = 0; i < TechCount; ++i)
+        {
+            _score[i] = InitialScore;
+            _skipped[i] = 0;
+        }
+    }
+
+    static uint16_t techBit(size_t i)
+    {
+        static const Rfal::NfcPollTech kTechs[TechCount] = {
+            Rfal::NfcPollTech::A, Rfal::NfcPollTech::B, Rfal::NfcPollTech::F, Rfal::NfcPollTech::V,
+            Rfal::NfcPollTech::St25tb,
+        };
+        return static_cast<uint16_t>(kTechs[i]);
+    }
+
+    static const char* techName(size_t i)
+    {
+        static const char* const kNames[TechCount] = {"A", "B", "F", "V", "TB"};
+        return kNames[i];
+    }
+
+    // Approximate RF time of one detection attempt: guard time after the field/tech switch plus
+    // the request/response exchange at the default bit rate.
+    static uint32_t pollCostUs(size_t i)
+    {
+        static const uint32_t kCostUs[TechCount] = {
+            5100,  // NFC-A: GT 5 ms + REQA/ATQA
+            5300,  // NFC-B: GT 5 ms + REQB/ATQB
+            22400, // NFC-F: GT 20 ms + SENSF_REQ with response slots
+            9000,  // NFC-V: GT 5 ms + 1-slot INVENTORY at 26 kbit/s
+            5500,  // ST25TB: GT 5 ms + INITIATE
+        };
+        return kCostUs[i];
+    }
+
+    // Technologies to poll in the next run; rareEvery = 0 polls all of enabled every run.
+    // Never empty while enabled has a technology: falls back to the longest-skipped one.
+    uint16_t next(uint16_t enabled, uint8_t rareEvery) const
+    {
+        if (rareEvery == 0)
+            return enabled;
+
+        uint16_t mask = 0;
+        size_t overdue = TechCount;
+        for (size_t i = 0; i < TechCount; ++i)
+        {
+            if ((enabled & techBit(i)) == 0)
+                continue;
+            if (_score[i] >= ActiveScore || _skipped[i] + 1 >= rareEvery)
+                mask |= techBit(i);
+            if (overdue == TechCount || _skipped[i] > _skipped[overdue])
+                overdue = i;
+        }
+        if (mask == 0 && overdue < TechCount)
+            mask = techBit(overdue);
+        return mask;
+    }
+
+    // Records a finished run: polled is the mask it used, hits the technologies it found.
+    void complete(uint16_t polled, uint16_t hits)
+    {
+        for (size_t i = 0; i < TechCount; ++i)
+        {
+            if ((polled & techBit(i)) == 0)
+            {
+                if (_skipped[i] < 0xFF)
+                    _skipped[i]++;
+                continue;
+            }
+
+            _skipped[i] = 0;
+            uint16_t score = static_cast<uint16_t>(_score[i] - _score[i] / 8);
+            if (hits & techBit(i))
+                score += HitBoost;
+            _score[i] = static_cast<uint8_t>(score > 0xFF ? 0xFF : score);
+        }
+    }
+
+    uint8_t score(size_t i) const
+    {
+        return _score[i];
+    }
+
+private:
+    uint8_t _score[TechCount];
+    uint8_t _skipped[TechCount];
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// rfalDpoEntry: RFO driver resistance plus the reference-measurement thresholds that move the DPO
+// index. Entry 0 is the strongest output; at index k the firmware steps to k+1 (weaker) when the
+// amplitude drops below dec (a close tag loading the antenna) and back to k-1 (stronger) when it
+// rises above inc. Entry 0 has inc = 255 and the last entry dec = 0, as in RFAL's default table.
+struct DpoEntry
+{
+    uint8_t rfoRes;
+    uint8_t inc;
+    uint8_t dec;
+};
+
+// Learns a DPO table from live samples. Each sample is taken while a tag is being confirmed: the
+// antenna amplitude is measured at level k-1, the presence check runs at level k, and the amplitude
+// at level k is measured too. Level k is usable below the level k-1 amplitude up to which its read
+// rate reaches the target; that amplitude becomes dec[k-1], and the highest level k amplitude seen
+// in that range (plus hysteresis) becomes inc[k]. Single-threaded; owned by the reader thread.
+class DpoTuner
+{
+public:
+    static constexpr size_t MaxEntries = 4; // RFAL_DPO_TABLE_MAX_ENTRIES
+    static constexpr size_t Buckets = 16;   // amplitude / 16
+    static constexpr uint8_t MinBucketSamples = 4;
+
+    void begin(uint8_t baseRfo, uint8_t rfoStep, uint8_t levels)
+    {
+        _levels = levels < 2 ? 2 : (levels > MaxEntries ? MaxEntries : levels);
+        for (size_t k = 0; k < MaxEntries; ++k)
+        {
+            unsigned rfo = baseRfo + k * rfoStep;
+            _rfo[k] = static_cast<uint8_t>(rfo > 0xFF ? 0xFF : rfo);
+            for (size_t b = 0; b < Buckets; ++b)
+                _stats[k][b] = {0, 0, 0};
+        }
+        _samples = 0;
+    }
+
+    uint8_t levels() const { return _levels; }
+    uint8_t rfo(size_t k) const { return _rfo[k]; }
+    uint16_t samples() const { return _samples; }
+
+    // Level to probe with the next sample, round-robin over 1..levels-1.
+    uint8_t nextLevel() const
+    {
+        return static_cast<uint8_t>(1 + _samples % (_levels - 1));
+    }
+
+    void record(uint8_t level, uint8_t ampAbove, uint8_t ampAt, bool ok)
+    {
+        if (level == 0 || level >= _levels)
+            return;
+        Stats& s = _stats[level][ampAbove / (256 / Buckets)];
+        if (s.attempts < 0xFFFF)
+            s.attempts++;
+        if (ok)
+        {
+            if (s.successes < 0xFFFF)
+                s.successes++;
+            if (ampAt > s.maxAmpAt)
+                s.maxAmpAt = ampAt;
+        }
+        if (_samples < 0xFFFF)
+            _samples++;
+    }
+
+    // Builds the table; returns its entry count (1 = only the base level is usable).
+    uint8_t compute(uint8_t targetPct, uint8_t hysteresis, DpoEntry* out) const
+    {
+        out[0] = {_rfo[0], 0xFF, 0x00};
+        uint8_t count = 1;
+        for (uint8_t k = 1; k < _levels; ++k)
+        {
+            // Walk up from the lowest amplitude bucket while level k keeps the target rate.
+            int highest = -1;
+            uint8_t maxAmpAt = 0;
+            for (size_t b = 0; b < Buckets; ++b)
+            {
+                const Stats& s = _stats[k][b];
+                if (s.attempts < MinBucketSamples)
+                    continue; // too little evidence either way
+                if (s.successes * 100U < s.attempts * targetPct)
+                    break;
+                highest = static_cast<int>(b);
+                if (s.maxAmpAt > maxAmpAt)
+                    maxAmpAt = s.maxAmpAt;
+            }
+            if (highest < 0)
+                break;
+
+            unsigned dec = (highest + 1) * (256 / Buckets) - 1;
+            unsigned inc = maxAmpAt + hysteresis;
+            out[k - 1].dec = static_cast<uint8_t>(dec);
+            out[k] = {_rfo[k], static_cast<uint8_t>(inc > 0xFF ? 0xFF : inc), 0x00};
+            count = k + 1;
+        }
+        return count;
+    }
+
+private:
+    struct Stats
+    {
+        uint16_t attempts;
+        uint16_t successes;
+        uint8_t maxAmpAt; // highest level-k amplitude among successful reads
+    };
+
+    uint8_t _rfo[MaxEntries] = {};
+    Stats _stats[MaxEntries][Buckets] = {};
+    uint8_t _levels = 2;
+    uint16_t _samples = 0;
+};
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Wire layout of serFlatRfalNfcDevice (one entry of the rfalNfcGetDevicesFound response) and a
+// zero-copy, bounds-checked view over it. Arduino-independent so host tools and simulators share it.
+//
+// The record is the flattened rfalNfcDevice: every technology block is always present and only
+// the one matching devType is meaningful. Multi-byte integers are big-endian. The NFC-A nfcId1
+// field is the only variable-length one; every field after it moves by nfcId1Len.
+namespace FlatNfcDevice
+{
+    enum class Field : uint8_t
+    {
+        DevType,          // u32 Rfal::NfcDevType
+        NfcaType,         // u32 rfalNfcaListenDeviceType
+        NfcaSensRes,      // 2 bytes (anticollision info, platform info)
+        NfcaSelRes,       // 1
+        NfcaNfcId1Len,    // 1
+        NfcaNfcId1,       // nfcId1Len bytes (4, 7 or 10)
+        NfcaIsSleep,      // 1
+        NfcbSensbResLen,  // 1
+        NfcbSensbRes,     // 13: cmd, nfcid0[4], appData[4], protInfo[4]
+        NfcbIsSleep,      // 1
+        NfcfSensfResLen,  // 1
+        NfcfSensfRes,     // 19: cmd, NFCID2[8], PAD0[2], PAD1[3], MRTIcheck, MRTIupdate, PAD2, RD[2]
+        NfcvResFlag,      // 1
+        NfcvDsfid,        // 1
+        NfcvUid,          // 8, LSB first as sent over the air
+        NfcvCrc,          // 2
+        NfcvIsSleep,      // 1
+        St25tbChipId,     // 1
+        St25tbUid,        // 8
+        St25tbIsDeselected, // 1
+        Count,
+    };
+
+    struct FieldSpec
+    {
+        Field field;
+        uint8_t size; // 0 for the variable field
+    };
+
+    // Declaration order is wire order.
+    constexpr FieldSpec Schema[] = {
+        {Field::DevType, 4},
+        {Field::NfcaType, 4},
+        {Field::NfcaSensRes, 2},
+        {Field::NfcaSelRes, 1},
+        {Field::NfcaNfcId1Len, 1},
+        {Field::NfcaNfcId1, 0},
+        {Field::NfcaIsSleep, 1},
+        {Field::NfcbSensbResLen, 1},
+        {Field::NfcbSensbRes, 13},
+        {Field::NfcbIsSleep, 1},
+        {Field::NfcfSensfResLen, 1},
+        {Field::NfcfSensfRes, 19},
+        {Field::NfcvResFlag, 1},
+        {Field::NfcvDsfid, 1},
+        {Field::NfcvUid, 8},
+        {Field::NfcvCrc, 2},
+        {Field::NfcvIsSleep, 1},
+        {Field::St25tbChipId, 1},
+        {Field::St25tbUid, 8},
+        {Field::St25tbIsDeselected, 1},
+    };
+
+    constexpr size_t SchemaLength = sizeof(Schema) / sizeof(Schema[0]);
+    constexpr Field VariableField = Field::NfcaNfcId1;
+    constexpr Field VariableLengthField = Field::NfcaNfcId1Len;
+    constexpr uint8_t MaxNfcId1Len = 10; // RFAL_NFCID1_TRIPLE_LEN
+
+    constexpr bool schemaIsOrdered()
+    {
+        for (size_t i = 0; i < SchemaLength; ++i)
+        {
+            if (static_cast<size_t>(Schema[i].field) != i)
+                return false;
+        }
+        return SchemaLength == static_cast<size_t>(Field::Count);
+    }
+
+    // Offset of a field when nfcId1 is empty; fields after nfcId1 add nfcId1Len at run time.
+    constexpr size_t fixedOffset(Field f)
+    {
+        size_t ofs = 0;
+        for (size_t i = 0; i < static_cast<size_t>(f); ++i)
+            ofs += Schema[i].size;
+        return ofs;
+    }
+
+    constexpr bool followsVariable(Field f)
+    {
+        return static_cast<size_t>(f) > static_cast<size_t>(VariableField);
+    }
+
+    constexpr size_t fieldSize(Field f)
+    {
+        return Schema[static_cast<size_t>(f)].size;
+    }
+
+    constexpr size_t FixedSize = fixedOffset(Field::Count);
+
+    static_assert(schemaIsOrdered(), "FlatNfcDevice::Schema must list every Field in declaration order");
+    static_assert(FixedSize == 71, "serFlatRfalNfcDevice is 71 bytes plus nfcId1Len on the wire");
+    static_assert(fieldSize(VariableLengthField) == 1, "nfcId1Len is a single byte");
+
+    // Read-only view over one record inside a response buffer. Accessors return pointers into the
+    // buffer; the view is only valid while the buffer is.
+    class View
+    {
+    public:
+        // Validates the record at buf and reports its total size. Fails on truncation or an
+        // nfcId1Len larger than RFAL allows (a layout mismatch, not something to clamp).
+        bool parse(const uint8_t* buf, size_t len)
+        {
+            _p = nullptr;
+            if (len < FixedSize)
+                return false;
+            uint8_t varLen = buf[fixedOffset(VariableLengthField)];
+            if (varLen > MaxNfcId1Len || len < FixedSize + varLen)
+                return false;
+            _p = buf;
+            _varLen = varLen;
+            return true;
+        }
+
+        size_t size() const { return FixedSize + _varLen; }
+
+        template <Field F>
+        const uint8_t* at() const
+        {
+            static_assert(F != Field::Count, "not a field");
+            constexpr size_t offset = fixedOffset(F);
+            return _p + offset + (followsVariable(F) ? _varLen : 0);
+        }
+
+        uint32_t devType() const { return be32(at<Field::DevType>()); }
+
+        // NFC-A
+        uint32_t nfcaType() const { return be32(at<Field::NfcaType>()); }
+        const uint8_t* nfcaSensRes() const { return at<Field::NfcaSensRes>(); }
+        uint8_t nfcaSelRes() const { return *at<Field::NfcaSelRes>(); }
+        uint8_t nfcaNfcId1Len() const { return _varLen; }
+        const uint8_t* nfcaNfcId1() const { return at<Field::NfcaNfcId1>(); }
+        bool nfcaIsSleep() const { return *at<Field::NfcaIsSleep>() != 0; }
+
+        // NFC-B (SENSB_RES: cmd, NFCID0[4], application data[4], protocol info[4])
+        uint8_t nfcbSensbResLen() const { return *at<Field::NfcbSensbResLen>(); }
+        const uint8_t* nfcbNfcid0() const { return at<Field::NfcbSensbRes>() + 1; }
+        const uint8_t* nfcbAppData() const { return at<Field::NfcbSensbRes>() + 5; }
+        const uint8_t* nfcbProtInfo() const { return at<Field::NfcbSensbRes>() + 9; }
+        bool nfcbIsSleep() const { return *at<Field::NfcbIsSleep>() != 0; }
+
+        // NFC-F (SENSF_RES: cmd, NFCID2[8], PAD0[2], PAD1[3], MRTIcheck, MRTIupdate, PAD2, RD[2])
+        uint8_t nfcfSensfResLen() const { return *at<Field::NfcfSensfResLen>(); }
+        const uint8_t* nfcfNfcid2() const { return at<Field::NfcfSensfRes>() + 1; }
+
+        // NFC-V
+        uint8_t nfcvResFlag() const { return *at<Field::NfcvResFlag>(); }
+        uint8_t nfcvDsfid() const { return *at<Field::NfcvDsfid>(); }
+        const uint8_t* nfcvUid() const { return at<Field::NfcvUid>(); }
+        bool nfcvIsSleep() const { return *at<Field::NfcvIsSleep>() != 0; }
+
+        // ST25TB
+        uint8_t st25tbChipId() const { return *at<Field::St25tbChipId>(); }
+        const uint8_t* st25tbUid() const { return at<Field::St25tbUid>(); }
+        bool st25tbIsDeselected() const { return *at<Field::St25tbIsDeselected>() != 0; }
+
+    private:
+        static uint32_t be32(const uint8_t* b)
+        {
+            return (static_cast<uint32_t>(b[0]) << 24) | (static_cast<uint32_t>(b[1]) << 16) |
+                   (static_cast<uint32_t>(b[2]) << 8) | b[3];
+        }
+
+        const uint8_t* _p = nullptr;
+        uint8_t _varLen = 0;
+    };
+
+    // Walks the rfalNfcGetDevicesFound payload: ret u16, devCnt u8, devCnt records.
+    class ListView
+    {
+    public:
+        bool parse(const uint8_t* buf, size_t len)
+        {
+            _buf = buf;
+            _len = len;
+            _ofs = 3;
+            _index = 0;
+            _malformed = false;
+            if (len < 3)
+            {
+                _ret = 0xFFFF;
+                _count = 0;
+                return false;
+            }
+            _ret = static_cast<uint16_t>((buf[0] << 8) | buf[1]);
+            _count = buf[2];
+            return true;
+        }
+
+        uint16_t ret() const { return _ret; }
+        uint8_t count() const { return _count; }
+        uint8_t index() const { return _index; }
+
+        // Advances to the next record. Returns false at the end or on a malformed record
+        // (check malformed() to tell them apart).
+        bool next(View& out)
+        {
+            if (_index >= _count)
+                return false;
+            if (!out.parse(_buf + _ofs, _len - _ofs))
+            {
+                _malformed = true;
+                return false;
+            }
+            _ofs += out.size();
+            _index++;
+            return true;
+        }
+
+        bool malformed() const { return _malformed; }
+
+    private:
+        const uint8_t* _buf = nullptr;
+        size_t _len = 0;
+        size_t _ofs = 0;
+        uint16_t _ret = 0;
+        uint8_t _count = 0;
+        uint8_t _index = 0;
+        bool _malformed = false;
+    };
+
+    // Writes one zero-filled record for simulators and tests; fill fields through at<F>().
+    class Builder
+    {
+    public:
+        // Returns false if cap cannot hold the record.
+        bool begin(uint8_t* buf, size_t cap, uint32_t devType, uint8_t nfcId1Len = 0)
+        {
+            _p = nullptr;
+            if (nfcId1Len > MaxNfcId1Len || cap < FixedSize + nfcId1Len)
+                return false;
+            _p = buf;
+            _varLen = nfcId1Len;
+            memset(buf, 0, size());
+            uint8_t* d = at<Field::DevType>();
+            d[0] = static_cast<uint8_t>(devType >> 24);
+            d[1] = static_cast<uint8_t>(devType >> 16);
+            d[2] = static_cast<uint8_t>(devType >> 8);
+            d[3] = static_cast<uint8_t>(devType);
+            *at<Field::NfcaNfcId1Len>() = nfcId1Len;
+            return true;
+        }
+
+        size_t size() const { return FixedSize + _varLen; }
+
+        template <Field F>
+        uint8_t* at()
+        {
+            static_assert(F != Field::Count, "not a field");
+            constexpr size_t offset = fixedOffset(F);
+            return _p + offset + (followsVariable(F) ? _varLen : 0);
+        }
+
+    private:
+        uint8_t* _p = nullptr;
+        uint8_t _varLen = 0;
+    };
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Destination of a response payload as St25r200Reader reads it off the serial port. The payload
+// arrives in order, and the sink says where each next segment goes: straight into the caller's
+// memory (ArenaSink), or into a small buffer of its own that it consumes segment by segment. A
+// frame carries up to MaxPayload bytes; whatever the sink does not take is still read and dropped,
+// so the stream stays aligned on the next frame.
+class FrameSink
+{
+public:
+    static constexpr size_t MaxPayload = 0xFFFF - 2; // u16 frame length, which counts the command ID
+
+    virtual ~FrameSink() = default;
+
+    // A payload of total bytes follows.
+    virtual void begin(size_t total) { (void)total; }
+    // Where the payload bytes from offset go: at most len bytes, and the sink may lower len.
+    // nullptr drops the rest of the payload.
+    virtual uint8_t* segment(size_t offset, size_t& len) = 0;
+    // The segment returned last holds its bytes now.
+    virtual void received(size_t offset, size_t len)
+    {
+        (void)offset;
+        (void)len;
+    }
+};
+
+// The payload in one caller-supplied buffer, read into it directly; bytes past its capacity are
+// dropped and the payload reports truncated().
+class ArenaSink : public FrameSink
+{
+public:
+    ArenaSink(uint8_t* buffer, size_t capacity) : _buffer(buffer), _capacity(capacity) {}
+
+    void begin(size_t total) override { _total = total; }
+
+    uint8_t* segment(size_t offset, size_t& len) override
+    {
+        if (!_buffer || offset >= _capacity)
+            return nullptr;
+        if (len > _capacity - offset)
+            len = _capacity - offset;
+        return _buffer + offset;
+    }
+
+    size_t total() const { return _total; }
+    size_t stored() const { return _total < _capacity ? _total : _capacity; }
+    bool truncated() const { return _total > _capacity; }
+
+private:
+    uint8_t* _buffer;
+    size_t _capacity;
+    size_t _total = 0;
+};
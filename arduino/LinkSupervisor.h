@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Health check and escalating recovery for one reader link. Every exchange reports its outcome:
+// consecutive failures, or consecutive round trips far above the command's usual RTT, mark the
+// link unhealthy. Recovery then walks the steps from cheapest to most disruptive, one per call to
+// nextStep(), backing off between attempts; after the last step it starts over with the backoff
+// doubled up to backoffMaxMs. Single-threaded; owned by the reader thread.
+class LinkSupervisor
+{
+public:
+    enum class Step : uint8_t
+    {
+        None,         // healthy, or backing off before the next attempt
+        Resync,       // drop buffered input, SysPing
+        Purge,        // pad the device's parser through a partial frame, drain, SysPing
+        Reinitialize, // rfalNfcInitialize and a new discovery
+        NfcReset,     // SysNfcReset, then as Reinitialize
+        Reopen,       // close and reopen the UART, then as Reinitialize
+    };
+    static constexpr uint8_t StepCount = 5;
+
+    struct Config
+    {
+        uint8_t failureLimit = 3;  // consecutive failed exchanges; 0 disables supervision
+        uint8_t outlierLimit = 8;  // consecutive RTT outliers; 0 = RTT is not checked
+        uint8_t outlierFactor = 8; // outlier: RTT above this many times the command's usual RTT
+        uint16_t backoffMinMs = 100;
+        uint16_t backoffMaxMs = 5000;
+    };
+
+    static constexpr uint32_t MinTypicalSamples = 32; // usual RTT trusted from this many samples
+    static constexpr uint32_t OutlierFloorUs = 2000;  // RTTs below this are never outliers
+
+    void configure(const Config& config) { _cfg = config; }
+
+    // typicalUs: the command's usual RTT so far, 0 while it has too few samples.
+    void recordSuccess(uint32_t rttUs, uint32_t typicalUs)
+    {
+        _failures = 0;
+        bool outlier = typicalUs > 0 && _cfg.outlierFactor > 0 && rttUs > OutlierFloorUs &&
+                       rttUs / _cfg.outlierFactor > typicalUs;
+        _outliers = outlier ? static_cast<uint8_t>(_outliers < 0xFF ? _outliers + 1 : 0xFF) : 0;
+    }
+
+    void recordFailure()
+    {
+        if (_failures < 0xFF)
+            _failures++;
+    }
+
+    bool unhealthy() const
+    {
+        return _cfg.failureLimit > 0 &&
+               (_failures >= _cfg.failureLimit || (_cfg.outlierLimit > 0 && _outliers >= _cfg.outlierLimit));
+    }
+
+    bool recovering() const { return _recovering; }
+    uint8_t failures() const { return _failures; }
+    uint8_t outliers() const { return _outliers; }
+
+    // Step to run now; None while healthy or backing off.
+    Step nextStep(unsigned long nowMs)
+    {
+        if (!_recovering)
+        {
+            if (!unhealthy())
+                return Step::None;
+            _recovering = true;
+            _downSinceMs = nowMs;
+            _level = 0;
+            _backoffMs = _cfg.backoffMinMs;
+            _notBeforeMs = nowMs;
+        }
+        if (static_cast<long>(nowMs - _notBeforeMs) < 0)
+            return Step::None;
+        return static_cast<Step>(1 + _level);
+    }
+
+    void stepFailed(unsigned long nowMs)
+    {
+        _notBeforeMs = nowMs + _backoffMs;
+        if (++_level >= StepCount)
+        {
+            _level = 0;
+            uint32_t doubled = static_cast<uint32_t>(_backoffMs) * 2;
+            _backoffMs = static_cast<uint16_t>(doubled > _cfg.backoffMaxMs ? _cfg.backoffMaxMs : doubled);
+        }
+    }
+
+    // Link verified again; returns how long it was down.
+    uint32_t recovered(unsigned long nowMs)
+    {
+        _recovering = false;
+        _failures = 0;
+        _outliers = 0;
+        return static_cast<uint32_t>(nowMs - _downSinceMs);
+    }
+
+    static const char* stepName(Step step)
+    {
+        switch (step)
+        {
+            case Step::Resync: return "resync";
+            case Step::Purge: return "purge";
+            case Step::Reinitialize: return "rfalNfcInitialize";
+            case Step::NfcReset: return "SysNfcReset";
+            case Step::Reopen: return "UART reopen";
+            default: return "none";
+        }
+    }
+
+private:
+    Config _cfg;
+    uint8_t _failures = 0;
+    uint8_t _outliers = 0;
+    bool _recovering = false;
+    uint8_t _level = 0; // index into the steps after None
+    uint16_t _backoffMs = 0;
+    unsigned long _downSinceMs = 0;
+    unsigned long _notBeforeMs = 0;
+};
@@ -0,0 +1,626 @@
+#include "MetricsServer.h"
+
+namespace
+{
+    // Coalesces the many small print() calls of a scrape into TCP-sized writes.
+    class BufferedClient : public Print
+    {
+    public:
+        explicit BufferedClient(Client& client)
+            : _client(client)
+        {
+        }
+
+        ~BufferedClient() override
+        {
+            flush();
+        }
+
+        size_t write(uint8_t b) override
+        {
+            if (_len == sizeof(_buf))
+                flush();
+            _buf[_len++] = b;
+            return 1;
+        }
+
+        void flush() override
+        {
+            if (_len > 0)
+                _client.write(_buf, _len);
+            _len = 0;
+        }
+
+    private:
+        Client& _client;
+        uint8_t _buf[512];
+        size_t _len = 0;
+    };
+
+    void writeFamily(Print& out, const char* name, const char* type, const char* help)
+    {
+        out.print("# HELP ");
+        out.print(name);
+        out.print(" ");
+        out.println(help);
+        out.print("# TYPE ");
+        out.print(name);
+        out.print(" ");
+        out.println(type);
+    }
+
+    void writeSeconds(Print& out, uint64_t us)
+    {
+        out.print(static_cast<double>(us) / 1000000.0, 6);
+    }
+
+    // Prometheus histogram with cumulative le buckets in seconds; labels is the inner label list (may be empty).
+    void writeHistogram(Print& out, const char* name, const char* labels, const RttHistogram::Snapshot& h)
+    {
+        const char* sep = labels[0] ? "," : "";
+        uint32_t cumulative = 0;
+        for (size_t i = 0; i < RttHistogram::Buckets; ++i)
+        {
+            cumulative += h.counts[i];
+            out.print(name);
+            out.print("_bucket{");
+            out.print(labels);
+            out.print(sep);
+            out.print("le=\"");
+            if (i < RttHistogram::Buckets - 1)
+                writeSeconds(out, RttHistogram::bucketUpperUs(i));
+            else
+                out.print("+Inf");
+            out.print("\"} ");
+            out.println(cumulative);
+        }
+        out.print(name);
+        out.print("_sum");
+        if (labels[0])
+        {
+            out.print("{");
+            out.print(labels);
+            out.print("}");
+        }
+        out.print(" ");
+        writeSeconds(out, h.sumUs);
+        out.println();
+        out.print(name);
+        out.print("_count");
+        if (labels[0])
+        {
+            out.print("{");
+            out.print(labels);
+            out.print("}");
+        }
+        out.print(" ");
+        out.println(h.count);
+    }
+
+    void formatCommandLabels(char* out, size_t outLen, const char* reader, uint16_t cmdId)
+    {
+        snprintf(out, outLen, "reader=\"%s\",cmd=\"0x%04X\",name=\"%s\"", reader, cmdId, DescribeCommand(cmdId));
+    }
+
+    // Writes "<name>{<command labels>} " ready for the value.
+    void writeCommandSample(Print& out, const char* name, const char* reader, uint16_t cmdId)
+    {
+        char labels[96];
+        formatCommandLabels(labels, sizeof(labels), reader, cmdId);
+        out.print(name);
+        out.print("{");
+        out.print(labels);
+        out.print("} ");
+    }
+
+    struct ReaderCounter
+    {
+        const char* name;
+        const char* type;
+        const char* help;
+        uint32_t ReaderMetrics::Snapshot::*field;
+    };
+
+    const ReaderCounter kReaderCounters[] = {
+        {"st25_reader_cycles_total", "counter", "Presence loop cycles.", &ReaderMetrics::Snapshot::cycles},
+        {"st25_reader_frames_tx_total", "counter", "Request frames written.", &ReaderMetrics::Snapshot::framesTx},
+        {"st25_reader_frames_rx_total", "counter", "Response frames read.", &ReaderMetrics::Snapshot::framesRx},
+        {"st25_reader_bytes_tx_total", "counter", "Bytes written to the UART.", &ReaderMetrics::Snapshot::bytesTx},
+        {"st25_reader_bytes_rx_total", "counter", "Framed bytes read from the UART.", &ReaderMetrics::Snapshot::bytesRx},
+        {"st25_reader_resync_bytes_total", "counter", "Bytes skipped while hunting for a frame header.",
+         &ReaderMetrics::Snapshot::resyncBytes},
+        {"st25_reader_resync_overflows_total", "counter", "Header hunts abandoned after 4096 bytes.",
+         &ReaderMetrics::Snapshot::resyncOverflows},
+        {"st25_reader_read_timeouts_total", "counter", "UART reads that hit readTimeoutMs.",
+         &ReaderMetrics::Snapshot::timeouts},
+        {"st25_reader_bad_length_total", "counter", "Frames with a length field below 2.",
+         &ReaderMetrics::Snapshot::badLength},
+        {"st25_reader_truncated_payloads_total", "counter", "Responses larger than the receive buffer.",
+         &ReaderMetrics::Snapshot::truncatedPayloads},
+        {"st25_reader_unexpected_response_total", "counter", "Responses whose command ID did not match the request.",
+         &ReaderMetrics::Snapshot::unexpectedCmd},
+        {"st25_reader_bad_device_records_total", "counter", "GetDevicesFound responses with a malformed device record.",
+         &ReaderMetrics::Snapshot::badDeviceRecords},
+        {"st25_reader_discoveries_total", "counter", "Full rfalNfcDiscover runs started.",
+         &ReaderMetrics::Snapshot::discoveries},
+        {"st25_reader_presence_checks_total", "counter", "Per-technology poller presence checks.",
+         &ReaderMetrics::Snapshot::presenceChecks},
+        {"st25_reader_presence_check_misses_total", "counter", "Confirm cycles that fell back to discovery.",
+         &ReaderMetrics::Snapshot::presenceCheckMisses},
+        {"st25_reader_wakeups_total", "counter", "Wake-up mode measurement triggers seen.",
+         &ReaderMetrics::Snapshot::wakeups},
+        {"st25_reader_false_wakeups_total", "counter", "Wake-ups that returned to wake-up mode without a tag.",
+         &ReaderMetrics::Snapshot::falseWakeups},
+        {"st25_reader_wakeup_calibrations_total", "counter", "Wake-up threshold calibrations run.",
+         &ReaderMetrics::Snapshot::wakeupCalibrations},
+        {"st25_reader_rfo", "gauge", "RF output driver resistance in use (higher is weaker).", &ReaderMetrics::Snapshot::rfo},
+        {"st25_reader_antenna_amplitude", "gauge", "Antenna amplitude measured at initialization.",
+         &ReaderMetrics::Snapshot::antennaAmplitude},
+        {"st25_reader_antenna_phase", "gauge", "Antenna phase measured at initialization.",
+         &ReaderMetrics::Snapshot::antennaPhase},
+        {"st25_reader_dpo_phase", "gauge", "DPO tuning phase (0 off, 1 collecting, 2 validating, 3 active, 4 rejected).",
+         &ReaderMetrics::Snapshot::dpoPhase},
+        {"st25_reader_dpo_samples", "gauge", "DPO tuning samples collected.", &ReaderMetrics::Snapshot::dpoSamples},
+        {"st25_reader_dpo_table_entries", "gauge", "Entries of the enabled DPO table (0 = fixed RFO).",
+         &ReaderMetrics::Snapshot::dpoTableEntries},
+        {"st25_reader_analog_config_skips_total", "counter", "Analog config syncs settled by the device config hash.",
+         &ReaderMetrics::Snapshot::analogConfigSkips},
+        {"st25_reader_analog_config_writes_total", "counter", "Analog config tables written to the device.",
+         &ReaderMetrics::Snapshot::analogConfigWrites},
+        {"st25_reader_warm_starts_total", "counter", "Startups that adopted a discovery already running on the device.",
+         &ReaderMetrics::Snapshot::warmStarts},
+        {"st25_reader_cold_starts_total", "counter", "Startups that ran rfalNfcInitialize and a new discovery.",
+         &ReaderMetrics::Snapshot::coldStarts},
+        {"st25_reader_startup_ms", "gauge", "Milliseconds from begin() to discovery running at the last start.",
+         &ReaderMetrics::Snapshot::startupMs},
+        {"st25_reader_first_detect_ms", "gauge", "Milliseconds from begin() to the first tag at the last start.",
+         &ReaderMetrics::Snapshot::firstDetectMs},
+        {"st25_reader_link_down", "gauge", "1 while the link supervisor is recovering the reader.",
+         &ReaderMetrics::Snapshot::linkDown},
+        {"st25_reader_link_recoveries_total", "counter", "Link recoveries completed.", &ReaderMetrics::Snapshot::linkRecoveries},
+        {"st25_reader_recovery_steps_total", "counter", "Recovery steps attempted (resync to UART reopen).",
+         &ReaderMetrics::Snapshot::recoverySteps},
+        {"st25_reader_last_recovery_ms", "gauge", "Milliseconds from unhealthy to verified, last recovery.",
+         &ReaderMetrics::Snapshot::lastRecoveryMs},
+        {"st25_reader_max_recovery_ms", "gauge", "Longest recovery so far in milliseconds.",
+         &ReaderMetrics::Snapshot::maxRecoveryMs},
+        {"st25_reader_last_recovery_detect_ms", "gauge",
+         "Milliseconds from unhealthy to a tracked tag seen again, last recovery with tags present.",
+         &ReaderMetrics::Snapshot::lastRecoveryDetectMs},
+        {"st25_reader_link_baud", "gauge", "UART baud rate chosen at startup.", &ReaderMetrics::Snapshot::baudRate},
+        {"st25_reader_baud_probe_failures_total", "counter", "Candidate baud rates that did not answer SysPing.",
+         &ReaderMetrics::Snapshot::baudProbeFailures},
+    };
+
+    const char* const kModeNames[ReaderMetrics::Modes] = {"polling", "wakeup"};
+
+    struct TechCounter
+    {
+        const char* name;
+        const char* help;
+        std::atomic<uint32_t> ReaderMetrics::TechStats::*field;
+    };
+
+    const TechCounter kTechCounters[] = {
+        {"st25_tech_polls_total", "Discovery runs that polled the technology.", &ReaderMetrics::TechStats::polls},
+        {"st25_tech_hits_total", "Discovery runs that found a tag of the technology.", &ReaderMetrics::TechStats::hits},
+    };
+
+    // Writes "<name>{reader="..",tech=".."} " ready for the value.
+    void writeTechSample(Print& out, const char* name, const char* reader, size_t tech)
+    {
+        out.print(name);
+        out.print("{reader=\"");
+        out.print(reader);
+        out.print("\",tech=\"");
+        out.print(DiscoveryScheduler::techName(tech));
+        out.print("\"} ");
+    }
+}
+
+MetricsServer::MetricsServer(uint16_t port, Stream& logStream)
+    : _server(port)
+    , _port(port)
+    , _log(logStream)
+{
+}
+
+void MetricsServer::addReader(const char* name, const St25r200Reader& reader)
+{
+    if (_readerCount < MaxReaders)
+        _readers[_readerCount++] = {name, &reader};
+}
+
+void MetricsServer::addThread(const char* name, const rtos::Thread& thread, const StackWatermark* stack)
+{
+    if (_threadCount < MaxThreads)
+        _threads[_threadCount++] = {name, &thread, stack};
+}
+
+void MetricsServer::setNotifier(const RestNotifier& notifier)
+{
+    _notifier = &notifier;
+}
+
+void MetricsServer::begin()
+{
+    _server.begin();
+    _log.print("Metrics server listening on :");
+    _log.println(_port);
+}
+
+void MetricsServer::loop()
+{
+    begin();
+    while (true)
+    {
+        poll();
+        delay(10);
+    }
+}
+
+void MetricsServer::poll()
+{
+    EthernetClient client = _server.available();
+    if (!client)
+        return;
+
+    char path[32] = {0};
+    if (!readRequestPath(client, path, sizeof(path)))
+    {
+        client.stop();
+        return;
+    }
+
+    if (strcmp(path, "/metrics") == 0)
+    {
+        BufferedClient out(client);
+        out.print("HTTP/1.0 200 OK\r\n");
+        out.print("Content-Type: text/plain; version=0.0.4\r\n");
+        out.print("Connection: close\r\n\r\n");
+        renderMetrics(out);
+        out.flush();
+    }
+    else if (strcmp(path, "/tags") == 0)
+    {
+        BufferedClient out(client);
+        if (!renderTags(out))
+            out.print("HTTP/1.0 503 Service Unavailable\r\nConnection: close\r\n\r\n");
+        out.flush();
+    }
+    else
+    {
+        client.print("HTTP/1.0 404 Not Found\r\nConnection: close\r\n\r\n");
+    }
+
+    client.flush();
+    client.stop();
+}
+
+bool MetricsServer::readRequestPath(EthernetClient& client, char* path, size_t pathLen)
+{
+    // Request line "GET <path> HTTP/1.x"; the headers are drained and ignored.
+    char line[64] = {0};
+    size_t lineLen = 0;
+    bool haveLine = false;
+    uint8_t newlines = 0;
+    unsigned long start = millis();
+
+    while (client.connected() && (millis() - start) < RequestTimeoutMs)
+    {
+        int c = client.read();
+        if (c < 0)
+        {
+            delay(1);
+            continue;
+        }
+        if (c == '\r')
+            continue;
+        if (c == '\n')
+        {
+            haveLine = true;
+            if (++newlines == 2)
+                break;
+            continue;
+        }
+        newlines = 0;
+        if (!haveLine && lineLen < sizeof(line) - 1)
+            line[lineLen++] = static_cast<char>(c);
+    }
+
+    if (!haveLine || strncmp(line, "GET ", 4) != 0)
+        return false;
+
+    const char* p = line + 4;
+    size_t n = 0;
+    while (p[n] && p[n] != ' ' && p[n] != '?' && n < pathLen - 1)
+    {
+        path[n] = p[n];
+        ++n;
+    }
+    path[n] = '\0';
+    return true;
+}
+
+void MetricsServer::renderMetrics(Print& out)
+{
+    renderReaders(out);
+    renderCommands(out);
+    renderTechs(out);
+    renderModes(out);
+    renderRest(out);
+    renderSystem(out);
+}
+
+void MetricsServer::renderReaders(Print& out)
+{
+    ReaderMetrics::Snapshot snaps[MaxReaders];
+    for (size_t r = 0; r < _readerCount; ++r)
+        _readers[r].reader->metrics().snapshot(snaps[r]);
+
+    for (const ReaderCounter& c : kReaderCounters)
+    {
+        writeFamily(out, c.name, c.type, c.help);
+        for (size_t r = 0; r < _readerCount; ++r)
+        {
+            out.print(c.name);
+            out.print("{reader=\"");
+            out.print(_readers[r].name);
+            out.print("\"} ");
+            out.println(snaps[r].*c.field);
+        }
+    }
+
+    writeFamily(out, "st25_reader_cycle_rate_hz", "gauge", "Presence loop rate over the last second.");
+    for (size_t r = 0; r < _readerCount; ++r)
+    {
+        out.print("st25_reader_cycle_rate_hz{reader=\"");
+        out.print(_readers[r].name);
+        out.print("\"} ");
+        out.println(static_cast<double>(snaps[r].cycleRateMilliHz) / 1000.0, 3);
+    }
+
+    writeFamily(out, "st25_reader_arena_bytes", "gauge", "Transport and parse buffers held in the reader.");
+    for (size_t r = 0; r < _readerCount; ++r)
+    {
+        out.print("st25_reader_arena_bytes{reader=\"");
+        out.print(_readers[r].name);
+        out.print("\"} ");
+        out.println(_readers[r].reader->arenaBytes());
+    }
+}
+
+void MetricsServer::renderTechs(Print& out)
+{
+    for (const TechCounter& c : kTechCounters)
+    {
+        writeFamily(out, c.name, "counter", c.help);
+        for (size_t r = 0; r < _readerCount; ++r)
+        {
+            const ReaderMetrics& m = _readers[r].reader->metrics();
+            for (size_t i = 0; i < ReaderMetrics::MaxTechs; ++i)
+            {
+                writeTechSample(out, c.name, _readers[r].name, i);
+                out.println((m.techAt(i).*c.field).load(std::memory_order_relaxed));
+            }
+        }
+    }
+
+    writeFamily(out, "st25_tech_rf_seconds_total", "counter",
+                "Estimated field time spent polling the technology (rounds x guard time + exchange).");
+    for (size_t r = 0; r < _readerCount; ++r)
+    {
+        const ReaderMetrics& m = _readers[r].reader->metrics();
+        for (size_t i = 0; i < ReaderMetrics::MaxTechs; ++i)
+        {
+            writeTechSample(out, "st25_tech_rf_seconds_total", _readers[r].name, i);
+            out.println(static_cast<double>(m.techAt(i).rfTimeMs.load(std::memory_order_relaxed)) / 1000.0, 3);
+        }
+    }
+}
+
+void MetricsServer::renderModes(Print& out)
+{
+    writeFamily(out, "st25_reader_activation_seconds", "histogram",
+                "Discovery start (wake-up mode: the wake-up) to activation of an arriving tag, per mode.");
+    for (size_t r = 0; r < _readerCount; ++r)
+    {
+        const ReaderMetrics& m = _readers[r].reader->metrics();
+        for (size_t i = 0; i < ReaderMetrics::Modes; ++i)
+        {
+            RttHistogram::Snapshot h;
+            m.modeAt(i).activationLatency.snapshot(h);
+            char labels[64];
+            snprintf(labels, sizeof(labels), "reader=\"%s\",mode=\"%s\"", _readers[r].name, kModeNames[i]);
+            writeHistogram(out, "st25_reader_activation_seconds", labels, h);
+        }
+    }
+
+    writeFamily(out, "st25_reader_mode_seconds_total", "counter", "Time spent per discovery mode.");
+    for (size_t r = 0; r < _readerCount; ++r)
+    {
+        const ReaderMetrics& m = _readers[r].reader->metrics();
+        for (size_t i = 0; i < ReaderMetrics::Modes; ++i)
+        {
+            out.print("st25_reader_mode_seconds_total{reader=\"");
+            out.print(_readers[r].name);
+            out.print("\",mode=\"");
+            out.print(kModeNames[i]);
+            out.print("\"} ");
+            out.println(static_cast<double>(m.modeAt(i).timeMs.load(std::memory_order_relaxed)) / 1000.0, 3);
+        }
+    }
+
+    writeFamily(out, "st25_reader_mode_rf_seconds_total", "counter",
+                "Estimated field-on time per discovery mode; divide by mode seconds for the duty cycle.");
+    for (size_t r = 0; r < _readerCount; ++r)
+    {
+        const ReaderMetrics& m = _readers[r].reader->metrics();
+        for (size_t i = 0; i < ReaderMetrics::Modes; ++i)
+        {
+            out.print("st25_reader_mode_rf_seconds_total{reader=\"");
+            out.print(_readers[r].name);
+            out.print("\",mode=\"");
+            out.print(kModeNames[i]);
+            out.print("\"} ");
+            out.println(static_cast<double>(m.modeAt(i).rfTimeMs.load(std::memory_order_relaxed)) / 1000.0, 3);
+        }
+    }
+}
+
+void MetricsServer::renderCommands(Print& out)
+{
+    writeFamily(out, "st25_command_rtt_seconds", "histogram", "Request to response round-trip time per command.");
+    for (size_t r = 0; r < _readerCount; ++r)
+    {
+        const ReaderMetrics& m = _readers[r].reader->metrics();
+        for (size_t i = 0; i < ReaderMetrics::MaxCommands; ++i)
+        {
+            const ReaderMetrics::CommandStats& cmd = m.commandAt(i);
+            uint16_t id = cmd.cmdId.load(std::memory_order_acquire);
+            if (id == 0)
+                continue;
+
+            RttHistogram::Snapshot h;
+            cmd.rtt.snapshot(h);
+            char labels[96];
+            formatCommandLabels(labels, sizeof(labels), _readers[r].name, id);
+            writeHistogram(out, "st25_command_rtt_seconds", labels, h);
+        }
+    }
+
+    writeFamily(out, "st25_command_rtt_max_seconds", "gauge", "Slowest round trip seen per command.");
+    for (size_t r = 0; r < _readerCount; ++r)
+    {
+        const ReaderMetrics& m = _readers[r].reader->metrics();
+        for (size_t i = 0; i < ReaderMetrics::MaxCommands; ++i)
+        {
+            const ReaderMetrics::CommandStats& cmd = m.commandAt(i);
+            uint16_t id = cmd.cmdId.load(std::memory_order_acquire);
+            if (id == 0)
+                continue;
+
+            writeCommandSample(out, "st25_command_rtt_max_seconds", _readers[r].name, id);
+            writeSeconds(out, cmd.rtt.maxUs.load(std::memory_order_relaxed));
+            out.println();
+        }
+    }
+
+    writeFamily(out, "st25_command_failures_total", "counter", "Requests that got no response frame.");
+    for (size_t r = 0; r < _readerCount; ++r)
+    {
+        const ReaderMetrics& m = _readers[r].reader->metrics();
+        for (size_t i = 0; i < ReaderMetrics::MaxCommands; ++i)
+        {
+            const ReaderMetrics::CommandStats& cmd = m.commandAt(i);
+            uint16_t id = cmd.cmdId.load(std::memory_order_acquire);
+            if (id == 0)
+                continue;
+
+            writeCommandSample(out, "st25_command_failures_total", _readers[r].name, id);
+            out.println(cmd.failures.load(std::memory_order_relaxed));
+        }
+    }
+}
+
+void MetricsServer::renderRest(Print& out)
+{
+    if (!_notifier)
+        return;
+
+    const RestMetrics& m = _notifier->metrics();
+    writeFamily(out, "st25_rest_posts_total", "counter", "Presence events posted.");
+    out.print("st25_rest_posts_total ");
+    out.println(m.posts.load(std::memory_order_relaxed));
+    writeFamily(out, "st25_rest_connect_failures_total", "counter", "Posts that could not connect.");
+    out.print("st25_rest_connect_failures_total ");
+    out.println(m.connectFailures.load(std::memory_order_relaxed));
+    writeFamily(out, "st25_rest_timeouts_total", "counter", "Posts still open when timeoutMs expired.");
+    out.print("st25_rest_timeouts_total ");
+    out.println(m.timeouts.load(std::memory_order_relaxed));
+
+    RttHistogram::Snapshot h;
+    m.latency.snapshot(h);
+    writeFamily(out, "st25_rest_latency_seconds", "histogram", "Connect to close time of posts that connected.");
+    writeHistogram(out, "st25_rest_latency_seconds", "", h);
+}
+
+void MetricsServer::renderSystem(Print& out)
+{
+    // Heap counters read zero unless the core is built with MBED_HEAP_STATS_ENABLED.
+    mbed_stats_heap_t heap;
+    mbed_stats_heap_get(&heap);
+    writeFamily(out, "st25_heap_bytes", "gauge", "Heap usage (current, high-water, reserved).");
+    out.print("st25_heap_bytes{kind=\"current\"} ");
+    out.println(heap.current_size);
+    out.print("st25_heap_bytes{kind=\"max\"} ");
+    out.println(heap.max_size);
+    out.print("st25_heap_bytes{kind=\"reserved\"} ");
+    out.println(heap.reserved_size);
+    writeFamily(out, "st25_heap_alloc_failures_total", "counter", "Failed heap allocations.");
+    out.print("st25_heap_alloc_failures_total ");
+    out.println(heap.alloc_fail_cnt);
+
+    writeFamily(out, "st25_thread_stack_bytes", "gauge", "Thread stack size and high-water mark.");
+    for (size_t t = 0; t < _threadCount; ++t)
+    {
+        out.print("st25_thread_stack_bytes{thread=\"");
+        out.print(_threads[t].name);
+        out.print("\",kind=\"size\"} ");
+        out.println(_threads[t].thread->stack_size());
+        out.print("st25_thread_stack_bytes{thread=\"");
+        out.print(_threads[t].name);
+        out.print("\",kind=\"max_used\"} ");
+        out.println(_threads[t].stack ? _threads[t].stack->maxUsed() : _threads[t].thread->max_stack());
+    }
+
+    writeFamily(out, "st25_uptime_seconds", "gauge", "Seconds since boot.");
+    out.print("st25_uptime_seconds ");
+    out.println(millis() / 1000UL);
+}
+
+bool MetricsServer::renderTags(Print& out)
+{
+    // Copy every reader's set before writing the status line so a failed read can still 503.
+    PresenceSet sets[MaxReaders];
+    for (size_t r = 0; r < _readerCount; ++r)
+    {
+        if (!_readers[r].reader->presence().read(sets[r]))
+            return false;
+    }
+
+    out.print("HTTP/1.0 200 OK\r\n");
+    out.print("Content-Type: application/json\r\n");
+    out.print("Connection: close\r\n\r\n");
+
+    out.print("{\"uptimeMs\":");
+    out.print(millis());
+    out.print(",\"readers\":[");
+    for (size_t r = 0; r < _readerCount; ++r)
+    {
+        const PresenceSet& set = sets[r];
+        if (r > 0)
+            out.print(",");
+        out.print("{\"reader\":\"");
+        out.print(_readers[r].name);
+        out.print("\",\"publishedMs\":");
+        out.print(set.publishedMs);
+        out.print(",\"tags\":[");
+        for (size_t i = 0; i < set.count; ++i)
+        {
+            const TagSighting& t = set.tags[i];
+            if (i > 0)
+                out.print(",");
+            out.print("{\"uid\":\"");
+            out.print(t.uid);
+            out.print("\",\"firstSeenMs\":");
+            out.print(t.firstSeenMs);
+            out.print(",\"lastSeenMs\":");
+            out.print(t.lastSeenMs);
+            out.print("}");
+        }
+        out.print("]}");
+    }
+    out.println("]}");
+    return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Ethernet.h>
+#include <mbed.h>
+
+#include "RestNotifier.h"
+#include "St25r200Reader.h"
+#include "ThreadStack.h"
+
+// Minimal HTTP/1.0 server for the controller:
+//   GET /metrics  reader, REST, heap and stack metrics in Prometheus text format
+//   GET /tags     current presence set per reader (JSON) with first/last-seen uptime
+// Everything it reads is a relaxed atomic, an RTOS query or a PresenceSnapshot copy, so serving a
+// request never blocks the reader threads. Run loop() in its own thread.
+class MetricsServer
+{
+public:
+    static constexpr size_t MaxReaders = 4;
+    static constexpr size_t MaxThreads = 6;
+
+    MetricsServer(uint16_t port, Stream& logStream);
+
+    void addReader(const char* name, const St25r200Reader& reader);
+    // With a StackWatermark the high-water mark is read from its painted stack instead of RTX.
+    void addThread(const char* name, const rtos::Thread& thread, const StackWatermark* stack = nullptr);
+    void setNotifier(const RestNotifier& notifier);
+
+    void begin();
+    void poll(); // serves at most one pending client
+    void loop();
+
+private:
+    struct ReaderEntry
+    {
+        const char* name;
+        const St25r200Reader* reader;
+    };
+
+    struct ThreadEntry
+    {
+        const char* name;
+        const rtos::Thread* thread;
+        const StackWatermark* stack;
+    };
+
+    bool readRequestPath(EthernetClient& client, char* path, size_t pathLen);
+    void renderMetrics(Print& out);
+    void renderReaders(Print& out);
+    void renderCommands(Print& out);
+    void renderTechs(Print& out);
+    void renderModes(Print& out);
+    void renderRest(Print& out);
+    void renderSystem(Print& out);
+    bool renderTags(Print& out);
+
+    EthernetServer _server;
+    uint16_t _port;
+    Stream& _log;
+
+    ReaderEntry _readers[MaxReaders] = {};
+    size_t _readerCount = 0;
+    ThreadEntry _threads[MaxThreads] = {};
+    size_t _threadCount = 0;
+    const RestNotifier* _notifier = nullptr;
+
+    static constexpr uint16_t RequestTimeoutMs = 500;
+};
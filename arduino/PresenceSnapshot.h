@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "PresenceTracker.h"
+
+struct TagSighting
+{
+    char uid[32];
+    uint32_t firstSeenMs;
+    uint32_t lastSeenMs;
+};
+
+struct PresenceSet
+{
+    uint32_t publishedMs;
+    size_t count;
+    TagSighting tags[4];
+};
+
+// Double-buffered presence set for lock-free readers (RCU style).
+// The reader thread fills the inactive buffer and then flips _active; readers copy the active
+// buffer and retry if its version moved underneath them. Only a reader that stalls across two
+// publishes ever retries, and the writer never waits.
+class PresenceSnapshot
+{
+public:
+    // Writer side; call only from the owning reader thread.
+    void publish(const PresenceTracker& tracker, uint32_t nowMs)
+    {
+        uint8_t next = _active.load(std::memory_order_relaxed) ^ 1;
+        Buffer& b = _buffers[next];
+
+        b.version.fetch_add(1, std::memory_order_relaxed); // odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+
+        b.set.publishedMs = nowMs;
+        b.set.count = min(tracker.count(), sizeof(b.set.tags) / sizeof(b.set.tags[0]));
+        for (size_t i = 0; i < b.set.count; ++i)
+        {
+            TagSighting& t = b.set.tags[i];
+            strncpy(t.uid, tracker.uid(i).c_str(), sizeof(t.uid) - 1);
+            t.uid[sizeof(t.uid) - 1] = '\0';
+            t.firstSeenMs = tracker.firstSeenMs(i);
+            t.lastSeenMs = tracker.lastSeenMs(i);
+        }
+
+        b.version.fetch_add(1, std::memory_order_release);
+        _active.store(next, std::memory_order_release);
+    }
+
+    // Reader side; safe from any thread. Returns false only if every attempt raced a publish.
+    bool read(PresenceSet& out) const
+    {
+        for (uint8_t attempt = 0; attempt < 8; ++attempt)
+        {
+            const Buffer& b = _buffers[_active.load(std::memory_order_acquire)];
+            uint32_t v1 = b.version.load(std::memory_order_acquire);
+            if (v1 & 1)
+                continue;
+
+            memcpy(&out, &b.set, sizeof(out));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (b.version.load(std::memory_order_relaxed) == v1)
+                return true;
+        }
+        return false;
+    }
+
+private:
+    struct Buffer
+    {
+        std::atomic<uint32_t> version{0};
+        PresenceSet set = {};
+    };
+
+    Buffer _buffers[2];
+    std::atomic<uint8_t> _active{0};
+};
@@ -21,13 +21,14 @@ public:
         clear();
     }
 
-    PresenceDelta update(const String* nowTags, size_t nowCount)
+    PresenceDelta update(const String* nowTags, size_t nowCount, uint32_t nowMs = millis())
     {
         PresenceDelta delta;
         delta.max = _maxTags;
 
         bool nowPresent[4] = {false, false, false, false};
         String nowClipped[4];
+        uint32_t nowFirstSeen[4] = {nowMs, nowMs, nowMs, nowMs};
         size_t clippedCount = min(nowCount, _maxTags);
         for (size_t i = 0; i < clippedCount; ++i)
         {
@@ -42,6 +43,7 @@ public:
                 if (_present[j] && _uids[j] == nowClipped[i])
                 {
                     nowPresent[j] = true;
+                    nowFirstSeen[i] = _firstSeenMs[j];
                     found = true;
                     break;
                 }
@@ -65,12 +67,21 @@ public:
         {
             _uids[i] = nowClipped[i];
             _present[i] = true;
+            _firstSeenMs[i] = nowFirstSeen[i];
+            _lastSeenMs[i] = nowMs;
         }
+        _count = clippedCount;
 
         delta.count = clippedCount;
         return delta;
     }
 
+    // Current set, in the order of the last update.
+    size_t count() const { return _count; }
+    const String& uid(size_t i) const { return _uids[i]; }
+    uint32_t firstSeenMs(size_t i) const { return _firstSeenMs[i]; }
+    uint32_t lastSeenMs(size_t i) const { return _lastSeenMs[i]; }
+
 private:
     void clear()
     {
@@ -78,10 +89,16 @@ private:
         {
             _uids[i] = "";
             _present[i] = false;
+            _firstSeenMs[i] = 0;
+            _lastSeenMs[i] = 0;
         }
+        _count = 0;
     }
 
     size_t _maxTags;
     String _uids[4];
     bool _present[4];
+    uint32_t _firstSeenMs[4];
+    uint32_t _lastSeenMs[4];
+    size_t _count = 0;
 };
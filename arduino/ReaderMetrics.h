@@ -0,0 +1,361 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+// Per-reader transport statistics. Written only by the reader thread; every field is a
+// relaxed std::atomic so other threads (metrics server, console) can read without locks.
+
+// Log2-bucketed round-trip histogram: bucket 0 holds RTTs < 128 us, bucket i < (128 us << i),
+// the last bucket everything slower.
+struct RttHistogram
+{
+    static constexpr size_t Buckets = 16;
+    static constexpr uint32_t FirstBucketUs = 128;
+
+    // Plain copy for rendering; count is the bucket total so the copy is self-consistent.
+    struct Snapshot
+    {
+        uint32_t counts[Buckets];
+        uint32_t count;
+        uint64_t sumUs;
+        uint32_t maxUs;
+    };
+
+    std::atomic<uint32_t> counts[Buckets] = {};
+    std::atomic<uint32_t> count{0};
+    std::atomic<uint32_t> maxUs{0};
+
+    // The sum is 64-bit: 32 bits of microseconds wrap after 71 minutes of total RTT. It is kept as
+    // two words under a sequence count, as 64-bit atomics are not lock-free on Cortex-M7.
+    std::atomic<uint32_t> sumSeq{0}; // odd while the words are being written
+    std::atomic<uint32_t> sumUsLo{0};
+    std::atomic<uint32_t> sumUsHi{0};
+
+    static size_t bucketFor(uint32_t us)
+    {
+        size_t i = 0;
+        uint32_t bound = FirstBucketUs;
+        while (i < Buckets - 1 && us >= bound)
+        {
+            bound <<= 1;
+            ++i;
+        }
+        return i;
+    }
+
+    // Upper bound of bucket i in microseconds (0 for the open-ended last bucket).
+    static uint32_t bucketUpperUs(size_t i)
+    {
+        return i < Buckets - 1 ? (FirstBucketUs << i) : 0;
+    }
+
+    void record(uint32_t us)
+    {
+        counts[bucketFor(us)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        addSum(us);
+        if (us > maxUs.load(std::memory_order_relaxed))
+            maxUs.store(us, std::memory_order_relaxed);
+    }
+
+    // Upper bound of the bucket holding the pct-th percentile (last bucket reports maxUs).
+    static uint32_t percentileUpperUs(const Snapshot& h, uint8_t pct)
+    {
+        if (h.count == 0)
+            return 0;
+        uint32_t rank = static_cast<uint32_t>((static_cast<uint64_t>(h.count) * pct + 99) / 100);
+        uint32_t seen = 0;
+        for (size_t i = 0; i < Buckets - 1; ++i)
+        {
+            seen += h.counts[i];
+            if (seen >= rank)
+                return min(bucketUpperUs(i), h.maxUs);
+        }
+        return h.maxUs;
+    }
+
+    void snapshot(Snapshot& out) const
+    {
+        out.count = 0;
+        for (size_t i = 0; i < Buckets; ++i)
+        {
+            out.counts[i] = counts[i].load(std::memory_order_relaxed);
+            out.count += out.counts[i];
+        }
+        out.sumUs = sum();
+        out.maxUs = maxUs.load(std::memory_order_relaxed);
+    }
+
+    // Writer side; only the owning thread records.
+    void addSum(uint32_t us)
+    {
+        uint64_t total = (static_cast<uint64_t>(sumUsHi.load(std::memory_order_relaxed)) << 32 |
+                          sumUsLo.load(std::memory_order_relaxed)) + us;
+        sumSeq.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        sumUsLo.store(static_cast<uint32_t>(total), std::memory_order_relaxed);
+        sumUsHi.store(static_cast<uint32_t>(total >> 32), std::memory_order_relaxed);
+        sumSeq.fetch_add(1, std::memory_order_release);
+    }
+
+    // Reader side; retries while a record() is half way through the words, like PresenceSnapshot.
+    uint64_t sum() const
+    {
+        uint64_t total = 0;
+        for (uint8_t attempt = 0; attempt < 8; ++attempt)
+        {
+            uint32_t v1 = sumSeq.load(std::memory_order_acquire);
+            total = static_cast<uint64_t>(sumUsHi.load(std::memory_order_relaxed)) << 32 |
+                    sumUsLo.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (!(v1 & 1) && sumSeq.load(std::memory_order_relaxed) == v1)
+                break;
+        }
+        return total;
+    }
+};
+
+class ReaderMetrics
+{
+public:
+    static constexpr size_t MaxCommands = 40;
+    static constexpr size_t MaxTechs = 5; // DiscoveryScheduler::TechCount, same order
+    static constexpr size_t Modes = 2;    // indexed by DiscoveryMode
+
+    struct CommandStats
+    {
+        std::atomic<uint16_t> cmdId{0}; // request id; 0 = unused slot
+        RttHistogram rtt;
+        std::atomic<uint32_t> failures{0};
+    };
+
+    // Per poll technology, indexed like DiscoveryScheduler.
+    struct TechStats
+    {
+        std::atomic<uint32_t> polls{0};    // discovery runs that polled it
+        std::atomic<uint32_t> hits{0};     // runs that found a tag of it
+        std::atomic<uint32_t> rfTimeMs{0}; // estimated field time spent polling it
+    };
+
+    enum DiscoveryMode : uint8_t
+    {
+        ModePolling = 0, // plain rfalNfcDiscover rounds
+        ModeWakeUp = 1,  // rfalNfcDiscover with wake-up mode while the antenna is empty
+    };
+
+    struct ModeStats
+    {
+        RttHistogram activationLatency;    // run start (wake-up: the wake-up) to Activated, arrivals only
+        std::atomic<uint32_t> timeMs{0};   // wall time spent in the mode
+        std::atomic<uint32_t> rfTimeMs{0}; // estimated field-on time in the mode
+    };
+
+    struct Snapshot
+    {
+        uint32_t framesTx;
+        uint32_t framesRx;
+        uint32_t bytesTx;
+        uint32_t bytesRx;
+        uint32_t resyncBytes;
+        uint32_t resyncOverflows;
+        uint32_t timeouts;
+        uint32_t badLength;
+        uint32_t truncatedPayloads;
+        uint32_t unexpectedCmd;
+        uint32_t badDeviceRecords;
+        uint32_t cycles;
+        uint32_t cycleRateMilliHz;
+        uint32_t baudRate;
+        uint32_t baudProbeFailures;
+        uint32_t discoveries;
+        uint32_t presenceChecks;
+        uint32_t presenceCheckMisses;
+        uint32_t wakeups;
+        uint32_t falseWakeups;
+        uint32_t wakeupCalibrations;
+        uint32_t rfo;
+        uint32_t antennaAmplitude;
+        uint32_t antennaPhase;
+        uint32_t dpoPhase;
+        uint32_t dpoSamples;
+        uint32_t dpoTableEntries;
+        uint32_t analogConfigSkips;
+        uint32_t analogConfigWrites;
+        uint32_t warmStarts;
+        uint32_t coldStarts;
+        uint32_t startupMs;
+        uint32_t firstDetectMs;
+        uint32_t linkDown;
+        uint32_t linkRecoveries;
+        uint32_t recoverySteps;
+        uint32_t lastRecoveryMs;
+        uint32_t maxRecoveryMs;
+        uint32_t lastRecoveryDetectMs;
+    };
+
+    // Transport counters
+    std::atomic<uint32_t> framesTx{0};
+    std::atomic<uint32_t> framesRx{0};
+    std::atomic<uint32_t> bytesTx{0};
+    std::atomic<uint32_t> bytesRx{0};
+    std::atomic<uint32_t> resyncBytes{0};
+    std::atomic<uint32_t> resyncOverflows{0};
+    std::atomic<uint32_t> timeouts{0};
+    std::atomic<uint32_t> badLength{0};
+    std::atomic<uint32_t> truncatedPayloads{0};
+    std::atomic<uint32_t> unexpectedCmd{0};
+    std::atomic<uint32_t> badDeviceRecords{0}; // GetDevicesFound entries that do not fit the flat layout
+
+    // Presence loop
+    std::atomic<uint32_t> cycles{0};
+    std::atomic<uint32_t> cycleRateMilliHz{0};
+
+    // Presence
+    std::atomic<uint32_t> discoveries{0};         // rfalNfcDiscover runs started
+    std::atomic<uint32_t> presenceChecks{0};      // per-tech poller presence checks
+    std::atomic<uint32_t> presenceCheckMisses{0}; // confirm cycles that fell back to discovery
+    std::atomic<uint32_t> wakeups{0};             // wake-up mode left with a measurement trigger
+    std::atomic<uint32_t> falseWakeups{0};        // wake-ups that went back to sleep without a tag
+    std::atomic<uint32_t> wakeupCalibrations{0};
+
+    // Antenna
+    std::atomic<uint32_t> rfo{0};              // RFO in use after rfalNfcInitialize
+    std::atomic<uint32_t> antennaAmplitude{0}; // measured after rfalNfcInitialize
+    std::atomic<uint32_t> antennaPhase{0};
+    std::atomic<uint32_t> dpoPhase{0};        // 0 off, 1 collecting, 2 validating, 3 active, 4 rejected
+    std::atomic<uint32_t> dpoSamples{0};
+    std::atomic<uint32_t> dpoTableEntries{0}; // entries of the enabled DPO table, 0 = fixed RFO
+
+    // Analog configuration
+    std::atomic<uint32_t> analogConfigSkips{0};  // syncs settled by the config hash alone
+    std::atomic<uint32_t> analogConfigWrites{0}; // rfalAnalogConfigListWriteRaw sent
+
+    // Startup
+    std::atomic<uint32_t> warmStarts{0};    // running discoveries adopted by startDiscovery()
+    std::atomic<uint32_t> coldStarts{0};    // rfalNfcInitialize + rfalNfcDiscover
+    std::atomic<uint32_t> startupMs{0};     // begin() to discovery running, last start
+    std::atomic<uint32_t> firstDetectMs{0}; // begin() to the first tag, last start
+
+    // Link supervisor
+    std::atomic<uint32_t> linkDown{0};       // 1 while recovering
+    std::atomic<uint32_t> linkRecoveries{0};
+    std::atomic<uint32_t> recoverySteps{0};  // steps attempted, successful or not
+    std::atomic<uint32_t> lastRecoveryMs{0}; // unhealthy to verified, last recovery
+    std::atomic<uint32_t> maxRecoveryMs{0};
+    std::atomic<uint32_t> lastRecoveryDetectMs{0}; // unhealthy to a tracked tag seen again, last recovery
+
+    // Link
+    std::atomic<uint32_t> baudRate{0};          // rate in use after begin()
+    std::atomic<uint32_t> baudProbeFailures{0}; // candidate rates that did not answer SysPing
+
+    CommandStats* command(uint16_t cmdId)
+    {
+        for (size_t i = 0; i < MaxCommands; ++i)
+        {
+            uint16_t id = _commands[i].cmdId.load(std::memory_order_acquire);
+            if (id == cmdId)
+                return &_commands[i];
+            if (id == 0)
+            {
+                uint16_t expected = 0;
+                if (_commands[i].cmdId.compare_exchange_strong(expected, cmdId, std::memory_order_acq_rel) ||
+                    expected == cmdId)
+                {
+                    return &_commands[i];
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    void snapshot(Snapshot& out) const
+    {
+        out.framesTx = framesTx.load(std::memory_order_relaxed);
+        out.framesRx = framesRx.load(std::memory_order_relaxed);
+        out.bytesTx = bytesTx.load(std::memory_order_relaxed);
+        out.bytesRx = bytesRx.load(std::memory_order_relaxed);
+        out.resyncBytes = resyncBytes.load(std::memory_order_relaxed);
+        out.resyncOverflows = resyncOverflows.load(std::memory_order_relaxed);
+        out.timeouts = timeouts.load(std::memory_order_relaxed);
+        out.badLength = badLength.load(std::memory_order_relaxed);
+        out.truncatedPayloads = truncatedPayloads.load(std::memory_order_relaxed);
+        out.unexpectedCmd = unexpectedCmd.load(std::memory_order_relaxed);
+        out.badDeviceRecords = badDeviceRecords.load(std::memory_order_relaxed);
+        out.cycles = cycles.load(std::memory_order_relaxed);
+        out.cycleRateMilliHz = cycleRateMilliHz.load(std::memory_order_relaxed);
+        out.baudRate = baudRate.load(std::memory_order_relaxed);
+        out.baudProbeFailures = baudProbeFailures.load(std::memory_order_relaxed);
+        out.discoveries = discoveries.load(std::memory_order_relaxed);
+        out.presenceChecks = presenceChecks.load(std::memory_order_relaxed);
+        out.presenceCheckMisses = presenceCheckMisses.load(std::memory_order_relaxed);
+        out.wakeups = wakeups.load(std::memory_order_relaxed);
+        out.falseWakeups = falseWakeups.load(std::memory_order_relaxed);
+        out.wakeupCalibrations = wakeupCalibrations.load(std::memory_order_relaxed);
+        out.rfo = rfo.load(std::memory_order_relaxed);
+        out.antennaAmplitude = antennaAmplitude.load(std::memory_order_relaxed);
+        out.antennaPhase = antennaPhase.load(std::memory_order_relaxed);
+        out.dpoPhase = dpoPhase.load(std::memory_order_relaxed);
+        out.dpoSamples = dpoSamples.load(std::memory_order_relaxed);
+        out.dpoTableEntries = dpoTableEntries.load(std::memory_order_relaxed);
+        out.analogConfigSkips = analogConfigSkips.load(std::memory_order_relaxed);
+        out.analogConfigWrites = analogConfigWrites.load(std::memory_order_relaxed);
+        out.warmStarts = warmStarts.load(std::memory_order_relaxed);
+        out.coldStarts = coldStarts.load(std::memory_order_relaxed);
+        out.startupMs = startupMs.load(std::memory_order_relaxed);
+        out.firstDetectMs = firstDetectMs.load(std::memory_order_relaxed);
+        out.linkDown = linkDown.load(std::memory_order_relaxed);
+        out.linkRecoveries = linkRecoveries.load(std::memory_order_relaxed);
+        out.recoverySteps = recoverySteps.load(std::memory_order_relaxed);
+        out.lastRecoveryMs = lastRecoveryMs.load(std::memory_order_relaxed);
+        out.maxRecoveryMs = maxRecoveryMs.load(std::memory_order_relaxed);
+        out.lastRecoveryDetectMs = lastRecoveryDetectMs.load(std::memory_order_relaxed);
+    }
+
+    const CommandStats& commandAt(size_t i) const
+    {
+        return _commands[i];
+    }
+
+    TechStats& tech(size_t i)
+    {
+        return _techs[i];
+    }
+
+    const TechStats& techAt(size_t i) const
+    {
+        return _techs[i];
+    }
+
+    ModeStats& mode(size_t i)
+    {
+        return _modes[i];
+    }
+
+    const ModeStats& modeAt(size_t i) const
+    {
+        return _modes[i];
+    }
+
+    void countCycle()
+    {
+        uint32_t n = cycles.fetch_add(1, std::memory_order_relaxed) + 1;
+        unsigned long now = millis();
+        unsigned long elapsed = now - _rateWindowStartMs;
+        if (elapsed >= 1000)
+        {
+            uint32_t done = n - _rateWindowCycles;
+            cycleRateMilliHz.store(static_cast<uint32_t>((static_cast<uint64_t>(done) * 1000000ULL) / elapsed),
+                                   std::memory_order_relaxed);
+            _rateWindowStartMs = now;
+            _rateWindowCycles = n;
+        }
+    }
+
+private:
+    CommandStats _commands[MaxCommands];
+    TechStats _techs[MaxTechs];
+    ModeStats _modes[Modes];
+    unsigned long _rateWindowStartMs = 0;
+    uint32_t _rateWindowCycles = 0;
+};
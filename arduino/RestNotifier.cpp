@@ -16,8 +16,11 @@ void RestNotifier::post(const char* endpoint, const String& uid, Stream& logStre
     client.setTimeout(_config.timeoutMs);
 
     unsigned long start = millis();
+    unsigned long startUs = micros();
+    _metrics.posts.fetch_add(1, std::memory_order_relaxed);
     if (!client.connect(_config.host, _config.port))
     {
+        _metrics.connectFailures.fetch_add(1, std::memory_order_relaxed);
         if (logLevel >= 1)
         {
             logStream.print("HTTP connect failed to ");
@@ -52,6 +55,9 @@ void RestNotifier::post(const char* endpoint, const String& uid, Stream& logStre
         }
         delay(1);
     }
+    if (client.connected())
+        _metrics.timeouts.fetch_add(1, std::memory_order_relaxed);
+    _metrics.latency.record(micros() - startUs);
 
     if (logLevel >= 2)
     {
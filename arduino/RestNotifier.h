@@ -2,6 +2,16 @@
 
 #include <Arduino.h>
 #include <Ethernet.h>
+#include "ReaderMetrics.h"
+
+// POST outcome counters; updated by whichever reader thread posts, read lock-free by the metrics server.
+struct RestMetrics
+{
+    std::atomic<uint32_t> posts{0};
+    std::atomic<uint32_t> connectFailures{0};
+    std::atomic<uint32_t> timeouts{0}; // server did not close the connection within timeoutMs
+    RttHistogram latency;
+};
 
 struct RestConfig
 {
@@ -19,11 +29,16 @@ public:
     {
     }
 
-    void postPlaced(const String& uid, Stream& logStream, uint8_t logLevel);
-    void postRemoved(const String& uid, Stream& logStream, uint8_t logLevel);
+    virtual ~RestNotifier() = default;
+
+    virtual void postPlaced(const String& uid, Stream& logStream, uint8_t logLevel);
+    virtual void postRemoved(const String& uid, Stream& logStream, uint8_t logLevel);
+
+    const RestMetrics& metrics() const { return _metrics; }
 
 private:
     void post(const char* endpoint, const String& uid, Stream& logStream, uint8_t logLevel);
 
     RestConfig _config;
+    RestMetrics _metrics;
 };
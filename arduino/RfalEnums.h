@@ -93,7 +93,7 @@ namespace Rfal
         PollAp2p = 15,
     };
 
-    enum NfcDeactivateType : uint32_t
+    enum class NfcDeactivateType : uint32_t
     {
         Idle = 0,
         Sleep = 1,
@@ -125,7 +125,7 @@ namespace Rfal
         Iso = 2,
     };
 
-    enum NfcPollTech : uint16_t
+    enum class NfcPollTech : uint16_t
     {
         None = 0x0000,
         A = 0x0001,
@@ -143,6 +143,47 @@ namespace Rfal
 
     constexpr uint8_t NfcvUidLength = 8;
 
+    // rfal14443AShortFrameCmd / rfalNfcbSensCmd / rfalNfcbSlots values used by the presence checks
+    constexpr uint32_t NfcaCmdWupa = 0x52;
+    constexpr uint32_t NfcbSensCmdAllbReq = 0x08;
+    constexpr uint32_t NfcbSlotNum1 = 0x00;
+
+    // SysDpoSetAdjustMethod / SysDpoSetMeasureMethod arguments: step the RFO driver resistance,
+    // compare against the antenna amplitude (the firmware defaults).
+    constexpr uint32_t DpoAdjustRfo = 0;
+    constexpr uint32_t DpoMeasureAmplitude = 0;
+
+    // SysGetConfigHashes configID of the analog configuration table.
+    constexpr uint8_t ConfigIdAnalog = 0;
+
+    // Prefix of a tech-tagged UID ("V:E0040150...") for a Listen* device type.
+    inline const char* TechTag(uint32_t devType)
+    {
+        switch (devType)
+        {
+            case ListenNfca: return "A";
+            case ListenNfcb: return "B";
+            case ListenNfcf: return "F";
+            case ListenNfcv: return "V";
+            case ListenSt25tb: return "TB";
+            default: return "?";
+        }
+    }
+
+    // Poller technology bit that discovers a Listen* device type (None for anything else).
+    inline NfcPollTech PollTechFor(uint32_t devType)
+    {
+        switch (devType)
+        {
+            case ListenNfca: return NfcPollTech::A;
+            case ListenNfcb: return NfcPollTech::B;
+            case ListenNfcf: return NfcPollTech::F;
+            case ListenNfcv: return NfcPollTech::V;
+            case ListenSt25tb: return NfcPollTech::St25tb;
+            default: return NfcPollTech::None;
+        }
+    }
+
     inline const char* DescribeReturnCode(uint16_t value)
     {
         switch (value)
@@ -245,9 +286,84 @@ namespace Rfal
 
 enum class SerCommandId : uint16_t
 {
+    SysPingReq = 0xF000,
+    RfalAdjustRegulatorsReq = 0x1004,
+    RfalFieldOnAndStartGTReq = 0x1012,
+    RfalFieldOffReq = 0x1014,
+    RfalNfcaPollerInitializeReq = 0x1030,
+    RfalNfcaPollerCheckPresenceReq = 0x1032,
+    RfalNfcbPollerInitializeReq = 0x1050,
+    RfalNfcbPollerCheckPresenceReq = 0x1054,
+    RfalNfcfPollerInitializeReq = 0x1070,
+    RfalNfcfPollerCheckPresenceReq = 0x1074,
+    RfalNfcvPollerInitializeReq = 0x1096,
+    RfalNfcvPollerCheckPresenceReq = 0x1098,
+    RfalSt25tbPollerInitializeReq = 0x10D0,
+    RfalSt25tbPollerCheckPresenceReq = 0x10D2,
+    RfalAnalogConfigListWriteRawReq = 0x1142,
+    RfalAnalogConfigListReadRawReq = 0x1144,
+    RfalDpoTableWriteReq = 0x1152,
+    RfalDpoSetEnableReq = 0x1156,
+    RfalChipReadRegReq = 0x1162,
+    RfalChipSetRFOReq = 0x116E,
+    RfalChipGetRFOReq = 0x1170,
+    RfalChipMeasureAmplitudeReq = 0x1172,
+    RfalChipMeasurePhaseReq = 0x1174,
+    RfalWakeUpModeStartReq = 0x1190,
+    RfalWakeUpModeGetInfoReq = 0x1194,
+    RfalWakeUpModeStopReq = 0x1196,
     RfalNfcInitializeReq = 0x2000,
     RfalNfcDiscoverReq = 0x2002,
     RfalNfcGetStateReq = 0x2004,
     RfalNfcGetDevicesReq = 0x2006,
     RfalNfcDeactivateReq = 0x2010,
+    SysGetVersionReq = 0xF002,
+    SysGetConfigHashesReq = 0xF004,
+    SysNfcResetReq = 0xF016,
+    SysDpoSetAdjustMethodReq = 0xF018,
+    SysDpoSetMeasureMethodReq = 0xF01A,
 };
+
+inline const char* DescribeCommand(uint16_t cmdId)
+{
+    switch (static_cast<SerCommandId>(cmdId))
+    {
+        case SerCommandId::SysPingReq: return "sysPing";
+        case SerCommandId::RfalAdjustRegulatorsReq: return "rfalAdjustRegulators";
+        case SerCommandId::RfalFieldOnAndStartGTReq: return "rfalFieldOnAndStartGT";
+        case SerCommandId::RfalFieldOffReq: return "rfalFieldOff";
+        case SerCommandId::RfalNfcaPollerInitializeReq: return "rfalNfcaPollerInitialize";
+        case SerCommandId::RfalNfcaPollerCheckPresenceReq: return "rfalNfcaPollerCheckPresence";
+        case SerCommandId::RfalNfcbPollerInitializeReq: return "rfalNfcbPollerInitialize";
+        case SerCommandId::RfalNfcbPollerCheckPresenceReq: return "rfalNfcbPollerCheckPresence";
+        case SerCommandId::RfalNfcfPollerInitializeReq: return "rfalNfcfPollerInitialize";
+        case SerCommandId::RfalNfcfPollerCheckPresenceReq: return "rfalNfcfPollerCheckPresence";
+        case SerCommandId::RfalNfcvPollerInitializeReq: return "rfalNfcvPollerInitialize";
+        case SerCommandId::RfalNfcvPollerCheckPresenceReq: return "rfalNfcvPollerCheckPresence";
+        case SerCommandId::RfalSt25tbPollerInitializeReq: return "rfalSt25tbPollerInitialize";
+        case SerCommandId::RfalSt25tbPollerCheckPresenceReq: return "rfalSt25tbPollerCheckPresence";
+        case SerCommandId::RfalAnalogConfigListWriteRawReq: return "rfalAnalogConfigListWriteRaw";
+        case SerCommandId::RfalAnalogConfigListReadRawReq: return "rfalAnalogConfigListReadRaw";
+        case SerCommandId::RfalDpoTableWriteReq: return "rfalDpoTableWrite";
+        case SerCommandId::RfalDpoSetEnableReq: return "rfalDpoSetEnable";
+        case SerCommandId::RfalChipReadRegReq: return "rfalChipReadReg";
+        case SerCommandId::RfalChipSetRFOReq: return "rfalChipSetRFO";
+        case SerCommandId::RfalChipGetRFOReq: return "rfalChipGetRFO";
+        case SerCommandId::RfalChipMeasureAmplitudeReq: return "rfalChipMeasureAmplitude";
+        case SerCommandId::RfalChipMeasurePhaseReq: return "rfalChipMeasurePhase";
+        case SerCommandId::RfalWakeUpModeStartReq: return "rfalWakeUpModeStart";
+        case SerCommandId::RfalWakeUpModeGetInfoReq: return "rfalWakeUpModeGetInfo";
+        case SerCommandId::RfalWakeUpModeStopReq: return "rfalWakeUpModeStop";
+        case SerCommandId::RfalNfcInitializeReq: return "rfalNfcInitialize";
+        case SerCommandId::RfalNfcDiscoverReq: return "rfalNfcDiscover";
+        case SerCommandId::RfalNfcGetStateReq: return "rfalNfcGetState";
+        case SerCommandId::RfalNfcGetDevicesReq: return "rfalNfcGetDevicesFound";
+        case SerCommandId::RfalNfcDeactivateReq: return "rfalNfcDeactivate";
+        case SerCommandId::SysGetVersionReq: return "sysGetVersion";
+        case SerCommandId::SysGetConfigHashesReq: return "sysGetConfigHashes";
+        case SerCommandId::SysNfcResetReq: return "sysNfcReset";
+        case SerCommandId::SysDpoSetAdjustMethodReq: return "sysDpoSetAdjustMethod";
+        case SerCommandId::SysDpoSetMeasureMethodReq: return "sysDpoSetMeasureMethod";
+        default: return "unknown";
+    }
+}
@@ -4,6 +4,21 @@
 
 #include "St25r200Reader.h"
 #include "RestNotifier.h"
+#include "MetricsServer.h"
+#include "ThreadStack.h"
+
+// === Capture replay (set to 1 and provide ReplayCapture.h defining `const char kReplayCapture[]`) ===
+#define ST25_REPLAY 0
+#if ST25_REPLAY
+#include "CaptureReplay.h"
+#include "ReplayCapture.h"
+#endif
+
+// === Link benchmark (set to 1 to flood reader A with SysPing/ChipReadReg and print the results) ===
+#define ST25_BENCHMARK 0
+
+// === Antenna calibration (set to 1, put the reference tag on each antenna, read the log, set back to 0) ===
+#define ST25_CALIBRATE 0
 
 using rtos::Thread;
 
@@ -22,31 +37,49 @@ RestConfig restConfig = {
 
 RestNotifier notifier(restConfig);
 
-St25r200Reader::Options readerAOptions = {
-    &Serial1,
-    115200,
-    400,
-    400,
-    75,
-    4,
-    St25r200Reader::LogFrames,
-};
+// Prometheus scrape endpoint: http://<kLocalIp>:9100/metrics
+constexpr uint16_t kMetricsPort = 9100;
 
-St25r200Reader::Options readerBOptions = {
-    &Serial2,
-    115200,
-    400,
-    400,
-    75,
-    4,
-    St25r200Reader::LogFrames,
-};
+// Candidate link rates, fastest first; Options::baudRate is the fallback.
+const uint32_t kProbeBaudRates[] = { 921600, 460800, 230400, 115200 };
+
+// Reader options by name, starting from the Options defaults in St25r200Reader.h; set here only
+// what differs per reader or from a default.
+St25r200Reader::Options makeReaderOptions(HardwareSerial* serial, const char* calibrationKey,
+                                          const char* analogConfigKey)
+{
+    St25r200Reader::Options o{};
+    o.serial = serial;
+    o.logLevel = St25r200Reader::LogFrames;
+    o.probeBaudRates = kProbeBaudRates;
+    o.probeBaudRateCount = sizeof(kProbeBaudRates) / sizeof(kProbeBaudRates[0]);
+    o.pollTechs = static_cast<uint16_t>(Rfal::NfcPollTech::V);
+    o.wakeupMode = false;
+    o.dpoTuning = false;
+    o.calibrationKey = calibrationKey;
+    o.analogConfigKey = analogConfigKey;
+    o.warmStart = true;
+    return o;
+}
+
+St25r200Reader::Options readerAOptions = makeReaderOptions(&Serial1, "/kv/st25_cal_A", "/kv/st25_acfg_A");
+St25r200Reader::Options readerBOptions = makeReaderOptions(&Serial2, "/kv/st25_cal_B", "/kv/st25_acfg_B");
 
 St25r200Reader readerA(readerAOptions, notifier, Serial);
 St25r200Reader readerB(readerBOptions, notifier, Serial);
 
-Thread readerAThread;
-Thread readerBThread;
+MetricsServer metricsServer(kMetricsPort, Serial);
+
+// === Thread stacks (static, painted; tune against st25_thread_stack_bytes{kind="max_used"}) ===
+// The reader buffers live in each reader's arena, so a reader stack holds call frames only.
+// Sizes are the mbed default until the high-water marks from a loaded system say otherwise.
+ThreadStack<4096> readerAStack;
+ThreadStack<4096> readerBStack;
+ThreadStack<4096> metricsStack;
+
+Thread readerAThread(osPriorityNormal, readerAStack.size(), readerAStack.memory(), "readerA");
+Thread readerBThread(osPriorityNormal, readerBStack.size(), readerBStack.memory(), "readerB");
+Thread metricsThread(osPriorityBelowNormal, metricsStack.size(), metricsStack.memory(), "metrics");
 
 void readerTaskA()
 {
@@ -60,15 +93,53 @@ void readerTaskB()
     readerB.loop();
 }
 
+void metricsTask()
+{
+    metricsServer.loop();
+}
+
 void setup()
 {
     Serial.begin(115200);
     while (!Serial) { delay(10); }
 
+#if ST25_REPLAY
+    runCaptureReplay(kReplayCapture, ReplayMode::AsFastAsPossible, readerAOptions, Serial);
+    return;
+#endif
+
+#if ST25_BENCHMARK
+    const uint8_t benchReadSizes[] = { 1, 8, 32 };
+    St25r200Reader::BenchmarkOptions bench;
+    bench.readSizes = benchReadSizes;
+    bench.readSizeCount = sizeof(benchReadSizes);
+    bench.sweepBaudRates = true;
+    readerA.begin();
+    readerA.runBenchmark(bench);
+    return;
+#endif
+
+#if ST25_CALIBRATE
+    St25r200Reader::CalibrationOptions cal;
+    readerA.begin();
+    readerA.calibrateAntenna(cal);
+    readerB.begin();
+    readerB.calibrateAntenna(cal);
+    return;
+#endif
+
     Ethernet.begin(kMac, kLocalIp, kGateway, kGateway, kSubnet);
 
+    metricsServer.addReader("A", readerA);
+    metricsServer.addReader("B", readerB);
+    metricsServer.setNotifier(notifier);
+    metricsServer.addThread("readerA", readerAThread, &readerAStack);
+    metricsServer.addThread("readerB", readerBThread, &readerBStack);
+    metricsServer.addThread("metrics", metricsThread, &metricsStack);
+
     readerAThread.start(readerTaskA);
     readerBThread.start(readerTaskB);
+    metricsThread.start(metricsTask);
 }
 
 void loop()
@@ -1,5 +1,43 @@
 #include "St25r200Reader.h"
 
+#include <kvstore_global_api.h>
+
+static_assert(ReaderMetrics::MaxTechs == DiscoveryScheduler::TechCount, "tech stats are indexed like DiscoveryScheduler");
+
+namespace
+{
+    // rfalChipReadReg response (ret u16, length u16, register bytes): the header stays here and the
+    // register bytes go straight to the caller, or are dropped when there is no out buffer.
+    class RegReadSink : public FrameSink
+    {
+    public:
+        RegReadSink(uint8_t* out, size_t outLen) : _out(out), _outLen(outLen) {}
+
+        uint8_t* segment(size_t offset, size_t& len) override
+        {
+            if (offset < sizeof(_head))
+            {
+                if (len > sizeof(_head) - offset)
+                    len = sizeof(_head) - offset;
+                return _head + offset;
+            }
+            size_t at = offset - sizeof(_head);
+            if (!_out || at >= _outLen)
+                return nullptr;
+            if (len > _outLen - at)
+                len = _outLen - at;
+            return _out + at;
+        }
+
+        const uint8_t* head() const { return _head; }
+
+    private:
+        uint8_t _head[4] = {0};
+        uint8_t* _out;
+        size_t _outLen;
+    };
+}
+
 St25r200Reader::St25r200Reader(const Options& options, RestNotifier& notifier, Stream& logStream)
     : _serial(options.serial)
     , _opt(options)
@@ -7,15 +45,806 @@ St25r200Reader::St25r200Reader(const Options& options, RestNotifier& notifier, S
     , _notifier(notifier)
     , _log(logStream)
 {
+    if (_serial && _opt.captureOut)
+    {
+        _recorder.attach(_serial, _opt.captureOut);
+        _serial = &_recorder;
+    }
+
+    LinkSupervisor::Config supervision;
+    supervision.failureLimit = _opt.recoverAfterFailures;
+    supervision.outlierLimit = _opt.recoverAfterOutliers;
+    supervision.outlierFactor = _opt.rttOutlierFactor;
+    supervision.backoffMinMs = _opt.recoveryBackoffMinMs;
+    supervision.backoffMaxMs = _opt.recoveryBackoffMaxMs;
+    _supervisor.configure(supervision);
+}
+
+void St25r200Reader::begin()
+{
+    _startMs = clockMs();
+    if (_serial)
+        openLink();
+}
+
+void St25r200Reader::openLink()
+{
+    uint32_t baudRate = _opt.baudRate;
+    if (_opt.probeBaudRates && _opt.probeBaudRateCount > 0)
+        baudRate = negotiateBaudRate();
+    else
+        _serial->begin(baudRate);
+    _serial->setTimeout(_opt.readTimeoutMs);
+    _metrics.baudRate.store(baudRate, std::memory_order_relaxed);
+}
+
+bool St25r200Reader::superviseLink()
+{
+    LinkSupervisor::Step step = _supervisor.nextStep(clockMs());
+    if (step == LinkSupervisor::Step::None)
+        return !_supervisor.recovering();
+
+    _metrics.linkDown.store(1, std::memory_order_relaxed);
+    _metrics.recoverySteps.fetch_add(1, std::memory_order_relaxed);
+    if (_opt.logLevel >= LogErrors)
+    {
+        _log.print("Link recovery: ");
+        _log.print(LinkSupervisor::stepName(step));
+        _log.print(" (failures=");
+        _log.print(_supervisor.failures());
+        _log.print(" outliers=");
+        _log.print(_supervisor.outliers());
+        _log.println(")");
+    }
+
+    if (!runRecoveryStep(step))
+    {
+        _supervisor.stepFailed(clockMs());
+        return false;
+    }
+
+    uint32_t downMs = _supervisor.recovered(clockMs());
+    _metrics.linkDown.store(0, std::memory_order_relaxed);
+    _metrics.linkRecoveries.fetch_add(1, std::memory_order_relaxed);
+    _metrics.lastRecoveryMs.store(downMs, std::memory_order_relaxed);
+    if (downMs > _metrics.maxRecoveryMs.load(std::memory_order_relaxed))
+        _metrics.maxRecoveryMs.store(downMs, std::memory_order_relaxed);
+    // With tags tracked across the outage, the time until one is seen again is the outage as the
+    // backend sees it: link down, recovery and the first discovery afterwards.
+    _redetectPending = _tracker.count() > 0;
+    _redetectFromMs = clockMs() - downMs;
+    if (_opt.logLevel >= LogErrors)
+    {
+        _log.print("Link recovered after ");
+        _log.print(downMs);
+        _log.print(" ms by ");
+        _log.println(LinkSupervisor::stepName(step));
+    }
+    return true;
+}
+
+bool St25r200Reader::runRecoveryStep(LinkSupervisor::Step step)
+{
+    switch (step)
+    {
+        case LinkSupervisor::Step::Resync:
+            drainInput();
+            break;
+        case LinkSupervisor::Step::Purge:
+        {
+            // A request cut short leaves the device parser waiting for the rest of its frame. Zero
+            // bytes complete it (and are skipped as noise before the next header); whatever the
+            // device answers to the padded frame is dropped.
+            uint8_t pad[32] = {0};
+            size_t longest = _opt.maxRequestPayload > MaxFramePayload ? _opt.maxRequestPayload : MaxFramePayload;
+            for (size_t n = 0; n < 1 + 2 + 2 + longest; n += sizeof(pad))
+                _serial->write(pad, sizeof(pad));
+            delay(ProbeTimeoutMs);
+            drainInput();
+            break;
+        }
+        case LinkSupervisor::Step::Reinitialize:
+            drainInput();
+            break;
+        case LinkSupervisor::Step::NfcReset:
+        {
+            drainInput();
+            uint8_t rsp[8] = {0};
+            size_t rspLen = sizeof(rsp);
+            if (execForRet(SerCommandId::SysNfcResetReq, nullptr, 0, rsp, rspLen) != Rfal::None)
+                return false;
+            break;
+        }
+        case LinkSupervisor::Step::Reopen:
+            _serial->end();
+            openLink();
+            drainInput();
+            break;
+        default:
+            return false;
+    }
+
+    if (!sysPing())
+        return false;
+
+    // The light steps keep a discovery that is still running; the others start from scratch.
+    bool light = step == LinkSupervisor::Step::Resync || step == LinkSupervisor::Step::Purge;
+    initDiscovery(light && _opt.warmStart);
+    return _supervisor.failures() == 0;
+}
+
+uint32_t St25r200Reader::negotiateBaudRate()
+{
+    // The device UART rate is fixed by its firmware, so "negotiation" means finding the candidate
+    // that answers SysPing cleanly. A short timeout keeps a dead rate from stalling startup.
+    uint16_t readTimeoutMs = _opt.readTimeoutMs;
+    _opt.readTimeoutMs = ProbeTimeoutMs;
+    _serial->setTimeout(ProbeTimeoutMs);
+
+    uint32_t chosen = 0;
+    for (uint8_t i = 0; i < _opt.probeBaudRateCount; ++i)
+    {
+        uint32_t rate = _opt.probeBaudRates[i];
+        if (probeBaudRate(rate))
+        {
+            chosen = rate;
+            break;
+        }
+
+        _metrics.baudProbeFailures.fetch_add(1, std::memory_order_relaxed);
+        if (_opt.logLevel >= LogErrors)
+        {
+            _log.print("Baud probe failed at ");
+            _log.println(rate);
+        }
+    }
+    _opt.readTimeoutMs = readTimeoutMs;
+
+    if (chosen == 0)
+    {
+        chosen = _opt.baudRate;
+        _serial->end();
+        _serial->begin(chosen);
+        drainInput();
+    }
+
+    if (_opt.logLevel >= LogErrors)
+    {
+        _log.print("Link baud rate ");
+        _log.println(chosen);
+    }
+    return chosen;
+}
+
+bool St25r200Reader::probeBaudRate(uint32_t baudRate)
+{
+    _serial->end();
+    _serial->begin(baudRate);
+    delay(2);
+    drainInput();
+
+    // The first ping may land while the device is still discarding bytes sent at the previous rate.
+    sysPing();
+    drainInput();
+
+    // Framing errors at a wrong rate show up as garbage bytes before the header or bad lengths.
+    uint32_t garbage = _metrics.resyncBytes.load(std::memory_order_relaxed) +
+                       _metrics.badLength.load(std::memory_order_relaxed);
+    for (uint8_t i = 0; i < _opt.probePings; ++i)
+    {
+        if (!sysPing())
+            return false;
+    }
+    return garbage == _metrics.resyncBytes.load(std::memory_order_relaxed) +
+                          _metrics.badLength.load(std::memory_order_relaxed);
+}
+
+void St25r200Reader::runBenchmark(const BenchmarkOptions& bench)
+{
+    if (!_serial)
+        return;
+
+    uint32_t current = _metrics.baudRate.load(std::memory_order_relaxed);
+    if (!bench.sweepBaudRates || !_opt.probeBaudRates)
+    {
+        benchmarkRates(bench, current);
+        return;
+    }
+
+    uint16_t readTimeoutMs = _opt.readTimeoutMs;
+    for (uint8_t i = 0; i < _opt.probeBaudRateCount; ++i)
+    {
+        uint32_t rate = _opt.probeBaudRates[i];
+        _opt.readTimeoutMs = ProbeTimeoutMs;
+        _serial->setTimeout(ProbeTimeoutMs);
+        bool answers = probeBaudRate(rate);
+        _opt.readTimeoutMs = readTimeoutMs;
+        _serial->setTimeout(readTimeoutMs);
+
+        if (answers)
+        {
+            benchmarkRates(bench, rate);
+        }
+        else
+        {
+            _log.print("bench baud=");
+            _log.print(rate);
+            _log.println(" no answer");
+        }
+    }
+
+    _serial->end();
+    _serial->begin(current);
+    drainInput();
+}
+
+bool St25r200Reader::calibrateAntenna(const CalibrationOptions& cal)
+{
+    if (!_serial || cal.attempts == 0 || cal.rfoWeakest < cal.rfoStrongest)
+        return false;
+
+    rfalNfcInitialize();
+    syncAnalogConfig();
+
+    uint8_t rsp[8] = {0};
+    size_t rspLen = sizeof(rsp);
+    uint16_t ret = execForRet(SerCommandId::RfalAdjustRegulatorsReq, nullptr, 0, rsp, rspLen);
+    uint16_t regulators = (ret == Rfal::None && rspLen >= 4) ? readU16BE(rsp, 2) : 0;
+    _log.print("cal regulators=");
+    _log.println(regulators);
+
+    AntennaCalibration best;
+    bool found = false;
+    for (int rfo = cal.rfoWeakest; rfo >= cal.rfoStrongest; --rfo)
+    {
+        if (!rfalChipSetRFO(static_cast<uint8_t>(rfo)))
+        {
+            _log.print("cal rfo=");
+            _log.print(rfo);
+            _log.println(" rejected");
+            continue;
+        }
+
+        uint8_t amplitude = 0;
+        uint8_t phase = 0;
+        rfalChipMeasure(SerCommandId::RfalChipMeasureAmplitudeReq, amplitude);
+        rfalChipMeasure(SerCommandId::RfalChipMeasurePhaseReq, phase);
+
+        // Field off between attempts so every check powers the reference tag up from cold.
+        RttHistogram rtt;
+        uint8_t successes = 0;
+        for (uint8_t n = 0; n < cal.attempts; ++n)
+        {
+            unsigned long t0 = micros();
+            bool ok = checkTechPresence(cal.devType, nullptr);
+            uint32_t us = micros() - t0;
+            rspLen = sizeof(rsp);
+            execForRet(SerCommandId::RfalFieldOffReq, nullptr, 0, rsp, rspLen);
+            if (ok)
+            {
+                successes++;
+                rtt.record(us);
+            }
+        }
+
+        RttHistogram::Snapshot h;
+        rtt.snapshot(h);
+        uint8_t pct = static_cast<uint8_t>(successes * 100U / cal.attempts);
+        uint32_t meanUs = h.count ? static_cast<uint32_t>(h.sumUs / h.count) : 0;
+
+        _log.print("cal rfo=");
+        _log.print(rfo);
+        _log.print(" amplitude=");
+        _log.print(amplitude);
+        _log.print(" phase=");
+        _log.print(phase);
+        _log.print(" ok=");
+        _log.print(successes);
+        _log.print("/");
+        _log.print(cal.attempts);
+        _log.print(" rttUs mean=");
+        _log.print(meanUs);
+        _log.print(" p99<=");
+        _log.println(RttHistogram::percentileUpperUs(h, 99));
+
+        if (!found && pct >= cal.targetSuccessPct)
+        {
+            found = true;
+            best.rfo = static_cast<uint8_t>(max(static_cast<int>(cal.rfoStrongest), rfo - cal.marginSteps));
+        }
+        if (found && rfo == best.rfo)
+        {
+            best.successPct = pct;
+            best.amplitude = amplitude;
+            best.phase = phase;
+            best.meanRttUs = meanUs;
+        }
+    }
+
+    if (!found)
+    {
+        _log.println("cal failed: no RFO reached the target read rate; check the reference tag and antenna tuning");
+        rfalNfcInitialize();
+        syncAnalogConfig();
+        applyAntennaCalibration();
+        return false;
+    }
+
+    best.magic = AntennaCalibration::Magic;
+    best.regulators = regulators;
+    rfalChipSetRFO(best.rfo);
+    _calibration = best;
+    _metrics.rfo.store(best.rfo, std::memory_order_relaxed);
+    _metrics.antennaAmplitude.store(best.amplitude, std::memory_order_relaxed);
+    _metrics.antennaPhase.store(best.phase, std::memory_order_relaxed);
+
+    int err = _opt.calibrationKey ? kv_set(_opt.calibrationKey, &best, sizeof(best), 0) : 0;
+    _log.print("cal chose rfo=");
+    _log.print(best.rfo);
+    _log.print(" (");
+    _log.print(best.successPct);
+    _log.print("% at amplitude=");
+    _log.print(best.amplitude);
+    _log.print(")");
+    if (!_opt.calibrationKey)
+        _log.println(", not persisted (no calibrationKey)");
+    else if (err != 0)
+    {
+        _log.print(", kv_set failed: ");
+        _log.println(err);
+    }
+    else
+        _log.println(", persisted");
+    return true;
+}
+
+void St25r200Reader::syncAnalogConfig()
+{
+    if (!_opt.analogConfig || _opt.analogConfigLen == 0)
+        return;
+
+    // Same overrides and the device still holds the table we wrote: nothing to read back.
+    uint32_t hashRam = 0;
+    bool hashed = sysGetConfigHashes(Rfal::ConfigIdAnalog, hashRam);
+    if (hashed && analogCacheMatches(hashRam))
+    {
+        _metrics.analogConfigSkips.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // ret u16, configTblSize u16, table. The table is merged in place and written back from the
+    // same buffer, its size going where ret was.
+    size_t rspLen = sizeof(_analogTable);
+    if (execForRet(SerCommandId::RfalAnalogConfigListReadRawReq, nullptr, 0, _analogTable, rspLen) != Rfal::None ||
+        rspLen < 4 || readU16BE(_analogTable, 2) > rspLen - 4)
+    {
+        if (_opt.logLevel >= LogErrors)
+            _log.println("Analog config read-back failed; overrides not applied");
+        return;
+    }
+    size_t len = readU16BE(_analogTable, 2);
+    int changed = AnalogConfig::merge(_analogTable + 4, len, AnalogConfig::MaxTableLen, _opt.analogConfig,
+                                      _opt.analogConfigLen);
+    if (changed < 0)
+    {
+        if (_opt.logLevel >= LogErrors)
+            _log.println("Analog config overrides do not merge (malformed or too large); not applied");
+        return;
+    }
+
+    if (changed > 0)
+    {
+        // rfalAnalogConfigListWriteRaw replaces the whole table, so the merged table goes out in full.
+        if (2 + len > _opt.maxRequestPayload)
+        {
+            if (_opt.logLevel >= LogErrors)
+            {
+                _log.print("Analog config table of ");
+                _log.print(len);
+                _log.println(" bytes exceeds maxRequestPayload; overrides not applied");
+            }
+            return;
+        }
+        size_t ofs = 2;
+        writeU16BE(_analogTable, ofs, static_cast<uint16_t>(len));
+        uint8_t rsp[8] = {0};
+        rspLen = sizeof(rsp);
+        if (execForRet(SerCommandId::RfalAnalogConfigListWriteRawReq, _analogTable + 2, 2 + len, rsp, rspLen) !=
+            Rfal::None)
+        {
+            if (_opt.logLevel >= LogErrors)
+                _log.println("Analog config write failed");
+            return;
+        }
+        _metrics.analogConfigWrites.fetch_add(1, std::memory_order_relaxed);
+        hashed = sysGetConfigHashes(Rfal::ConfigIdAnalog, hashRam);
+
+        if (_opt.logLevel >= LogErrors)
+        {
+            _log.print("Analog config: ");
+            _log.print(changed);
+            _log.print(" entries changed, wrote ");
+            _log.print(len);
+            _log.println(" bytes");
+        }
+    }
+
+    if (!hashed)
+        return;
+    _analogCache.magic = AnalogConfig::Cache::Magic;
+    _analogCache.overridesFingerprint = AnalogConfig::fingerprint(_opt.analogConfig, _opt.analogConfigLen);
+    _analogCache.hashRam = hashRam;
+    if (_opt.analogConfigKey)
+        kv_set(_opt.analogConfigKey, &_analogCache, sizeof(_analogCache), 0);
+}
+
+bool St25r200Reader::analogCacheMatches(uint32_t hashRam)
+{
+    if (!_analogCache.valid() && _opt.analogConfigKey)
+    {
+        AnalogConfig::Cache stored;
+        size_t actual = 0;
+        if (kv_get(_opt.analogConfigKey, &stored, sizeof(stored), &actual) == 0 && actual == sizeof(stored) &&
+            stored.valid())
+        {
+            _analogCache = stored;
+        }
+    }
+    return _analogCache.valid() && _analogCache.hashRam == hashRam &&
+           _analogCache.overridesFingerprint == AnalogConfig::fingerprint(_opt.analogConfig, _opt.analogConfigLen);
+}
+
+bool St25r200Reader::sysGetConfigHashes(uint8_t configId, uint32_t& hashRam)
+{
+    // ret u16, hashOriginal u32, hashFlash u32, hashRAM u32
+    uint8_t rsp[16] = {0};
+    size_t rspLen = sizeof(rsp);
+    if (execForRet(SerCommandId::SysGetConfigHashesReq, &configId, 1, rsp, rspLen) != Rfal::None || rspLen < 14)
+        return false;
+    hashRam = readU32BE(rsp, 10);
+    return true;
+}
+
+void St25r200Reader::applyAntennaCalibration()
+{
+    // rfalNfcInitialize reloads the analog configuration, which resets the RFO.
+    if (!_calibration.valid() && _opt.calibrationKey)
+    {
+        AntennaCalibration stored;
+        size_t actual = 0;
+        if (kv_get(_opt.calibrationKey, &stored, sizeof(stored), &actual) == 0 && actual == sizeof(stored) &&
+            stored.valid())
+        {
+            _calibration = stored;
+        }
+    }
+
+    if (_calibration.valid())
+        rfalChipSetRFO(_calibration.rfo);
+
+    uint8_t rsp[8] = {0};
+    size_t rspLen = sizeof(rsp);
+    if (execForRet(SerCommandId::RfalChipGetRFOReq, nullptr, 0, rsp, rspLen) == Rfal::None && rspLen >= 3)
+        _metrics.rfo.store(rsp[2], std::memory_order_relaxed);
+
+    uint8_t amplitude = 0;
+    uint8_t phase = 0;
+    if (!rfalChipMeasure(SerCommandId::RfalChipMeasureAmplitudeReq, amplitude) ||
+        !rfalChipMeasure(SerCommandId::RfalChipMeasurePhaseReq, phase))
+    {
+        return;
+    }
+    _metrics.antennaAmplitude.store(amplitude, std::memory_order_relaxed);
+    _metrics.antennaPhase.store(phase, std::memory_order_relaxed);
+
+    // A detuned antenna shows up here long before it shows up as slow detection.
+    if (_calibration.valid() && _opt.logLevel >= LogErrors &&
+        abs(static_cast<int>(amplitude) - _calibration.amplitude) > AmplitudeDriftWarn)
+    {
+        _log.print("Antenna amplitude ");
+        _log.print(amplitude);
+        _log.print(" drifted from calibrated ");
+        _log.print(_calibration.amplitude);
+        _log.println("; consider re-running calibrateAntenna()");
+    }
+}
+
+bool St25r200Reader::rfalChipSetRFO(uint8_t rfo)
+{
+    uint8_t rsp[8] = {0};
+    size_t rspLen = sizeof(rsp);
+    return execForRet(SerCommandId::RfalChipSetRFOReq, &rfo, 1, rsp, rspLen) == Rfal::None;
+}
+
+bool St25r200Reader::rfalChipMeasure(SerCommandId cmdId, uint8_t& result)
+{
+    // ret u16, result u8
+    uint8_t rsp[8] = {0};
+    size_t rspLen = sizeof(rsp);
+    if (execForRet(cmdId, nullptr, 0, rsp, rspLen) != Rfal::None || rspLen < 3)
+        return false;
+    result = rsp[2];
+    return true;
+}
+
+void St25r200Reader::startDpo()
+{
+    // rfalNfcInitialize resets the DPO module, so a table on trial or accepted is written again.
+    if (_dpoPhase == DpoPhase::Validating || _dpoPhase == DpoPhase::Active)
+    {
+        if (!writeDpoTable())
+        {
+            if (_opt.logLevel >= LogErrors)
+                _log.println("DPO table could not be restored; using the fixed RFO");
+            setDpoPhase(DpoPhase::Rejected);
+        }
+        return;
+    }
+    if (!_opt.dpoTuning || _dpoPhase != DpoPhase::Off)
+        return;
+
+    // Level 0 is the RFO in use (calibrated or configured); weaker levels are probed from there.
+    uint8_t rsp[8] = {0};
+    size_t rspLen = sizeof(rsp);
+    if (execForRet(SerCommandId::RfalChipGetRFOReq, nullptr, 0, rsp, rspLen) != Rfal::None || rspLen < 3)
+        return;
+    _dpoTuner.begin(rsp[2], _opt.dpoRfoStep, _opt.dpoLevels);
+    _dpoCycles = 0;
+    _dpoChecksMark = _metrics.presenceChecks.load(std::memory_order_relaxed);
+    _dpoMissesMark = _metrics.presenceCheckMisses.load(std::memory_order_relaxed);
+    _metrics.dpoSamples.store(0, std::memory_order_relaxed);
+    setDpoPhase(DpoPhase::Collecting);
+}
+
+void St25r200Reader::setDpoPhase(DpoPhase phase)
+{
+    _dpoPhase = phase;
+    _metrics.dpoPhase.store(static_cast<uint32_t>(phase), std::memory_order_relaxed);
+    bool enabled = phase == DpoPhase::Validating || phase == DpoPhase::Active;
+    _metrics.dpoTableEntries.store(enabled ? _dpoTableCount : 0, std::memory_order_relaxed);
+}
+
+void St25r200Reader::tuneDpo(bool confirmed)
+{
+    if (_dpoPhase == DpoPhase::Collecting)
+    {
+        // One tag only: with two on the antenna the amplitude cannot be attributed to either.
+        if (!confirmed || _tracker.count() != 1 || ++_dpoCycles < _opt.dpoSampleEvery)
+            return;
+        _dpoCycles = 0;
+        sampleDpo();
+        if (_dpoTuner.samples() >= _opt.dpoSamples)
+            finishDpoCollection();
+    }
+    else if (_dpoPhase == DpoPhase::Validating)
+    {
+        // Stop the trial as soon as the misses alone already rule the table out.
+        uint32_t checks = _metrics.presenceChecks.load(std::memory_order_relaxed) - _dpoChecksMark;
+        uint32_t misses = _metrics.presenceCheckMisses.load(std::memory_order_relaxed) - _dpoMissesMark;
+        uint32_t allowedPct = 100U - _dpoBaselinePct + _opt.dpoMaxRateDropPct;
+        if (checks >= _opt.dpoValidateChecks || misses * 100U > _opt.dpoValidateChecks * allowedPct)
+            validateDpo();
+    }
+}
+
+void St25r200Reader::sampleDpo()
+{
+    // Amplitude one level stronger is what the chip compares against dec before stepping down to
+    // this level; amplitude at this level is what it compares against inc before stepping back.
+    uint8_t level = _dpoTuner.nextLevel();
+    uint8_t ampAbove = 0;
+    uint8_t ampAt = 0;
+    bool measured = rfalChipSetRFO(_dpoTuner.rfo(level - 1)) &&
+                    rfalChipMeasure(SerCommandId::RfalChipMeasureAmplitudeReq, ampAbove) &&
+                    rfalChipSetRFO(_dpoTuner.rfo(level)) &&
+                    rfalChipMeasure(SerCommandId::RfalChipMeasureAmplitudeReq, ampAt);
+    bool ok = measured && checkTechPresence(uidDevType(_tracker.uid(0)), &_tracker.uid(0));
+
+    uint8_t rsp[8] = {0};
+    size_t rspLen = sizeof(rsp);
+    execForRet(SerCommandId::RfalFieldOffReq, nullptr, 0, rsp, rspLen);
+    rfalChipSetRFO(_dpoTuner.rfo(0));
+
+    if (!measured)
+        return;
+    _dpoTuner.record(level, ampAbove, ampAt, ok);
+    _metrics.dpoSamples.store(_dpoTuner.samples(), std::memory_order_relaxed);
+    if (_opt.logLevel >= LogFrames)
+    {
+        _log.print("DPO sample level=");
+        _log.print(level);
+        _log.print(" ampAbove=");
+        _log.print(ampAbove);
+        _log.print(" ampAt=");
+        _log.print(ampAt);
+        _log.println(ok ? " ok" : " miss");
+    }
+}
+
+void St25r200Reader::finishDpoCollection()
+{
+    _dpoBaselinePct = presenceReadRatePct(_dpoChecksMark, _dpoMissesMark);
+    _dpoTableCount = _dpoTuner.compute(_opt.dpoTargetPct, _opt.dpoHysteresis, _dpoTable);
+    if (_dpoTableCount < 2)
+    {
+        if (_opt.logLevel >= LogErrors)
+            _log.println("DPO tuning: no weaker level kept the target read rate; using the fixed RFO");
+        setDpoPhase(DpoPhase::Rejected);
+        return;
+    }
+    if (!writeDpoTable())
+    {
+        if (_opt.logLevel >= LogErrors)
+            _log.println("DPO tuning: table write failed; using the fixed RFO");
+        setDpoPhase(DpoPhase::Rejected);
+        return;
+    }
+
+    _dpoChecksMark = _metrics.presenceChecks.load(std::memory_order_relaxed);
+    _dpoMissesMark = _metrics.presenceCheckMisses.load(std::memory_order_relaxed);
+    setDpoPhase(DpoPhase::Validating);
+}
+
+void St25r200Reader::validateDpo()
+{
+    uint8_t ratePct = presenceReadRatePct(_dpoChecksMark, _dpoMissesMark);
+    bool accepted = ratePct + _opt.dpoMaxRateDropPct >= _dpoBaselinePct;
+    if (!accepted)
+    {
+        rfalDpoSetEnable(false);
+        rfalChipSetRFO(_dpoTuner.rfo(0));
+    }
+    setDpoPhase(accepted ? DpoPhase::Active : DpoPhase::Rejected);
+
+    if (_opt.logLevel < LogErrors)
+        return;
+    _log.print(accepted ? "DPO table accepted: read rate " : "DPO table rejected: read rate ");
+    _log.print(ratePct);
+    _log.print("% vs. ");
+    _log.print(_dpoBaselinePct);
+    _log.print("% at fixed RFO; entries");
+    for (uint8_t k = 0; k < _dpoTableCount; ++k)
+    {
+        _log.print(" {rfo=");
+        _log.print(_dpoTable[k].rfoRes);
+        _log.print(" inc=");
+        _log.print(_dpoTable[k].inc);
+        _log.print(" dec=");
+        _log.print(_dpoTable[k].dec);
+        _log.print("}");
+    }
+    _log.println();
+}
+
+bool St25r200Reader::writeDpoTable()
+{
+    // count u8, then count x {rfoRes, inc, dec}
+    uint8_t payload[1 + DpoTuner::MaxEntries * 3];
+    size_t len = 0;
+    payload[len++] = _dpoTableCount;
+    for (uint8_t k = 0; k < _dpoTableCount; ++k)
+    {
+        payload[len++] = _dpoTable[k].rfoRes;
+        payload[len++] = _dpoTable[k].inc;
+        payload[len++] = _dpoTable[k].dec;
+    }
+
+    uint8_t rsp[8] = {0};
+    size_t rspLen = sizeof(rsp);
+    if (execForRet(SerCommandId::RfalDpoTableWriteReq, payload, len, rsp, rspLen) != Rfal::None)
+        return false;
+
+    uint8_t method[4];
+    len = 0;
+    writeU32BE(method, len, Rfal::DpoAdjustRfo);
+    rspLen = sizeof(rsp);
+    if (execForRet(SerCommandId::SysDpoSetAdjustMethodReq, method, len, rsp, rspLen) != Rfal::None)
+        return false;
+    len = 0;
+    writeU32BE(method, len, Rfal::DpoMeasureAmplitude);
+    rspLen = sizeof(rsp);
+    if (execForRet(SerCommandId::SysDpoSetMeasureMethodReq, method, len, rsp, rspLen) != Rfal::None)
+        return false;
+    return rfalDpoSetEnable(true);
+}
+
+bool St25r200Reader::rfalDpoSetEnable(bool enable)
+{
+    uint8_t flag = enable ? 1 : 0;
+    uint8_t rsp[8] = {0};
+    size_t rspLen = sizeof(rsp);
+    return execForRet(SerCommandId::RfalDpoSetEnableReq, &flag, 1, rsp, rspLen) == Rfal::None;
+}
+
+uint8_t St25r200Reader::presenceReadRatePct(uint32_t checksMark, uint32_t missesMark) const
+{
+    uint32_t checks = _metrics.presenceChecks.load(std::memory_order_relaxed) - checksMark;
+    uint32_t misses = _metrics.presenceCheckMisses.load(std::memory_order_relaxed) - missesMark;
+    if (checks == 0)
+        return 0;
+    return static_cast<uint8_t>((checks - misses) * 100ULL / checks);
+}
+
+void St25r200Reader::benchmarkRates(const BenchmarkOptions& bench, uint32_t baudRate)
+{
+    benchmarkStep(baudRate, 0, bench.durationMs);
+    for (uint8_t i = 0; i < bench.readSizeCount; ++i)
+        benchmarkStep(baudRate, bench.readSizes[i], bench.durationMs);
+}
+
+void St25r200Reader::benchmarkStep(uint32_t baudRate, uint8_t readLen, uint16_t durationMs)
+{
+    // readLen 0 = SysPing (empty payloads both ways), otherwise ChipReadReg(0, readLen).
+    size_t reqBytes = readLen == 0 ? 5 : 5 + 3;
+    size_t rspBytes = readLen == 0 ? 5 : 5 + 4 + readLen;
+
+    RttHistogram rtt;
+    uint32_t minUs = UINT32_MAX;
+    uint32_t frames = 0;
+    uint32_t failures = 0;
+
+    unsigned long start = millis();
+    unsigned long startUs = micros();
+    while ((millis() - start) < durationMs)
+    {
+        unsigned long t0 = micros();
+        bool ok = readLen == 0 ? sysPing() : rfalChipReadReg(0, readLen, nullptr);
+        uint32_t us = micros() - t0;
+        if (!ok)
+        {
+            failures++;
+            drainInput();
+            continue;
+        }
+        frames++;
+        rtt.record(us);
+        if (us < minUs)
+            minUs = us;
+    }
+    uint32_t elapsedUs = micros() - startUs;
+
+    RttHistogram::Snapshot h;
+    rtt.snapshot(h);
+    uint32_t meanUs = h.count ? static_cast<uint32_t>(h.sumUs / h.count) : 0;
+    // 10 bits per byte on the wire (8N1), request plus response.
+    uint32_t wireUs = baudRate ? static_cast<uint32_t>((reqBytes + rspBytes) * 10ULL * 1000000ULL / baudRate) : 0;
+    double fps = elapsedUs ? frames * 1000000.0 / elapsedUs : 0.0;
+
+    _log.print("bench baud=");
+    _log.print(baudRate);
+    _log.print(readLen == 0 ? " cmd=sysPing" : " cmd=readReg");
+    _log.print(" req=");
+    _log.print(reqBytes);
+    _log.print(" rsp=");
+    _log.print(rspBytes);
+    _log.print(" frames=");
+    _log.print(frames);
+    _log.print(" fail=");
+    _log.print(failures);
+    _log.print(" fps=");
+    _log.print(fps, 1);
+    _log.print(" rspKBps=");
+    _log.print(fps * rspBytes / 1000.0, 2);
+    _log.print(" rttUs min=");
+    _log.print(frames ? minUs : 0);
+    _log.print(" mean=");
+    _log.print(meanUs);
+    _log.print(" p50<=");
+    _log.print(RttHistogram::percentileUpperUs(h, 50));
+    _log.print(" p99<=");
+    _log.print(RttHistogram::percentileUpperUs(h, 99));
+    _log.print(" max=");
+    _log.print(h.maxUs);
+    _log.print(" wireUs=");
+    _log.print(wireUs);
+    _log.print(" deviceUs=");
+    _log.println(meanUs > wireUs ? meanUs - wireUs : 0);
 }
 
-void St25r200Reader::begin()
+void St25r200Reader::drainInput()
 {
-    if (_serial)
-    {
-        _serial->begin(_opt.baudRate);
-        _serial->setTimeout(_opt.readTimeoutMs);
-    }
+    while (_serial->available() > 0)
+        _serial->read();
 }
 
 void St25r200Reader::loop()
@@ -25,33 +854,508 @@ void St25r200Reader::loop()
         return;
     }
 
-    rfalNfcInitialize();
-    rfalNfcDiscover();
+    startDiscovery();
 
     while (true)
     {
-        uint32_t state = rfalNfcGetState();
-        if (_opt.logLevel >= LogFrames)
+        runCycle();
+        delay(_opt.loopDelayMs);
+    }
+}
+
+void St25r200Reader::startDiscovery()
+{
+    // Startup figures are per begin(); link recoveries restart discovery too and report their own.
+    _firstDetectPending = true;
+    initDiscovery(_opt.warmStart);
+    _metrics.startupMs.store(static_cast<uint32_t>(clockMs() - _startMs), std::memory_order_relaxed);
+}
+
+void St25r200Reader::initDiscovery(bool allowWarm)
+{
+    _phase = Phase::Discovering;
+    _warmStarted = allowWarm && tryWarmStart();
+    if (_warmStarted)
+    {
+        _metrics.warmStarts.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        rfalNfcInitialize();
+        syncAnalogConfig();
+        applyAntennaCalibration();
+        startDpo();
+        _modeTickMs = clockMs();
+        rfalNfcDiscover();
+        _metrics.coldStarts.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool St25r200Reader::tryWarmStart()
+{
+    if (_opt.dpoTuning || !sysPing() || !sysGetVersion())
+        return false;
+    if (_opt.analogConfig && _opt.analogConfigLen > 0)
+    {
+        uint32_t hashRam = 0;
+        if (!sysGetConfigHashes(Rfal::ConfigIdAnalog, hashRam) || !analogCacheMatches(hashRam))
+            return false;
+    }
+
+    uint32_t state = rfalNfcGetState();
+    switch (state)
+    {
+        case Rfal::NfcState::StartDiscovery:
+        case Rfal::NfcState::WakeupMode:
+        case Rfal::NfcState::PollTechDetect:
+        case Rfal::NfcState::PollColAvoidance:
+        case Rfal::NfcState::PollSelect:
+        case Rfal::NfcState::PollActivation:
+        case Rfal::NfcState::Activated:
+            break;
+        default:
+            return false;
+    }
+
+    // The running discovery's parameters are not readable: account it as polling every configured
+    // technology until the next re-plan. A wake-up run keeps going but is re-calibrated before the
+    // next one, since its thresholds are unknown here.
+    unsigned long nowMs = clockMs();
+    _phase = Phase::Discovering;
+    _discoverTechs = _opt.pollTechs;
+    _discoverStartMs = nowMs;
+    _activationFromMs = nowMs;
+    _modeTickMs = nowMs;
+    _wakeupRun = state == Rfal::NfcState::WakeupMode;
+    _asleep = _wakeupRun;
+
+    uint8_t rsp[8] = {0};
+    size_t rspLen = sizeof(rsp);
+    if (execForRet(SerCommandId::RfalChipGetRFOReq, nullptr, 0, rsp, rspLen) == Rfal::None && rspLen >= 3)
+        _metrics.rfo.store(rsp[2], std::memory_order_relaxed);
+
+    if (_opt.logLevel >= LogErrors)
+    {
+        _log.print("Warm start: adopted running discovery (");
+        _log.print(Rfal::DescribeState(state));
+        _log.println(")");
+    }
+    return true;
+}
+
+void St25r200Reader::runCycle()
+{
+    _metrics.countCycle();
+    accountModeTime(clockMs());
+    if (!superviseLink())
+        return;
+
+    if (_phase == Phase::Confirming)
+    {
+        if (confirmPresence() && ++_confirmCycles < _opt.fullDiscoveryEvery)
+            return;
+
+        _phase = Phase::Discovering;
+        rfalNfcDiscover();
+        return;
+    }
+
+    uint32_t state = rfalNfcGetState();
+    if (_opt.logLevel >= LogFrames)
+    {
+        _log.print("State=0x");
+        _log.print(state, HEX);
+        _log.print(" ");
+        _log.println(Rfal::DescribeState(state));
+    }
+    if (_wakeupRun)
+        trackWakeUp(state);
+
+    unsigned long nowMs = clockMs();
+    if (state == Rfal::NfcState::Activated)
+    {
+        String uids[4];
+        size_t uidCount = 0;
+        uint16_t techHits = 0;
+        rfalNfcGetDevicesFound(uids, uidCount, techHits);
+        if (_tracker.count() == 0 && uidCount > 0)
         {
-            _log.print("State=0x");
-            _log.print(state, HEX);
-            _log.print(" ");
-            _log.println(Rfal::DescribeState(state));
+            ReaderMetrics::DiscoveryMode mode = _wakeupRun ? ReaderMetrics::ModeWakeUp : ReaderMetrics::ModePolling;
+            _metrics.mode(mode).activationLatency.record(static_cast<uint32_t>((nowMs - _activationFromMs) * 1000UL));
+        }
+        if (_firstDetectPending && uidCount > 0)
+        {
+            _firstDetectPending = false;
+            uint32_t ms = static_cast<uint32_t>(nowMs - _startMs);
+            _metrics.firstDetectMs.store(ms, std::memory_order_relaxed);
+            if (_opt.logLevel >= LogErrors)
+            {
+                _log.print("First detection ");
+                _log.print(ms);
+                _log.println(_warmStarted ? " ms after begin (warm start)" : " ms after begin (cold start)");
+            }
+        }
+        if (_redetectPending && uidCount > 0)
+        {
+            _redetectPending = false;
+            _metrics.lastRecoveryDetectMs.store(static_cast<uint32_t>(nowMs - _redetectFromMs),
+                                                std::memory_order_relaxed);
         }
+        endDiscoveryRun(techHits);
+        publishPresence(uids, uidCount);
 
-        if (state == Rfal::NfcState::Activated)
+        rfalNfcDeactivate(static_cast<uint32_t>(Rfal::NfcDeactivateType::Idle));
+        if (_opt.fullDiscoveryEvery > 0 && _tracker.count() > 0)
+        {
+            _phase = Phase::Confirming;
+            _confirmCycles = 0;
+        }
+        else
         {
-            String uids[4];
-            size_t uidCount = 0;
-            rfalNfcGetDevicesFound(uids, uidCount);
-            publishPresence(uids, uidCount);
+            rfalNfcDiscover();
+        }
+        return;
+    }
+
+    if (_tracker.count() > 0 && (nowMs - _lastSightingMs) > _opt.absentAfterMs)
+    {
+        // Discovery never reaches Activated with an empty field, so absence is a timeout.
+        publishPresence(nullptr, 0);
+        _redetectPending = false; // the tags left during the outage
+    }
+    if (_opt.wakeupMode && !_wakeupUnavailable && (!_wakeupRun || !_wakeupCalibrated) && _tracker.count() == 0 &&
+        (nowMs - _lastSightingMs) > _opt.wakeupAfterEmptyMs)
+    {
+        // Empty antenna: sleep in wake-up mode instead of polling every round.
+        endDiscoveryRun(0);
+        rfalNfcDeactivate(static_cast<uint32_t>(Rfal::NfcDeactivateType::Idle));
+        if (!_wakeupCalibrated)
+            calibrateWakeUp();
+        rfalNfcDiscover(_wakeupCalibrated);
+        return;
+    }
 
+    if (!_wakeupRun && _opt.techRescheduleMs > 0 && (nowMs - _discoverStartMs) > _opt.techRescheduleMs)
+    {
+        // Close the idle run and restart only if the plan for the next one changed.
+        endDiscoveryRun(0);
+        if (_scheduler.next(_opt.pollTechs, _opt.rareTechEvery) != _discoverTechs)
+        {
             rfalNfcDeactivate(static_cast<uint32_t>(Rfal::NfcDeactivateType::Idle));
             rfalNfcDiscover();
         }
+        else
+        {
+            _discoverStartMs = nowMs;
+        }
+    }
+}
 
-        delay(_opt.loopDelayMs);
+void St25r200Reader::endDiscoveryRun(uint16_t hits)
+{
+    // Polling: RFAL repeats the round every totalDuration until a tag answers, so a run of elapsed
+    // ms polled each of its technologies ceil(elapsed / totalDuration) times. Wake-up: the field is
+    // only on for one measurement per period and one polling round per wake-up.
+    unsigned long elapsedMs = clockMs() - _discoverStartMs;
+    uint32_t rounds;
+    uint32_t rfUs = 0;
+    if (_wakeupRun)
+    {
+        rounds = _wakeupsThisRun;
+        rfUs = static_cast<uint32_t>(elapsedMs / WakeUp::periodMs(_wakeupConfig.period)) * WakeUpMeasureCostUs;
+    }
+    else
+    {
+        rounds = static_cast<uint32_t>((elapsedMs + DiscoverTotalDurationMs - 1) / DiscoverTotalDurationMs);
+        if (rounds == 0)
+            rounds = 1;
+    }
+
+    for (size_t i = 0; i < DiscoveryScheduler::TechCount; ++i)
+    {
+        uint16_t bit = DiscoveryScheduler::techBit(i);
+        if ((_discoverTechs & bit) == 0)
+            continue;
+        uint32_t techUs = rounds * DiscoveryScheduler::pollCostUs(i);
+        rfUs += techUs;
+        ReaderMetrics::TechStats& stats = _metrics.tech(i);
+        stats.polls.fetch_add(1, std::memory_order_relaxed);
+        stats.rfTimeMs.fetch_add(techUs / 1000, std::memory_order_relaxed);
+        if (hits & bit)
+            stats.hits.fetch_add(1, std::memory_order_relaxed);
+    }
+    ReaderMetrics::DiscoveryMode mode = _wakeupRun ? ReaderMetrics::ModeWakeUp : ReaderMetrics::ModePolling;
+    _metrics.mode(mode).rfTimeMs.fetch_add(rfUs / 1000, std::memory_order_relaxed);
+    _scheduler.complete(_discoverTechs, hits);
+}
+
+void St25r200Reader::trackWakeUp(uint32_t state)
+{
+    bool asleep = state == Rfal::NfcState::WakeupMode;
+    if (_asleep && !asleep)
+    {
+        _metrics.wakeups.fetch_add(1, std::memory_order_relaxed);
+        _wakeupsThisRun++;
+        _woke = true;
+        _activationFromMs = clockMs();
+    }
+    else if (!_asleep && asleep && _woke)
+    {
+        // Polled after the wake-up and found nothing: noise or drift crossed the threshold.
+        _woke = false;
+        _metrics.falseWakeups.fetch_add(1, std::memory_order_relaxed);
+        if (_opt.wakeupRecalAfterFalse > 0 && ++_falseWakeupsSinceCal >= _opt.wakeupRecalAfterFalse)
+        {
+            _wakeupCalibrated = false;
+            if (_opt.logLevel >= LogErrors)
+                _log.println("Wake-up: too many false wake-ups, re-calibrating");
+        }
+    }
+    _asleep = asleep;
+}
+
+void St25r200Reader::accountModeTime(unsigned long nowMs)
+{
+    ReaderMetrics::DiscoveryMode mode = _wakeupRun ? ReaderMetrics::ModeWakeUp : ReaderMetrics::ModePolling;
+    _metrics.mode(mode).timeMs.fetch_add(static_cast<uint32_t>(nowMs - _modeTickMs), std::memory_order_relaxed);
+    _modeTickMs = nowMs;
+}
+
+bool St25r200Reader::calibrateWakeUp()
+{
+    // Measure the empty antenna and put each channel's wake-up delta just above the noise it shows,
+    // so a tag detuning the antenna wakes the reader and noise does not. The reference stays
+    // automatic (with auto-averaging) so slow drift does not need a re-calibration.
+    WakeUp::Config cfg;
+    cfg.period = _opt.wakeupPeriod;
+
+    uint8_t payload[WakeUp::Config::WireSize] = {0};
+    cfg.write(payload);
+    uint8_t rsp[32] = {0};
+    size_t rspLen = sizeof(rsp);
+    uint16_t ret = execForRet(SerCommandId::RfalWakeUpModeStartReq, payload, sizeof(payload), rsp, rspLen);
+
+    uint8_t minI = 0xFF, maxI = 0, minQ = 0xFF, maxQ = 0;
+    uint8_t samples = 0;
+    for (uint8_t n = 0; ret == Rfal::None && n < _opt.wakeupCalSamples; ++n)
+    {
+        delay(WakeUp::periodMs(cfg.period));
+        const uint8_t force = 1;
+        rspLen = sizeof(rsp);
+        WakeUp::Info info;
+        if (execForRet(SerCommandId::RfalWakeUpModeGetInfoReq, &force, 1, rsp, rspLen) != Rfal::None ||
+            !info.parse(rsp + 2, rspLen - 2))
+        {
+            continue;
+        }
+        minI = min(minI, info.i.lastMeas);
+        maxI = max(maxI, info.i.lastMeas);
+        minQ = min(minQ, info.q.lastMeas);
+        maxQ = max(maxQ, info.q.lastMeas);
+        samples++;
+    }
+
+    if (ret == Rfal::None)
+    {
+        rspLen = sizeof(rsp);
+        execForRet(SerCommandId::RfalWakeUpModeStopReq, nullptr, 0, rsp, rspLen);
+    }
+
+    if (samples < 2)
+    {
+        _wakeupUnavailable = true;
+        if (_opt.logLevel >= LogErrors)
+        {
+            _log.print("Wake-up calibration failed (ret=0x");
+            _log.print(ret, HEX);
+            _log.print(", samples=");
+            _log.print(samples);
+            _log.println("), staying in polling mode");
+        }
+        return false;
+    }
+
+    int deltaI = maxI - minI + WakeUpDeltaMargin;
+    int deltaQ = maxQ - minQ + WakeUpDeltaMargin;
+    cfg.i.delta = static_cast<uint8_t>(deltaI < WakeUpMinDelta ? WakeUpMinDelta : min(deltaI, 0xFF));
+    cfg.q.delta = static_cast<uint8_t>(deltaQ < WakeUpMinDelta ? WakeUpMinDelta : min(deltaQ, 0xFF));
+    _wakeupConfig = cfg;
+    _wakeupCalibrated = true;
+    _falseWakeupsSinceCal = 0;
+    _metrics.wakeupCalibrations.fetch_add(1, std::memory_order_relaxed);
+
+    if (_opt.logLevel >= LogErrors)
+    {
+        _log.print("Wake-up calibrated: I ");
+        _log.print(minI);
+        _log.print("..");
+        _log.print(maxI);
+        _log.print(" delta=");
+        _log.print(cfg.i.delta);
+        _log.print(", Q ");
+        _log.print(minQ);
+        _log.print("..");
+        _log.print(maxQ);
+        _log.print(" delta=");
+        _log.println(cfg.q.delta);
+    }
+    return true;
+}
+
+bool St25r200Reader::confirmPresence()
+{
+    // One presence check per technology; each must account for exactly one tracked tag, since a
+    // check cannot tell two tags of the same technology apart.
+    uint32_t techs[4];
+    size_t techCount = 0;
+    for (size_t i = 0; i < _tracker.count(); ++i)
+    {
+        uint32_t devType = uidDevType(_tracker.uid(i));
+        for (size_t j = 0; j < techCount; ++j)
+        {
+            if (techs[j] == devType)
+                return false;
+        }
+        techs[techCount++] = devType;
+    }
+
+    bool confirmed = true;
+    for (size_t i = 0; i < _tracker.count() && confirmed; ++i)
+    {
+        _metrics.presenceChecks.fetch_add(1, std::memory_order_relaxed);
+        confirmed = checkTechPresence(techs[i], &_tracker.uid(i));
+    }
+
+    uint8_t rsp[8] = {0};
+    size_t rspLen = sizeof(rsp);
+    execForRet(SerCommandId::RfalFieldOffReq, nullptr, 0, rsp, rspLen);
+
+    if (!confirmed)
+        _metrics.presenceCheckMisses.fetch_add(1, std::memory_order_relaxed);
+    if (_dpoPhase != DpoPhase::Off)
+        tuneDpo(confirmed);
+    if (!confirmed)
+        return false;
+
+    // Same set again: no events, only last-seen times move.
+    String uids[4];
+    size_t uidCount = _tracker.count();
+    for (size_t i = 0; i < uidCount; ++i)
+        uids[i] = _tracker.uid(i);
+    publishPresence(uids, uidCount);
+    return true;
+}
+
+bool St25r200Reader::checkTechPresence(uint32_t devType, const String* uid)
+{
+    uint8_t payload[8] = {0};
+    size_t ofs = 0;
+    uint8_t rsp[32] = {0};
+    size_t rspLen = sizeof(rsp);
+
+    SerCommandId init;
+    SerCommandId check;
+    switch (devType)
+    {
+        case Rfal::NfcDevType::ListenNfca:
+            init = SerCommandId::RfalNfcaPollerInitializeReq;
+            check = SerCommandId::RfalNfcaPollerCheckPresenceReq;
+            writeU32BE(payload, ofs, Rfal::NfcaCmdWupa);
+            break;
+        case Rfal::NfcDevType::ListenNfcb:
+            init = SerCommandId::RfalNfcbPollerInitializeReq;
+            check = SerCommandId::RfalNfcbPollerCheckPresenceReq;
+            writeU32BE(payload, ofs, Rfal::NfcbSensCmdAllbReq);
+            writeU32BE(payload, ofs, Rfal::NfcbSlotNum1);
+            break;
+        case Rfal::NfcDevType::ListenNfcf:
+            init = SerCommandId::RfalNfcfPollerInitializeReq;
+            check = SerCommandId::RfalNfcfPollerCheckPresenceReq;
+            break;
+        case Rfal::NfcDevType::ListenNfcv:
+            init = SerCommandId::RfalNfcvPollerInitializeReq;
+            check = SerCommandId::RfalNfcvPollerCheckPresenceReq;
+            break;
+        case Rfal::NfcDevType::ListenSt25tb:
+            init = SerCommandId::RfalSt25tbPollerInitializeReq;
+            check = SerCommandId::RfalSt25tbPollerCheckPresenceReq;
+            break;
+        default:
+            return false;
+    }
+
+    uint8_t initPayload[4] = {0};
+    size_t initLen = 0;
+    if (devType == Rfal::NfcDevType::ListenNfcf)
+        writeU32BE(initPayload, initLen, Rfal::BitRate::Br212);
+
+    if (execForRet(init, initPayload, initLen, rsp, rspLen) != Rfal::None)
+        return false;
+    rspLen = sizeof(rsp);
+    if (execForRet(SerCommandId::RfalFieldOnAndStartGTReq, nullptr, 0, rsp, rspLen) != Rfal::None)
+        return false;
+    rspLen = sizeof(rsp);
+    uint16_t ret = execForRet(check, payload, ofs, rsp, rspLen);
+
+    switch (devType)
+    {
+        case Rfal::NfcDevType::ListenNfca:
+            // Several NFC-A cards answering WUPA at once still means "present".
+            return ret == Rfal::None || ret == Rfal::RfCollision;
+        case Rfal::NfcDevType::ListenNfcb:
+            // ret, SENSB_RES (cmd, NFCID0[4], ...), sensbResLen
+            return ret == Rfal::None && rspLen >= 7 && (!uid || formatUid(devType, rsp + 3, 4) == *uid);
+        case Rfal::NfcDevType::ListenNfcv:
+            // ret, INVENTORY_RES (flags, DSFID, UID[8], CRC[2])
+            return ret == Rfal::None && rspLen >= 12 &&
+                   (!uid || formatUid(devType, rsp + 4, Rfal::NfcvUidLength) == *uid);
+        default:
+            // NFC-F and ST25TB answer without a stable identifier (ST25TB chip IDs are random).
+            return ret == Rfal::None;
+    }
+}
+
+uint16_t St25r200Reader::execForRet(SerCommandId cmdId, const uint8_t* payload, size_t payloadLen, uint8_t* rsp,
+                                    size_t& rspLen)
+{
+    if (!sendAndReceive(cmdId, payload, payloadLen, rsp, rspLen) || rspLen < 2)
+        return Rfal::Io;
+    return readU16BE(rsp, 0);
+}
+
+bool St25r200Reader::techTagged() const
+{
+    return _opt.pollTechs != static_cast<uint16_t>(Rfal::NfcPollTech::V);
+}
+
+uint32_t St25r200Reader::uidDevType(const String& uid) const
+{
+    if (!techTagged())
+        return Rfal::NfcDevType::ListenNfcv;
+
+    static const uint32_t kTypes[] = {
+        Rfal::NfcDevType::ListenNfca, Rfal::NfcDevType::ListenNfcb, Rfal::NfcDevType::ListenNfcf,
+        Rfal::NfcDevType::ListenNfcv, Rfal::NfcDevType::ListenSt25tb,
+    };
+    // Compared in place: this runs for every tracked tag on every confirm cycle.
+    const char* text = uid.c_str();
+    for (uint32_t devType : kTypes)
+    {
+        const char* tag = Rfal::TechTag(devType);
+        size_t n = strlen(tag);
+        if (strncmp(text, tag, n) == 0 && text[n] == ':')
+            return devType;
     }
+    return Rfal::NfcDevType::ListenProp;
+}
+
+String St25r200Reader::formatUid(uint32_t devType, const uint8_t* id, size_t len) const
+{
+    char hexBuf[2 * FlatNfcDevice::MaxNfcId1Len + 1] = {0};
+    bytesToHex(id, len, hexBuf, sizeof(hexBuf));
+    if (!techTagged())
+        return String(hexBuf);
+    return String(Rfal::TechTag(devType)) + ":" + hexBuf;
 }
 
 void St25r200Reader::rfalNfcInitialize()
@@ -69,11 +1373,21 @@ void St25r200Reader::rfalNfcInitialize()
     }
 }
 
-void St25r200Reader::rfalNfcDiscover()
+void St25r200Reader::rfalNfcDiscover(bool wakeup)
 {
-    uint8_t params[93];
-    size_t paramsLen = sizeof(params);
-    buildDiscoverParams(params, paramsLen);
+    uint8_t* params = _arena.params;
+    size_t paramsLen = sizeof(_arena.params);
+    memset(params, 0, paramsLen); // the builder skips the fields it leaves zero
+    // A wake-up run polls everything once woken: whatever moved the antenna should be found.
+    _discoverTechs = wakeup ? _opt.pollTechs : _scheduler.next(_opt.pollTechs, _opt.rareTechEvery);
+    _wakeupRun = wakeup;
+    _asleep = false;
+    _woke = false;
+    _wakeupsThisRun = 0;
+    buildDiscoverParams(_discoverTechs, wakeup ? &_wakeupConfig : nullptr, params, paramsLen);
+    _discoverStartMs = clockMs();
+    _activationFromMs = _discoverStartMs;
+    _metrics.discoveries.fetch_add(1, std::memory_order_relaxed);
 
     uint8_t rsp[8] = {0};
     size_t rspLen = sizeof(rsp);
@@ -88,6 +1402,55 @@ void St25r200Reader::rfalNfcDiscover()
     }
 }
 
+bool St25r200Reader::sysPing()
+{
+    uint8_t rsp[8] = {0};
+    size_t rspLen = sizeof(rsp);
+    return sendAndReceive(SerCommandId::SysPingReq, nullptr, 0, rsp, rspLen);
+}
+
+bool St25r200Reader::rfalChipReadReg(uint16_t reg, uint8_t len, uint8_t* out)
+{
+    uint8_t payload[3] = {0};
+    size_t ofs = 0;
+    writeU16BE(payload, ofs, reg);
+    payload[ofs++] = len;
+
+    // ret u16, length u16 (low byte used), register bytes. The bench reads with out == nullptr and
+    // only needs the frame to go by.
+    RegReadSink sink(out, len);
+    size_t rspLen = 0;
+    if (!sendAndReceive(SerCommandId::RfalChipReadRegReq, payload, ofs, sink, rspLen))
+        return false;
+
+    uint16_t ret = readU16BE(sink.head(), 0);
+    uint8_t got = sink.head()[3];
+    return ret == Rfal::None && got == len && rspLen >= 4u + len;
+}
+
+bool St25r200Reader::sysGetVersion()
+{
+    // versionLen u16, version string, rfalVersion u32, fwVersion u32, serHash u32 (no ret)
+    uint8_t* rsp = _arena.rsp;
+    size_t rspLen = sizeof(_arena.rsp);
+    if (!sendAndReceive(SerCommandId::SysGetVersionReq, nullptr, 0, rsp, rspLen) || rspLen < 2)
+        return false;
+    size_t versionLen = readU16BE(rsp, 0);
+    if (rspLen < 2 + versionLen + 12)
+        return false;
+
+    if (_opt.logLevel >= LogErrors)
+    {
+        _log.print("Device ");
+        _log.write(rsp + 2, versionLen);
+        _log.print(" rfal=0x");
+        _log.print(readU32BE(rsp, 2 + versionLen), HEX);
+        _log.print(" fw=0x");
+        _log.println(readU32BE(rsp, 2 + versionLen + 4), HEX);
+    }
+    return true;
+}
+
 uint32_t St25r200Reader::rfalNfcGetState()
 {
     uint8_t rsp[8] = {0};
@@ -115,14 +1478,16 @@ void St25r200Reader::rfalNfcDeactivate(uint32_t deactType)
     }
 }
 
-void St25r200Reader::rfalNfcGetDevicesFound(String* uidList, size_t& uidCount)
+void St25r200Reader::rfalNfcGetDevicesFound(String* uidList, size_t& uidCount, uint16_t& techHits)
 {
-    uint8_t rsp[256] = {0};
-    size_t rspLen = sizeof(rsp);
-    sendAndReceive(SerCommandId::RfalNfcGetDevicesReq, nullptr, 0, rsp, rspLen);
+    uint8_t* rsp = _arena.rsp;
+    size_t rspLen = sizeof(_arena.rsp);
+    if (!sendAndReceive(SerCommandId::RfalNfcGetDevicesReq, nullptr, 0, rsp, rspLen))
+        return;
 
-    size_t ofs = 0;
-    uint16_t ret = readU16BE(rsp, ofs); ofs += 2;
+    FlatNfcDevice::ListView devices;
+    devices.parse(rsp, rspLen);
+    uint16_t ret = devices.ret();
     if (ret != Rfal::None)
     {
         _log.print("rfalNfcGetDevicesFound failed: ");
@@ -132,65 +1497,67 @@ void St25r200Reader::rfalNfcGetDevicesFound(String* uidList, size_t& uidCount)
         return;
     }
 
-    uint8_t devCnt = rsp[ofs++];
     uidCount = 0;
-
-    for (uint8_t i = 0; i < devCnt && uidCount < _opt.maxTrackedTags; ++i)
+    FlatNfcDevice::View dev;
+    while (uidCount < _opt.maxTrackedTags && devices.next(dev))
     {
-        uint32_t devType = readU32BE(rsp, ofs); ofs += 4;
-
+        uint32_t devType = dev.devType();
         if (_opt.logLevel >= LogFrames)
         {
             _log.print("Device[");
-            _log.print(i);
+            _log.print(devices.index() - 1);
             _log.print("] devType=0x");
             _log.print(devType, HEX);
             _log.print(" ");
             _log.println(Rfal::DescribeDevType(devType));
         }
 
-        // NFC-A
-        ofs += 4; // nfcaType
-        ofs += 2; // sensRes
-        ofs += 1; // selRes
-        uint8_t nfcId1Len = rsp[ofs++];
-        if (nfcId1Len > 32) nfcId1Len = 32;
-        ofs += nfcId1Len; // nfcId1
-        ofs += 1; // isSleep
-
-        // NFC-B
-        ofs += 1; // sensbResLen
-        ofs += 5; // sensbRes
-        ofs += 1; // isSleep
-
-        // NFC-F
-        ofs += 1; // sensfResLen
-        ofs += 19; // sensfRes
-
-        // NFC-V
-        ofs += 1; // resFlag
-        ofs += 1; // dsfid
-        const uint8_t* uid = rsp + ofs; ofs += Rfal::NfcvUidLength;
-        ofs += 2; // crc
-        ofs += 1; // isSleep
-
-        // ST25TB
-        ofs += 1; // chipID
-        ofs += 8; // UID
-        ofs += 1; // isDeselected
+        techHits |= static_cast<uint16_t>(Rfal::PollTechFor(devType));
+        switch (devType)
+        {
+            case Rfal::NfcDevType::ListenNfca:
+                uidList[uidCount++] = formatUid(devType, dev.nfcaNfcId1(), dev.nfcaNfcId1Len());
+                break;
+            case Rfal::NfcDevType::ListenNfcb:
+                uidList[uidCount++] = formatUid(devType, dev.nfcbNfcid0(), 4);
+                break;
+            case Rfal::NfcDevType::ListenNfcf:
+                uidList[uidCount++] = formatUid(devType, dev.nfcfNfcid2(), 8);
+                break;
+            case Rfal::NfcDevType::ListenNfcv:
+                uidList[uidCount++] = formatUid(devType, dev.nfcvUid(), Rfal::NfcvUidLength);
+                break;
+            case Rfal::NfcDevType::ListenSt25tb:
+                uidList[uidCount++] = formatUid(devType, dev.st25tbUid(), 8);
+                break;
+            default:
+                break;
+        }
+    }
 
-        if (devType == static_cast<uint32_t>(Rfal::NfcDevType::ListenNfcv))
+    if (devices.malformed())
+    {
+        _metrics.badDeviceRecords.fetch_add(1, std::memory_order_relaxed);
+        if (_opt.logLevel >= LogErrors)
         {
-            char hexBuf[17] = {0};
-            bytesToHex(uid, Rfal::NfcvUidLength, hexBuf, sizeof(hexBuf));
-            uidList[uidCount++] = String(hexBuf);
+            _log.print("rfalNfcGetDevicesFound: malformed device record ");
+            _log.print(devices.index());
+            _log.print(" of ");
+            _log.print(devices.count());
+            _log.print(" (rspLen=");
+            _log.print(rspLen);
+            _log.println(")");
         }
     }
 }
 
 void St25r200Reader::publishPresence(const String* uids, size_t uidCount)
 {
-    PresenceDelta delta = _tracker.update(uids, uidCount);
+    uint32_t nowMs = clockMs();
+    if (uidCount > 0)
+        _lastSightingMs = nowMs;
+    PresenceDelta delta = _tracker.update(uids, uidCount, nowMs);
+    _presence.publish(_tracker, nowMs);
 
     for (size_t i = 0; i < delta.arrivedCount; ++i)
     {
@@ -199,6 +1566,8 @@ void St25r200Reader::publishPresence(const String* uids, size_t uidCount)
             _log.print("ARRIVED ");
             _log.println(delta.arrived[i]);
         }
+        if (_opt.captureOut)
+            _recorder.noteEvent("placed", delta.arrived[i]);
         _notifier.postPlaced(delta.arrived[i], _log, _opt.logLevel);
     }
 
@@ -209,20 +1578,67 @@ void St25r200Reader::publishPresence(const String* uids, size_t uidCount)
             _log.print("LEFT ");
             _log.println(delta.left[i]);
         }
+        if (_opt.captureOut)
+            _recorder.noteEvent("removed", delta.left[i]);
         _notifier.postRemoved(delta.left[i], _log, _opt.logLevel);
     }
 }
 
-void St25r200Reader::sendAndReceive(SerCommandId requestCmdId, const uint8_t* payload, size_t payloadLen,
+bool St25r200Reader::sendAndReceive(SerCommandId requestCmdId, const uint8_t* payload, size_t payloadLen,
                                     uint8_t* rspBuf, size_t& rspLen)
 {
+    ArenaSink sink(rspBuf, rspLen);
+    size_t total = 0;
+    bool ok = sendAndReceive(requestCmdId, payload, payloadLen, sink, total);
+    // A failed exchange may have stored part of a frame; callers must not parse it.
+    rspLen = ok ? sink.stored() : 0;
+    if (sink.truncated())
+    {
+        _metrics.truncatedPayloads.fetch_add(1, std::memory_order_relaxed);
+        if (_opt.logLevel >= LogErrors)
+        {
+            _log.print("Response payload of ");
+            _log.print(total);
+            _log.print(" bytes truncated to ");
+            _log.println(sink.stored());
+        }
+    }
+
+    if (_opt.logLevel >= LogFrames && rspLen > 0)
+    {
+        _log.print("RX payload :: ");
+        logHex(rspBuf, rspLen);
+        _log.println();
+    }
+    return ok;
+}
+
+bool St25r200Reader::sendAndReceive(SerCommandId requestCmdId, const uint8_t* payload, size_t payloadLen,
+                                    FrameSink& sink, size_t& rspLen)
+{
+    rspLen = 0;
+    size_t maxPayload = _opt.maxRequestPayload < FrameSink::MaxPayload ? _opt.maxRequestPayload : FrameSink::MaxPayload;
+    if (payloadLen > maxPayload || (payloadLen > 0 && !payload))
+    {
+        if (_opt.logLevel >= LogErrors)
+        {
+            _log.print("Request of ");
+            _log.print(payloadLen);
+            _log.println(" bytes exceeds maxRequestPayload");
+        }
+        return false;
+    }
+
+    // Requests that fit the frame buffer go out in one write; larger ones as the header followed by
+    // the caller's buffer, so no request size needs a staging copy.
     uint16_t len = static_cast<uint16_t>(2 + payloadLen);
-    uint8_t frame[1 + 2 + 2 + 256] = {0};
+    uint8_t* frame = _arena.tx;
     frame[0] = FrameHeader;
     size_t ofs = 1;
     writeU16BE(frame, ofs, len);
     writeU16BE(frame, ofs, static_cast<uint16_t>(requestCmdId));
-    if (payloadLen > 0)
+    bool staged = payloadLen <= MaxFramePayload;
+    if (staged && payloadLen > 0)
     {
         memcpy(frame + ofs, payload, payloadLen);
         ofs += payloadLen;
@@ -230,74 +1646,106 @@ void St25r200Reader::sendAndReceive(SerCommandId requestCmdId, const uint8_t* pa
 
     if (_opt.logLevel >= LogFrames)
     {
-        char hexBuf[520] = {0};
-        bytesToHex(frame, ofs, hexBuf, sizeof(hexBuf));
         _log.print("TX cmd=0x");
         _log.print(static_cast<uint16_t>(requestCmdId), HEX);
         _log.print(" len=");
         _log.print(len);
         _log.print(" :: ");
-        _log.println(hexBuf);
+        logHex(frame, ofs);
+        if (!staged)
+            logHex(payload, payloadLen);
+        _log.println();
     }
 
+    ReaderMetrics::CommandStats* stats = _metrics.command(static_cast<uint16_t>(requestCmdId));
+    unsigned long startUs = micros();
+
     _serial->write(frame, ofs);
+    if (!staged)
+        _serial->write(payload, payloadLen);
+    _metrics.framesTx.fetch_add(1, std::memory_order_relaxed);
+    _metrics.bytesTx.fetch_add(1 + 2 + len, std::memory_order_relaxed);
 
     uint16_t rspCmd = 0;
-    uint8_t rawFrame[260] = {0};
-    size_t rawLen = sizeof(rawFrame);
-    if (!readFrame(rspCmd, rspBuf, rspLen, rawFrame, rawLen))
+    if (!readFrame(rspCmd, sink, rspLen))
     {
+        if (stats)
+            stats->failures.fetch_add(1, std::memory_order_relaxed);
+        _supervisor.recordFailure();
         _log.println("Read frame failed");
-        return;
+        return false;
+    }
+
+    uint32_t rttUs = micros() - startUs;
+    uint32_t typicalUs = 0;
+    if (stats)
+    {
+        // Median bucket bound as the command's usual RTT: immune to the RTT being judged and to
+        // a few slow outliers dragging the mean.
+        RttHistogram::Snapshot h;
+        stats->rtt.snapshot(h);
+        if (h.count >= LinkSupervisor::MinTypicalSamples)
+            typicalUs = RttHistogram::percentileUpperUs(h, 50);
+        stats->rtt.record(rttUs);
     }
 
     uint16_t expectedCmd = static_cast<uint16_t>(requestCmdId) + 1;
-    if (rspCmd != expectedCmd && _opt.logLevel >= LogErrors)
+    if (rspCmd == expectedCmd)
     {
-        _log.print("Unexpected rsp cmd: 0x");
-        _log.print(rspCmd, HEX);
-        _log.print(" expected 0x");
-        _log.println(expectedCmd, HEX);
+        _supervisor.recordSuccess(rttUs, typicalUs);
+    }
+    else
+    {
+        _supervisor.recordFailure();
+        _metrics.unexpectedCmd.fetch_add(1, std::memory_order_relaxed);
+        if (_opt.logLevel >= LogErrors)
+        {
+            _log.print("Unexpected rsp cmd: 0x");
+            _log.print(rspCmd, HEX);
+            _log.print(" expected 0x");
+            _log.println(expectedCmd, HEX);
+        }
     }
 
     if (_opt.logLevel >= LogFrames)
     {
-        char hexBuf[520] = {0};
-        bytesToHex(rawFrame, rawLen, hexBuf, sizeof(hexBuf));
         _log.print("RX cmd=0x");
         _log.print(rspCmd, HEX);
         _log.print(" payloadLen=");
-        _log.print(rspLen);
-        _log.print(" raw=");
-        _log.println(hexBuf);
+        _log.println(rspLen);
     }
+    return rspCmd == expectedCmd;
 }
 
-bool St25r200Reader::readFrame(uint16_t& cmdId, uint8_t* payload, size_t& payloadLen, uint8_t* rawFrame, size_t& rawLen)
+bool St25r200Reader::readFrame(uint16_t& cmdId, FrameSink& sink, size_t& payloadLen)
 {
     uint16_t skipped = 0;
     while (true)
     {
-        int b = _serial->read();
-        if (b < 0)
+        uint8_t b = 0;
+        if (!readExact(&b, 1))
         {
+            _metrics.resyncBytes.fetch_add(skipped, std::memory_order_relaxed);
             return false;
         }
-        if (static_cast<uint8_t>(b) == FrameHeader)
+        if (b == FrameHeader)
         {
             break;
         }
         if (_opt.logLevel >= LogBytes && skipped < 64)
         {
             _log.print("Resync skip byte: 0x");
-            _log.println(static_cast<uint8_t>(b), HEX);
+            _log.println(b, HEX);
         }
         skipped++;
         if (skipped > 4096)
         {
+            _metrics.resyncBytes.fetch_add(skipped, std::memory_order_relaxed);
+            _metrics.resyncOverflows.fetch_add(1, std::memory_order_relaxed);
             return false;
         }
     }
+    _metrics.resyncBytes.fetch_add(skipped, std::memory_order_relaxed);
 
     uint8_t lenBuf[2] = {0};
     if (!readExact(lenBuf, sizeof(lenBuf)))
@@ -305,7 +1753,10 @@ bool St25r200Reader::readFrame(uint16_t& cmdId, uint8_t* payload, size_t& payloa
 
     uint16_t len = (static_cast<uint16_t>(lenBuf[0]) << 8) | lenBuf[1];
     if (len < 2)
+    {
+        _metrics.badLength.fetch_add(1, std::memory_order_relaxed);
         return false;
+    }
 
     uint8_t cmdBuf[2] = {0};
     if (!readExact(cmdBuf, sizeof(cmdBuf)))
@@ -313,25 +1764,35 @@ bool St25r200Reader::readFrame(uint16_t& cmdId, uint8_t* payload, size_t& payloa
 
     cmdId = (static_cast<uint16_t>(cmdBuf[0]) << 8) | cmdBuf[1];
 
-    size_t pl = len - 2;
-    if (pl > payloadLen)
-        pl = payloadLen;
-
-    if (!readExact(payload, pl))
-        return false;
-
-    payloadLen = pl;
-
-    size_t total = 1 + 2 + 2 + pl;
-    if (rawLen >= total)
+    // The payload goes where the sink says, segment by segment. Once it declines, the rest is read
+    // and dropped: the whole frame always leaves the stream, so the next header lines up.
+    size_t total = len - 2;
+    sink.begin(total);
+    size_t ofs = 0;
+    bool sinking = true;
+    while (ofs < total)
     {
-        rawFrame[0] = FrameHeader;
-        memcpy(rawFrame + 1, lenBuf, 2);
-        memcpy(rawFrame + 3, cmdBuf, 2);
-        memcpy(rawFrame + 5, payload, pl);
-        rawLen = total;
+        size_t n = total - ofs;
+        uint8_t* dst = sinking ? sink.segment(ofs, n) : nullptr;
+        if (!dst || n == 0)
+        {
+            sinking = false;
+            n = total - ofs < sizeof(_arena.drain) ? total - ofs : sizeof(_arena.drain);
+            if (!readExact(_arena.drain, n))
+                return false;
+        }
+        else
+        {
+            if (!readExact(dst, n))
+                return false;
+            sink.received(ofs, n);
+        }
+        ofs += n;
     }
 
+    payloadLen = total;
+    _metrics.framesRx.fetch_add(1, std::memory_order_relaxed);
+    _metrics.bytesRx.fetch_add(1 + 2 + len, std::memory_order_relaxed);
     return true;
 }
 
@@ -345,7 +1806,10 @@ bool St25r200Reader::readExact(uint8_t* buffer, size_t count)
         if (n <= 0)
         {
             if ((millis() - start) > _opt.readTimeoutMs)
+            {
+                _metrics.timeouts.fetch_add(1, std::memory_order_relaxed);
                 return false;
+            }
             continue;
         }
         readTotal += n;
@@ -393,16 +1857,27 @@ void St25r200Reader::bytesToHex(const uint8_t* bytes, size_t len, char* out, siz
     out[len * 2] = '\0';
 }
 
-void St25r200Reader::buildDiscoverParams(uint8_t* outBuf, size_t& outLen)
+void St25r200Reader::logHex(const uint8_t* bytes, size_t len)
+{
+    for (size_t ofs = 0; ofs < len; ofs += HexLogChunk)
+    {
+        size_t n = len - ofs < HexLogChunk ? len - ofs : HexLogChunk;
+        bytesToHex(bytes + ofs, n, _arena.hex, sizeof(_arena.hex));
+        _log.print(_arena.hex);
+    }
+}
+
+void St25r200Reader::buildDiscoverParams(uint16_t techs, const WakeUp::Config* wakeup, uint8_t* outBuf,
+                                         size_t& outLen)
 {
-    if (outLen < 93)
+    if (outLen < DiscoverParamsLen)
         return;
 
     size_t o = 0;
     writeU32BE(outBuf, o, static_cast<uint32_t>(Rfal::ComplianceMode::Nfc)); // compMode
-    writeU16BE(outBuf, o, static_cast<uint16_t>(Rfal::NfcPollTech::V)); // techs2Find
+    writeU16BE(outBuf, o, techs); // techs2Find
     writeU16BE(outBuf, o, static_cast<uint16_t>(Rfal::NfcPollTech::None)); // techs2Bail
-    writeU16BE(outBuf, o, 0x00C8); // totalDuration (200ms)
+    writeU16BE(outBuf, o, DiscoverTotalDurationMs); // totalDuration
     outBuf[o++] = 0x04; // devLimit
     writeU32BE(outBuf, o, static_cast<uint32_t>(Rfal::BitRate::Keep)); // maxBR
     writeU32BE(outBuf, o, static_cast<uint32_t>(Rfal::BitRate::Br212)); // nfcfBR
@@ -417,11 +1892,13 @@ void St25r200Reader::buildDiscoverParams(uint8_t* outBuf, size_t& outLen)
     o += 17; // lmConfigPA
     o += 21; // lmConfigPF
 
-    outBuf[o++] = 0x00; // wakeupEnabled
+    outBuf[o++] = wakeup ? 0x01 : 0x00; // wakeupEnabled
     outBuf[o++] = 0x00; // wakeupConfigDefault
-    o += 18; // wakeupConfig
+    if (wakeup)
+        wakeup->write(outBuf + o);
+    o += WakeUp::Config::WireSize; // wakeupConfig (period, 6 flags, measDur, measFil, I and Q channels)
     outBuf[o++] = 0x00; // wakeupPollBefore
-    writeU16BE(outBuf, o, 0x0000); // wakeupNPolls
+    writeU16BE(outBuf, o, wakeup ? 0x0001 : 0x0000); // wakeupNPolls
 
-    outLen = 93;
+    outLen = o;
 }
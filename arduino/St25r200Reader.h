@@ -1,8 +1,19 @@
 #pragma once
 
 #include <Arduino.h>
+#include "AnalogConfig.h"
+#include "AntennaCalibration.h"
+#include "CaptureRecorder.h"
+#include "DiscoveryScheduler.h"
+#include "DpoTuner.h"
+#include "FlatNfcDevice.h"
+#include "FrameSink.h"
+#include "LinkSupervisor.h"
+#include "PresenceSnapshot.h"
 #include "PresenceTracker.h"
+#include "ReaderMetrics.h"
 #include "RfalEnums.h"
+#include "WakeUpConfig.h"
 #include "RestNotifier.h"
 
 class St25r200Reader
@@ -25,6 +36,91 @@ public:
         uint16_t loopDelayMs = 75;
         uint8_t maxTrackedTags = 4;
         LogLevel logLevel = LogErrors;
+        Print* captureOut = nullptr; // when set, frames and events are recorded for replay
+        const uint32_t* probeBaudRates = nullptr; // candidates tried with SysPing in begin(), fastest first
+        uint8_t probeBaudRateCount = 0;            // baudRate is the fallback when none answers
+        uint8_t probePings = 4;
+        // Rfal::NfcPollTech mask to discover. UIDs are tech-tagged ("A:", "B:", "F:", "V:", "TB:")
+        // unless this is NFC-V only, which keeps the plain NFC-V UIDs existing backends expect.
+        uint16_t pollTechs = static_cast<uint16_t>(Rfal::NfcPollTech::V);
+        // While tags are tracked, confirm them with per-tech presence checks and run a full
+        // discovery only every Nth cycle (to catch arrivals) or when a check fails. 0 = always discover.
+        uint8_t fullDiscoveryEvery = 4;
+        // Tracked tags are reported removed when they have not been seen for this long.
+        uint16_t absentAfterMs = 1000;
+        // Technologies without a recent hit are polled only every Nth discovery run (0 = poll all
+        // of pollTechs every run); an idle discovery is re-planned every techRescheduleMs.
+        uint8_t rareTechEvery = 8;
+        uint16_t techRescheduleMs = 1000;
+        // Once the antenna has been empty for wakeupAfterEmptyMs, discover in RFAL wake-up mode: the
+        // field stays off and the chip only measures the antenna every wakeupPeriod (WakeUp::Period)
+        // until the I/Q signal moves by more than the calibrated delta, then polls as usual.
+        bool wakeupMode = false;
+        uint16_t wakeupAfterEmptyMs = 2000;
+        uint8_t wakeupPeriod = WakeUp::Period105ms;
+        uint8_t wakeupCalSamples = 8;
+        uint8_t wakeupRecalAfterFalse = 8; // false wake-ups before the thresholds are re-calibrated
+        // KVStore key ("/kv/...") holding this reader's AntennaCalibration; applied after every
+        // rfalNfcInitialize and written by calibrateAntenna(). nullptr = keep the configured RFO.
+        const char* calibrationKey = nullptr;
+        // Learn a DPO (dynamic power output) table while a single tag is confirmed, then let the chip
+        // step the RFO weaker as the tag loads the antenna. Every dpoSampleEvery confirm cycles one
+        // sample probes a weaker level; after dpoSamples the table is written and kept only if the
+        // read rate over the next dpoValidateChecks presence checks stays within dpoMaxRateDropPct
+        // of the fixed-RFO rate.
+        bool dpoTuning = false;
+        uint16_t dpoSamples = 200;
+        uint8_t dpoSampleEvery = 8;
+        uint8_t dpoLevels = 4;          // table entries, at most DpoTuner::MaxEntries
+        uint8_t dpoRfoStep = 2;         // RFO added (weaker) per level
+        uint8_t dpoTargetPct = 95;      // read rate a level must keep at a given amplitude
+        uint8_t dpoHysteresis = 8;      // ADC counts between stepping weaker and back
+        uint16_t dpoValidateChecks = 200;
+        uint8_t dpoMaxRateDropPct = 2;
+        // Raw rfalAnalogConfig entries (AnalogConfig.h layout) merged into the device's analog table
+        // after every rfalNfcInitialize. The device's RAM config hash after the last write is cached
+        // under analogConfigKey, so an unchanged table costs one SysGetConfigHashes, not a read-back.
+        const uint8_t* analogConfig = nullptr;
+        uint16_t analogConfigLen = 0;
+        const char* analogConfigKey = nullptr;
+        // At startup, adopt a discovery the device is still running (host reset, reconnect) instead
+        // of rfalNfcInitialize + rfalNfcDiscover, once SysPing, SysGetVersion and the analog config
+        // hash confirm the device and its configuration. Not with dpoTuning (the table is host state).
+        bool warmStart = true;
+        // Link supervisor (LinkSupervisor.h): after recoverAfterFailures consecutive failed
+        // exchanges, or recoverAfterOutliers consecutive RTTs above rttOutlierFactor x the command's
+        // median, the presence loop pauses and recovery escalates from resync to UART reopen, backing
+        // off from recoveryBackoffMinMs up to recoveryBackoffMaxMs. recoverAfterFailures 0 = off.
+        uint8_t recoverAfterFailures = 3;
+        uint8_t recoverAfterOutliers = 8;
+        uint8_t rttOutlierFactor = 8;
+        uint16_t recoveryBackoffMinMs = 100;
+        uint16_t recoveryBackoffMaxMs = 5000;
+        // Largest request payload the firmware's receive buffer takes (at most FrameSink::MaxPayload).
+        // Requests above 256 bytes are streamed from the caller's buffer instead of staged.
+        uint16_t maxRequestPayload = 256;
+        // Clock of the presence loop (absence, wake-up, rescheduling, supervisor, metrics); nullptr =
+        // millis(). Capture replay runs it from the recorded deltas. Serial timeouts stay on millis().
+        unsigned long (*nowMs)(void* context) = nullptr;
+        void* nowMsContext = nullptr;
+    };
+
+    struct BenchmarkOptions
+    {
+        uint16_t durationMs = 1000;         // per step
+        const uint8_t* readSizes = nullptr; // ChipReadReg lengths swept after the SysPing step
+        uint8_t readSizeCount = 0;
+        bool sweepBaudRates = false;        // repeat at every Options::probeBaudRates entry that answers
+    };
+
+    struct CalibrationOptions
+    {
+        uint32_t devType = Rfal::NfcDevType::ListenNfcv; // technology of the reference tag on the antenna
+        uint8_t rfoWeakest = 15;      // sweep from this RFO (highest driver resistance) ...
+        uint8_t rfoStrongest = 0;     // ... down to this one
+        uint8_t attempts = 20;        // presence checks per RFO step
+        uint8_t targetSuccessPct = 95;
+        uint8_t marginSteps = 1;      // settle this many steps stronger than the weakest passing RFO
     };
 
     St25r200Reader(const Options& options, RestNotifier& notifier, Stream& logStream);
@@ -32,18 +128,101 @@ public:
     void begin();
     void loop();
 
+    // Single steps of loop(); used by the capture replay harness. startDiscovery() warm-starts
+    // when Options::warmStart allows it.
+    void startDiscovery();
+    void runCycle();
+
+    // Floods the link with back-to-back requests and prints one line per step to the log stream:
+    // frames/s, RTT distribution and the share of each RTT that is wire time at the current baud.
+    // Call after begin() and instead of loop().
+    void runBenchmark(const BenchmarkOptions& bench);
+
+    // Sweeps the RF output power against a reference tag placed on the antenna: one log line per
+    // RFO step with amplitude, phase, read rate and RTT. Picks the weakest RFO that reaches
+    // targetSuccessPct (plus marginSteps), applies it and persists it under Options::calibrationKey.
+    // Call after begin() and instead of loop(); returns false if no step reached the target.
+    bool calibrateAntenna(const CalibrationOptions& cal);
+
+    // Lock-free transport/loop statistics; safe to read from any thread.
+    const ReaderMetrics& metrics() const { return _metrics; }
+
+    // Bytes of the reader's transport and parse buffers, held in the reader instead of the stack.
+    static size_t arenaBytes() { return sizeof(Arena); }
+
+    // Current presence set with first/last-seen times, republished every presence update.
+    const PresenceSnapshot& presence() const { return _presence; }
+
 private:
+    enum class DpoPhase : uint8_t
+    {
+        Off,        // dpoTuning disabled
+        Collecting, // sampling weaker levels against the tracked tag
+        Validating, // table enabled, read rate on trial
+        Active,     // table accepted
+        Rejected,   // no usable table, or it cost read rate; fixed RFO
+    };
+
     void rfalNfcInitialize();
-    void rfalNfcDiscover();
+    void rfalNfcDiscover(bool wakeup = false);
+    void initDiscovery(bool allowWarm);
+    bool tryWarmStart();
+    bool sysPing();
+    bool sysGetVersion();
+    bool rfalChipReadReg(uint16_t reg, uint8_t len, uint8_t* out);
     uint32_t rfalNfcGetState();
     void rfalNfcDeactivate(uint32_t deactType);
-    void rfalNfcGetDevicesFound(String* uidList, size_t& uidCount);
+    void rfalNfcGetDevicesFound(String* uidList, size_t& uidCount, uint16_t& techHits);
+
+    void endDiscoveryRun(uint16_t hits);
+    void trackWakeUp(uint32_t state);
+    void accountModeTime(unsigned long nowMs);
+    unsigned long clockMs() const { return _opt.nowMs ? _opt.nowMs(_opt.nowMsContext) : millis(); }
+    bool calibrateWakeUp();
+    bool confirmPresence();
+    bool checkTechPresence(uint32_t devType, const String* uid); // uid nullptr: any tag of devType
+    uint16_t execForRet(SerCommandId cmdId, const uint8_t* payload, size_t payloadLen, uint8_t* rsp, size_t& rspLen);
+    bool techTagged() const;
+    uint32_t uidDevType(const String& uid) const;
+    String formatUid(uint32_t devType, const uint8_t* id, size_t len) const;
 
     void publishPresence(const String* uids, size_t uidCount);
 
-    void sendAndReceive(SerCommandId requestCmdId, const uint8_t* payload, size_t payloadLen,
+    void syncAnalogConfig();
+    bool analogCacheMatches(uint32_t hashRam); // loads the persisted cache on first use
+    bool sysGetConfigHashes(uint8_t configId, uint32_t& hashRam);
+    void applyAntennaCalibration();
+    bool rfalChipSetRFO(uint8_t rfo);
+    bool rfalChipMeasure(SerCommandId cmdId, uint8_t& result);
+
+    void startDpo();
+    void setDpoPhase(DpoPhase phase);
+    void tuneDpo(bool confirmed);
+    void sampleDpo();
+    void finishDpoCollection();
+    void validateDpo();
+    bool writeDpoTable();
+    bool rfalDpoSetEnable(bool enable);
+    uint8_t presenceReadRatePct(uint32_t checksMark, uint32_t missesMark) const;
+
+    bool superviseLink();
+    bool runRecoveryStep(LinkSupervisor::Step step);
+
+    void openLink();
+    uint32_t negotiateBaudRate();
+    bool probeBaudRate(uint32_t baudRate);
+    void drainInput();
+
+    void benchmarkRates(const BenchmarkOptions& bench, uint32_t baudRate);
+    void benchmarkStep(uint32_t baudRate, uint8_t readLen, uint16_t durationMs);
+
+    // rspLen: capacity of rspBuf in, bytes stored out; a longer payload is drained and counted.
+    bool sendAndReceive(SerCommandId requestCmdId, const uint8_t* payload, size_t payloadLen,
                         uint8_t* rspBuf, size_t& rspLen);
-    bool readFrame(uint16_t& cmdId, uint8_t* payload, size_t& payloadLen, uint8_t* rawFrame, size_t& rawLen);
+    // rspLen: the payload length of the response, whatever the sink kept of it.
+    bool sendAndReceive(SerCommandId requestCmdId, const uint8_t* payload, size_t payloadLen, FrameSink& sink,
+                        size_t& rspLen);
+    bool readFrame(uint16_t& cmdId, FrameSink& sink, size_t& payloadLen);
 
     bool readExact(uint8_t* buffer, size_t count);
 
@@ -52,14 +231,84 @@ private:
     static uint16_t readU16BE(const uint8_t* buf, size_t ofs);
     static uint32_t readU32BE(const uint8_t* buf, size_t ofs);
     static void bytesToHex(const uint8_t* bytes, size_t len, char* out, size_t outLen);
+    void logHex(const uint8_t* bytes, size_t len); // through _arena.hex, HexLogChunk bytes per print
 
-    static void buildDiscoverParams(uint8_t* outBuf, size_t& outLen);
+    static void buildDiscoverParams(uint16_t techs, const WakeUp::Config* wakeup, uint8_t* outBuf, size_t& outLen);
 
     HardwareSerial* _serial;
     Options _opt;
+    CaptureRecorder _recorder;
+    ReaderMetrics _metrics;
+    LinkSupervisor _supervisor;
     PresenceTracker _tracker;
+    PresenceSnapshot _presence;
+
+    enum class Phase : uint8_t
+    {
+        Discovering, // rfalNfcDiscover running, polling its state
+        Confirming,  // NFC layer idle, tracked tags re-checked with poller presence checks
+    };
+    Phase _phase = Phase::Discovering;
+    uint8_t _confirmCycles = 0;
+    unsigned long _discoverStartMs = 0;
+    unsigned long _lastSightingMs = 0;
+    unsigned long _startMs = 0;      // begin()
+    bool _firstDetectPending = true; // no tag seen since startDiscovery()
+    bool _redetectPending = false;   // tags were tracked at the last recovery and none seen since
+    unsigned long _redetectFromMs = 0; // the link went unhealthy
+    bool _warmStarted = false;
+
+    DiscoveryScheduler _scheduler;
+    uint16_t _discoverTechs = 0; // techs2Find of the running discovery
+
+    AntennaCalibration _calibration; // invalid until loaded or calibrated
+    AnalogConfig::Cache _analogCache; // invalid until loaded or written
+    uint8_t _analogTable[4 + AnalogConfig::MaxTableLen]; // ReadRaw response: ret, size, table
+    WakeUp::Config _wakeupConfig;
+    bool _wakeupCalibrated = false;
+    bool _wakeupUnavailable = false; // calibration failed; stay in polling mode
+    bool _wakeupRun = false;         // the running discovery has wake-up mode enabled
+    bool _asleep = false;            // last state seen was WakeupMode
+    bool _woke = false;              // left WakeupMode and has not activated a tag yet
+    uint8_t _falseWakeupsSinceCal = 0;
+    uint16_t _wakeupsThisRun = 0;
+    unsigned long _activationFromMs = 0; // discovery run started, or in wake-up mode the wake-up seen
+    unsigned long _modeTickMs = 0;
+
+    DpoPhase _dpoPhase = DpoPhase::Off;
+    DpoTuner _dpoTuner;
+    DpoEntry _dpoTable[DpoTuner::MaxEntries] = {};
+    uint8_t _dpoTableCount = 0;
+    uint8_t _dpoCycles = 0;
+    uint8_t _dpoBaselinePct = 0;
+    uint32_t _dpoChecksMark = 0; // presenceChecks / presenceCheckMisses when the phase began
+    uint32_t _dpoMissesMark = 0;
     RestNotifier& _notifier;
     Stream& _log;
 
     static constexpr uint8_t FrameHeader = 0xAA;
+    static constexpr size_t MaxFramePayload = 256; // request payload staged and written in one go
+    static constexpr size_t RxDrainChunk = 32;     // payload bytes dropped per read when a sink refuses
+    static constexpr uint16_t ProbeTimeoutMs = 50;
+    static constexpr uint16_t WakeUpMeasureCostUs = 100; // field-on time of one wake-up measurement
+    static constexpr uint8_t WakeUpMinDelta = 2;
+    static constexpr uint8_t WakeUpDeltaMargin = 2; // added to the measured noise span
+    static constexpr uint8_t AmplitudeDriftWarn = 10; // startup amplitude vs. calibration, ADC counts
+    static constexpr size_t DiscoverParamsLen = 167; // serialized serRfalNfcDiscoverParam
+    static constexpr uint16_t DiscoverTotalDurationMs = 200; // one polling round, repeated until a tag answers
+    static constexpr size_t HexLogChunk = 64; // frame bytes hex-encoded per log print
+
+    // Transport and parse buffers. They live in the reader rather than on the thread stack, so the
+    // stack only has to hold call frames and every reader's buffers are sized at link time. Only the
+    // reader's own thread touches them, one exchange at a time; a buffer is free again once the
+    // function that filled it returns.
+    struct Arena
+    {
+        uint8_t tx[1 + 2 + 2 + MaxFramePayload]; // header, length, command ID, staged payload
+        uint8_t rsp[MaxFramePayload];            // GetDevicesFound / GetVersion response being parsed
+        uint8_t params[DiscoverParamsLen];       // rfalNfcDiscover request
+        uint8_t drain[RxDrainChunk];             // payload bytes a sink declined
+        char hex[2 * HexLogChunk + 1];
+    };
+    Arena _arena = {};
 };
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Thread stack in static memory, painted with a fill pattern before the thread starts, so its
+// high-water mark can be read back whatever the RTOS was built with: RTX only paints and measures
+// its own stacks when stack watermarking is compiled in, and Thread::max_stack() otherwise reports
+// the whole stack as used. Pass memory() and size() to the rtos::Thread constructor.
+//
+// maxUsed() reads the stack while its thread runs. It only looks for the deepest byte that lost the
+// pattern, which moves one way, so a racing read is at worst a few bytes low.
+class StackWatermark
+{
+public:
+    static constexpr uint8_t Pattern = 0xCC;
+
+    StackWatermark(unsigned char* mem, size_t size) : _mem(mem), _size(size) { memset(_mem, Pattern, _size); }
+
+    unsigned char* memory() const { return _mem; }
+    uint32_t size() const { return static_cast<uint32_t>(_size); }
+
+    // Bytes from the top of the stack down to the deepest one written. The stack grows down, and
+    // RTX keeps a magic word at the bottom for its overflow check.
+    size_t maxUsed() const
+    {
+        size_t free = MagicWordSize;
+        while (free < _size && _mem[free] == Pattern)
+            free++;
+        return _size - free;
+    }
+
+private:
+    static constexpr size_t MagicWordSize = 4;
+
+    unsigned char* _mem;
+    size_t _size;
+};
+
+// Size bytes of stack; RTX wants it 8-byte aligned and a multiple of 8.
+template <size_t Size>
+class ThreadStack : public StackWatermark
+{
+    static_assert(Size % 8 == 0, "thread stack size must be a multiple of 8");
+
+public:
+    ThreadStack() : StackWatermark(_stack, Size) {}
+
+private:
+    alignas(8) unsigned char _stack[Size];
+};
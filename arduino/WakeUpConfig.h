@@ -0,0 +1,157 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// rfalWakeUpConfig / rfalWakeUpInfo as serialized by the serial RFAL protocol (enums as u32,
+// bools as one byte, big-endian). Arduino-independent so host tools and simulators share it.
+namespace WakeUp
+{
+    inline size_t writeU32(uint8_t* out, uint32_t v)
+    {
+        out[0] = static_cast<uint8_t>(v >> 24);
+        out[1] = static_cast<uint8_t>(v >> 16);
+        out[2] = static_cast<uint8_t>(v >> 8);
+        out[3] = static_cast<uint8_t>(v);
+        return 4;
+    }
+
+    // rfalWumPeriod: Wake-Up timer period between measurements.
+    enum Period : uint32_t
+    {
+        Period10ms = 0x00,
+        Period15ms = 0x01,
+        Period20ms = 0x02,
+        Period25ms = 0x03,
+        Period40ms = 0x04,
+        Period55ms = 0x05,
+        Period80ms = 0x06,
+        Period105ms = 0x07,
+        Period155ms = 0x08,
+        Period215ms = 0x09,
+        Period310ms = 0x0A,
+        Period425ms = 0x0B,
+        Period620ms = 0x0C,
+        Period850ms = 0x0D,
+        Period1240ms = 0x0E,
+        Period1700ms = 0x0F,
+    };
+
+    inline uint16_t periodMs(uint32_t period)
+    {
+        static const uint16_t kMs[] = {10, 13, 19, 27, 39, 53, 77, 106, 155, 213, 309, 425, 619, 851, 1237, 1701};
+        return period < sizeof(kMs) / sizeof(kMs[0]) ? kMs[period] : kMs[sizeof(kMs) / sizeof(kMs[0]) - 1];
+    }
+
+    enum MeasDuration : uint32_t
+    {
+        MeasDur26_10 = 0,
+        MeasDur30_14 = 1,
+        MeasDur34_19 = 2,
+        MeasDur44_28 = 3,
+    };
+
+    enum AutoAvgWeight : uint32_t
+    {
+        AaWeight4 = 0,
+        AaWeight8 = 1,
+        AaWeight16 = 2,
+        AaWeight32 = 3,
+    };
+
+    // Trigger threshold bitmask (RFAL_WUM_TRE_*)
+    constexpr uint8_t TriggerAbove = 1U << 2;
+    constexpr uint8_t TriggerBetween = 1U << 1;
+    constexpr uint8_t TriggerBelow = 1U << 0;
+    constexpr uint8_t ReferenceAuto = 0xFF; // RFAL_WUM_REFERENCE_AUTO
+
+    struct Channel
+    {
+        bool enabled = true;
+        uint8_t delta = 4;                   // |measurement - reference| that wakes the reader
+        uint8_t reference = ReferenceAuto;
+        uint8_t threshold = TriggerAbove | TriggerBelow;
+        bool aaInclMeas = true;
+        uint32_t aaWeight = AaWeight16;
+
+        static constexpr size_t WireSize = 9;
+
+        size_t write(uint8_t* out) const
+        {
+            out[0] = enabled ? 1 : 0;
+            out[1] = delta;
+            out[2] = reference;
+            out[3] = threshold;
+            out[4] = aaInclMeas ? 1 : 0;
+            writeU32(out + 5, aaWeight);
+            return WireSize;
+        }
+    };
+
+    struct Config
+    {
+        uint32_t period = Period105ms;
+        bool irqTout = false;
+        bool autoAvg = true;
+        bool skipCal = false;
+        bool skipReCal = false;
+        bool delCal = false;
+        bool delRef = false;
+        uint32_t measDur = MeasDur34_19;
+        uint32_t measFil = 0; // RFAL_WUM_MEAS_FIL_SLOW
+        Channel i;
+        Channel q;
+
+        static constexpr size_t WireSize = 4 + 6 + 4 + 4 + 2 * Channel::WireSize;
+
+        size_t write(uint8_t* out) const
+        {
+            size_t o = 0;
+            o += writeU32(out + o, period);
+            out[o++] = irqTout ? 1 : 0;
+            out[o++] = autoAvg ? 1 : 0;
+            out[o++] = skipCal ? 1 : 0;
+            out[o++] = skipReCal ? 1 : 0;
+            out[o++] = delCal ? 1 : 0;
+            out[o++] = delRef ? 1 : 0;
+            o += writeU32(out + o, measDur);
+            o += writeU32(out + o, measFil);
+            o += i.write(out + o);
+            o += q.write(out + o);
+            return o;
+        }
+    };
+
+    static_assert(Config::WireSize == 36, "serRfalWakeUpConfig is 36 bytes on the wire");
+
+    // rfalWakeUpModeGetInfo response after ret: irqWut, status, I{lastMeas, reference, calib, irqWu},
+    // Q{...}, WLC{irqWptFod, irqWptStop}.
+    struct Info
+    {
+        struct ChannelInfo
+        {
+            uint8_t lastMeas;
+            uint8_t reference;
+            uint8_t calib;
+            bool irqWu;
+        };
+
+        bool irqWut;
+        uint8_t status;
+        ChannelInfo i;
+        ChannelInfo q;
+
+        static constexpr size_t WireSize = 12;
+
+        bool parse(const uint8_t* buf, size_t len)
+        {
+            if (len < WireSize)
+                return false;
+            irqWut = buf[0] != 0;
+            status = buf[1];
+            i = {buf[2], buf[3], buf[4], buf[5] != 0};
+            q = {buf[6], buf[7], buf[8], buf[9] != 0};
+            return true;
+        }
+    };
+}
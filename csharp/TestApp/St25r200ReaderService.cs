@@ -37,7 +37,12 @@ public sealed class St25r200ReaderService : IDisposable
         int MaxTrackedTags = 4,
         DebugLevel Debug = DebugLevel.Errors,
         string RestBaseUri = "http://192.168.1.100/",
-        int RestTimeoutMs = 200
+        int RestTimeoutMs = 200,
+        // 0 writes each frame at once: the firmware buffers a whole request frame (the receive path
+        // assumption in linux/SerRfalWire.h). Otherwise frames go out in chunks of this many bytes,
+        // WriteChunkDelayMs apart, for firmware that cannot keep up at full baud.
+        int WriteChunkBytes = 0,
+        int WriteChunkDelayMs = 5
     );
 
     private readonly Options _opt;
@@ -254,13 +259,14 @@ public sealed class St25r200ReaderService : IDisposable
             ofs += 2; // sensRes
             ofs += 1; // selRes
             byte nfcId1Len = rsp[ofs++];
-            if (nfcId1Len > 32) throw new IOException($"nfca nfcId1Len insane: {nfcId1Len}");
+            if (nfcId1Len > 10) throw new IOException($"nfca nfcId1Len insane: {nfcId1Len}");
             ofs += nfcId1Len; // nfcId1
             ofs += 1; // nfca isSleep
 
-            // NFC-B (rfalNfcbListenDevice): sensbResLen(1) + sensbRes[5] + isSleep(1)
+            // NFC-B (rfalNfcbListenDevice): sensbResLen(1) + sensbRes[13] + isSleep(1)
+            // sensbRes = cmd(1) + nfcid0[4] + appData[4] + protInfo[4]
             _ = rsp[ofs++]; // sensbResLen
-            ofs += 5; // sensbRes
+            ofs += 13; // sensbRes
             ofs += 1; // nfcb isSleep
 
             // NFC-F (rfalNfcfListenDevice): sensfResLen(1) + sensfRes[19]
@@ -328,16 +334,16 @@ public sealed class St25r200ReaderService : IDisposable
         if (_opt.Debug >= DebugLevel.Frames)
             Log?.Invoke($"TX cmd=0x{(ushort)requestCmdId:X4} len={len} bytes={frame.Length} :: {BytesToHex(frame)}");
 
-        // Send in chunks to avoid overwhelming device RX buffer
-        const int chunkSize = 32;
+        // Paced in chunks unless WriteChunkBytes is 0
+        int chunkSize = _opt.WriteChunkBytes > 0 ? _opt.WriteChunkBytes : frame.Length;
         for (int offset = 0; offset < frame.Length; offset += chunkSize)
         {
             int bytesToSend = Math.Min(chunkSize, frame.Length - offset);
             port.Write(frame, offset, bytesToSend);
-            
+
             // Small delay between chunks (except after last chunk)
-            if (offset + bytesToSend < frame.Length)
-                Thread.Sleep(5);
+            if (offset + bytesToSend < frame.Length && _opt.WriteChunkDelayMs > 0)
+                Thread.Sleep(_opt.WriteChunkDelayMs);
         }
 
         ushort expectedRspCmd = (ushort)((ushort)requestCmdId + 1);
@@ -0,0 +1,172 @@
+// Presence event sinks; see GatewayEvents.h.
+
+#include "GatewayEvents.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Gateway
+{
+    size_t formatJson(const PresenceEvent& e, char* out, size_t outSize)
+    {
+        static const char* names[] = {"placed", "removed", "data", "followup"};
+        // Port paths and UIDs are plain ASCII (hex, '/', ':'), so nothing needs escaping.
+        int n = snprintf(out, outSize, "{\"event\":\"%s\",\"reader\":\"%s\",\"uid\":\"%s\",\"ts\":%llu",
+                         names[static_cast<int>(e.kind)], e.reader->c_str(), e.tag->uid.c_str(),
+                         static_cast<unsigned long long>(e.timeNs / 1000000));
+        if (n > 0 && static_cast<size_t>(n) < outSize && e.kind == PresenceEvent::Kind::Removed)
+            n += snprintf(out + n, outSize - n, ",\"dwellMs\":%u", e.dwellMs);
+        if (n > 0 && static_cast<size_t>(n) < outSize && e.kind == PresenceEvent::Kind::TagData)
+        {
+            n += snprintf(out + n, outSize - n, ",\"data\":\"");
+            for (uint8_t i = 0; i < e.dataLen && n > 0 && static_cast<size_t>(n) < outSize; ++i)
+                n += snprintf(out + n, outSize - n, "%02X", e.data[i]);
+            if (n > 0 && static_cast<size_t>(n) < outSize)
+                n += snprintf(out + n, outSize - n, "\"");
+        }
+        if (n > 0 && static_cast<size_t>(n) < outSize && e.kind == PresenceEvent::Kind::FollowUp)
+            n += snprintf(out + n, outSize - n, ",\"results\":%s", e.results->c_str());
+        if (n > 0 && static_cast<size_t>(n) < outSize)
+            n += snprintf(out + n, outSize - n, "}\n");
+        return n > 0 && static_cast<size_t>(n) < outSize ? static_cast<size_t>(n) : 0;
+    }
+
+    void JsonLineSink::publish(const PresenceEvent& e)
+    {
+        char line[MaxJsonLine];
+        size_t len = formatJson(e, line, sizeof(line));
+        if (len == 0)
+            return;
+        fwrite(line, 1, len, _out);
+        fflush(_out);
+    }
+
+    SocketSink::~SocketSink()
+    {
+        while (!_clients.empty())
+            drop(_clients.back().get());
+        if (_fd >= 0)
+        {
+            _reactor.remove(_fd, this);
+            close(_fd);
+            unlink(_path.c_str());
+        }
+    }
+
+    bool SocketSink::listen(const char* path, int& error)
+    {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof(addr.sun_path))
+        {
+            error = ENAMETOOLONG;
+            return false;
+        }
+        strcpy(addr.sun_path, path);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            error = errno;
+            return false;
+        }
+        unlink(path);
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, 16) != 0 ||
+            !_reactor.add(fd, EPOLLIN, this))
+        {
+            error = errno;
+            close(fd);
+            return false;
+        }
+        _fd = fd;
+        _path = path;
+        return true;
+    }
+
+    void SocketSink::onEvents(uint32_t)
+    {
+        for (;;)
+        {
+            int fd = accept4(_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+                return;
+            auto c = std::make_unique<Client>();
+            c->sink = this;
+            c->fd = fd;
+            if (!_reactor.add(fd, EPOLLIN | EPOLLRDHUP, c.get()))
+            {
+                close(fd);
+                continue;
+            }
+            _clients.push_back(std::move(c));
+        }
+    }
+
+    void SocketSink::Client::onEvents(uint32_t events)
+    {
+        // Consumers only listen; anything they send is discarded.
+        char buf[256];
+        ssize_t n;
+        while ((n = read(fd, buf, sizeof(buf))) > 0)
+        {
+        }
+        if (n == 0 || (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)))
+            sink->drop(this);
+    }
+
+    void SocketSink::drop(Client* c)
+    {
+        _reactor.remove(c->fd, c);
+        close(c->fd);
+        for (auto it = _clients.begin(); it != _clients.end(); ++it)
+        {
+            if (it->get() == c)
+            {
+                _clients.erase(it);
+                return;
+            }
+        }
+    }
+
+    void SocketSink::publish(const PresenceEvent& e)
+    {
+        char line[MaxJsonLine];
+        size_t len = formatJson(e, line, sizeof(line));
+        if (len == 0)
+            return;
+        for (size_t i = 0; i < _clients.size();)
+        {
+            Client* c = _clients[i].get();
+            ssize_t n = send(c->fd, line, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n == static_cast<ssize_t>(len))
+            {
+                ++i;
+                continue;
+            }
+            // A partial line would corrupt the stream; a consumer this far behind is dropped.
+            _dropped++;
+            drop(c);
+        }
+    }
+
+    void ShmSink::publish(const PresenceEvent& e)
+    {
+        if (e.kind == PresenceEvent::Kind::FollowUp)
+            return;
+        ShmEventRing::Event ev = {};
+        ev.timeNs = e.timeNs;
+        ev.dwellMs = e.dwellMs;
+        ev.reader = _ring.readerIndex(e.reader->c_str());
+        ev.kind = static_cast<uint8_t>(static_cast<int>(e.kind) + 1); // ShmEventRing::Kind counts from 1
+        ev.tech = e.tag->type;
+        ev.uidLen = e.tag->idLen < sizeof(ev.uid) ? e.tag->idLen : sizeof(ev.uid);
+        memcpy(ev.uid, e.tag->id, ev.uidLen);
+        ev.dataLen = e.dataLen < sizeof(ev.data) ? e.dataLen : sizeof(ev.data);
+        if (ev.dataLen)
+            memcpy(ev.data, e.data, ev.dataLen);
+        _ring.publish(ev);
+    }
+}
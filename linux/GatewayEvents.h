@@ -0,0 +1,133 @@
+#pragma once
+
+// Presence events of the gateway and the local sinks that publish them: JSON lines on a FILE*
+// (stdout by default), a Unix stream socket that any number of local consumers can connect to, and
+// a shared-memory ring (ShmEventRing.h) for consumers that want fixed binary records without a
+// syscall per event. The text sinks use the RestNotifier vocabulary (placed / removed).
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GatewayPresence.h"
+#include "Reactor.h"
+#include "ShmEventRing.h"
+
+namespace Gateway
+{
+    struct PresenceEvent
+    {
+        enum class Kind : uint8_t
+        {
+            Placed,
+            Removed,
+            TagData, // activation bytes of a newly placed tag, published right after Placed
+            FollowUp, // merged results of the follow-up jobs of one placement (GatewayFollowUp.h)
+        };
+
+        Kind kind;
+        const std::string* reader; // port path
+        const TagId* tag;          // uid "A:04A1B2C3D4E5F6", or bare hex when only NFC-V is polled
+        uint64_t timeNs;           // CLOCK_REALTIME; the JSON sinks print milliseconds
+        uint32_t dwellMs;          // Removed only: first to last sighting
+        const uint8_t* data = nullptr; // TagData only: ATQA+SAK, SENSB/SENSF tail, RES_FLAG+DSFID, chip ID
+        uint8_t dataLen = 0;
+        const std::string* results = nullptr; // FollowUp only: JSON object, job name to output
+    };
+
+    // {"event":"placed","reader":"/dev/ttyACM0","uid":"V:...","ts":1700000000000[,"dwellMs":n]}\n
+    // TagData: {"event":"data",...,"data":"440008"} with the bytes in hex.
+    // FollowUp: {"event":"followup",...,"results":{"lookup":"..."}}.
+    size_t formatJson(const PresenceEvent& e, char* out, size_t outSize);
+
+    class EventSink
+    {
+    public:
+        virtual ~EventSink() = default;
+        virtual void publish(const PresenceEvent& e) = 0;
+    };
+
+    // Fans one event out to every attached sink, in order.
+    class EventBus : public EventSink
+    {
+    public:
+        void attach(EventSink* sink) { _sinks.push_back(sink); }
+        void publish(const PresenceEvent& e) override
+        {
+            for (EventSink* s : _sinks)
+                s->publish(e);
+        }
+
+    private:
+        std::vector<EventSink*> _sinks;
+    };
+
+    // Longest line formatJson() produces: follow-up results are the only variable-length part, and
+    // FollowUp::MaxMerged keeps them within it.
+    constexpr size_t MaxJsonLine = 4096;
+
+    class JsonLineSink : public EventSink
+    {
+    public:
+        explicit JsonLineSink(FILE* out) : _out(out) {}
+        void publish(const PresenceEvent& e) override;
+
+    private:
+        FILE* _out;
+    };
+
+    // Listens on a Unix stream socket and writes every event as a JSON line to each client. Writes
+    // never block the loop: a client whose socket buffer is full is disconnected and counted.
+    class SocketSink : public EventSink, public Reactor::Handler
+    {
+    public:
+        explicit SocketSink(Reactor& reactor) : _reactor(reactor) {}
+        ~SocketSink() override;
+
+        // Replaces a stale socket file at path. Returns false with error set to errno.
+        bool listen(const char* path, int& error);
+        void publish(const PresenceEvent& e) override;
+
+        size_t clients() const { return _clients.size(); }
+        uint32_t dropped() const { return _dropped; }
+
+    private:
+        struct Client : Reactor::Handler
+        {
+            SocketSink* sink;
+            int fd;
+            void onEvents(uint32_t events) override;
+        };
+
+        void onEvents(uint32_t events) override; // listening socket
+        void drop(Client* c);
+
+        Reactor& _reactor;
+        int _fd = -1;
+        std::string _path;
+        std::vector<std::unique_ptr<Client>> _clients;
+        uint32_t _dropped = 0;
+    };
+
+    // Writes every event into the /dev/shm ring as a ShmEventRing::Event. Consumers follow it at
+    // their own pace; a consumer that falls a whole ring behind loses the oldest events, never
+    // the gateway's time. FollowUp events have free-form text and are not written.
+    class ShmSink : public EventSink
+    {
+    public:
+        // Creates /dev/shm/<name> with room for capacity events. Returns false with error set.
+        bool create(const char* name, uint32_t capacity, int& error)
+        {
+            return _ring.create(name, capacity, error);
+        }
+        void publish(const PresenceEvent& e) override;
+
+        uint64_t published() const { return _ring.published(); }
+
+    private:
+        ShmEventRing::Producer _ring;
+    };
+}
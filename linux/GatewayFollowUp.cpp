@@ -0,0 +1,197 @@
+// Follow-up jobs on a work-stealing pool; see GatewayFollowUp.h.
+
+#include "GatewayFollowUp.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace Gateway
+{
+    namespace
+    {
+        // JSON string body: quotes, backslashes and control characters escaped. Stops before a
+        // character whose escape would take out past limit bytes; false if it did.
+        bool appendEscaped(std::string& out, const std::string& s, size_t limit = std::string::npos)
+        {
+            static const char* hex = "0123456789abcdef";
+            for (unsigned char c : s)
+            {
+                size_t len = c == '"' || c == '\\' ? 2 : c < 0x20 ? 6 : 1;
+                if (out.size() + len > limit)
+                    return false;
+                if (c == '"' || c == '\\')
+                {
+                    out += '\\';
+                    out += static_cast<char>(c);
+                }
+                else if (c < 0x20)
+                {
+                    out += "\\u00";
+                    out += hex[c >> 4];
+                    out += hex[c & 0x0F];
+                }
+                else
+                    out += static_cast<char>(c);
+            }
+            return true;
+        }
+
+        std::string runCommand(const std::string& command, const FollowUpInput& in, uint32_t timeoutMs)
+        {
+            int fds[2];
+            if (pipe2(fds, O_CLOEXEC) != 0)
+                return "error pipe";
+            posix_spawn_file_actions_t actions;
+            posix_spawn_file_actions_init(&actions);
+            posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+            posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+            // Own process group, so a timeout kills whatever the shell started too.
+            posix_spawnattr_t attr;
+            posix_spawnattr_init(&attr);
+            posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+            posix_spawnattr_setpgroup(&attr, 0);
+
+            // UID and port path are positional parameters, never part of the shell text.
+            const char* argv[] = {"sh", "-c", command.c_str(), "sh", in.tag.uid.c_str(), in.reader.c_str(), nullptr};
+            pid_t pid;
+            int rc = posix_spawn(&pid, "/bin/sh", &actions, &attr, const_cast<char* const*>(argv), environ);
+            posix_spawnattr_destroy(&attr);
+            posix_spawn_file_actions_destroy(&actions);
+            close(fds[1]);
+            if (rc != 0)
+            {
+                close(fds[0]);
+                return "error spawn";
+            }
+
+            std::string output;
+            char buf[512];
+            bool timedOut = false;
+            uint64_t deadlineUs = Reactor::nowUs() + static_cast<uint64_t>(timeoutMs) * 1000;
+            for (;;)
+            {
+                uint64_t now = Reactor::nowUs();
+                if (now >= deadlineUs)
+                {
+                    timedOut = true;
+                    break;
+                }
+                pollfd pfd = {fds[0], POLLIN, 0};
+                int ready = poll(&pfd, 1, static_cast<int>((deadlineUs - now + 999) / 1000));
+                if (ready < 0 && errno == EINTR)
+                    continue;
+                if (ready <= 0)
+                {
+                    timedOut = ready == 0;
+                    break;
+                }
+                ssize_t n = read(fds[0], buf, sizeof(buf));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    break;
+                if (output.size() < FollowUp::MaxResult)
+                    output.append(buf, static_cast<size_t>(n));
+            }
+            close(fds[0]);
+            if (timedOut)
+                kill(-pid, SIGKILL);
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (timedOut)
+                return "timeout";
+
+            size_t eol = output.find('\n');
+            if (eol != std::string::npos)
+                output.resize(eol);
+            if (output.empty() && !(WIFEXITED(status) && WEXITSTATUS(status) == 0))
+                output = "exit " + std::to_string(WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+            return output;
+        }
+    }
+
+    FollowUpJob execJob(const std::string& name, const std::string& command, uint32_t timeoutMs)
+    {
+        return {name, [command, timeoutMs](const FollowUpInput& in) { return runCommand(command, in, timeoutMs); }};
+    }
+
+    FollowUp::FollowUp(Reactor& reactor, WorkPool& pool, EventSink& out, size_t maxPending)
+        : _reactor(reactor), _pool(pool), _out(out), _maxPending(maxPending), _self(std::make_shared<FollowUp*>(this))
+    {
+    }
+
+    void FollowUp::publish(const PresenceEvent& e)
+    {
+        if (e.kind != PresenceEvent::Kind::Placed || _jobs.empty())
+            return;
+        if (_pending.size() >= _maxPending)
+        {
+            _dropped++;
+            return;
+        }
+        uint64_t id = _nextId++;
+        Placement& p = _pending[id];
+        p.input = {*e.reader, *e.tag, e.timeNs};
+        p.remaining = _jobs.size();
+
+        std::weak_ptr<FollowUp*> self = _self;
+        Reactor* reactor = &_reactor;
+        for (const FollowUpJob& job : _jobs)
+        {
+            // Jobs own copies of everything: this sink may be gone before a pool thread gets to them.
+            _pool.submit([reactor, self, id, job, input = p.input] {
+                std::string result = job.run(input);
+                if (result.size() > MaxResult)
+                    result.resize(MaxResult);
+                reactor->post([self, id, name = job.name, result = std::move(result)] {
+                    if (std::shared_ptr<FollowUp*> alive = self.lock())
+                        (*alive)->done(id, name, result);
+                });
+            });
+        }
+    }
+
+    void FollowUp::done(uint64_t id, const std::string& job, const std::string& result)
+    {
+        auto it = _pending.find(id);
+        if (it == _pending.end())
+            return;
+        Placement& p = it->second;
+        // Results are cut to keep the followup line within MaxJsonLine; a member whose name does
+        // not fit is left out.
+        size_t mark = p.results.size();
+        if (!p.results.empty())
+            p.results += ',';
+        p.results += '"';
+        appendEscaped(p.results, job);
+        p.results += "\":\"";
+        if (p.results.size() < MaxMerged)
+        {
+            p.truncated = !appendEscaped(p.results, result, MaxMerged - 1) || p.truncated;
+            p.results += '"';
+        }
+        else
+        {
+            p.results.resize(mark);
+            p.truncated = true;
+        }
+        if (--p.remaining > 0)
+            return;
+
+        _completed++;
+        if (p.truncated)
+            _truncated++;
+        std::string object = "{" + p.results + "}";
+        PresenceEvent e = {PresenceEvent::Kind::FollowUp, &p.input.reader, &p.input.tag, p.input.timeNs, 0};
+        e.results = &object;
+        _out.publish(e);
+        _pending.erase(it);
+    }
+}
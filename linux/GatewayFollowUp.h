@@ -0,0 +1,92 @@
+#pragma once
+
+// Follow-up work for newly placed tags (backend lookups, signature or CPU-heavy checks) on a
+// WorkPool, so a slow job never delays the next discovery round. RF work stays on each reader's
+// Port and loop; jobs only get copies of the event. The results of one placement are merged by
+// UID on the loop thread and published as a single FollowUp event once every job has finished.
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GatewayEvents.h"
+#include "WorkPool.h"
+
+namespace Gateway
+{
+    // What a job sees: copies, since it runs on a pool thread after the event is gone.
+    struct FollowUpInput
+    {
+        std::string reader;
+        TagId tag;
+        uint64_t timeNs;
+    };
+
+    struct FollowUpJob
+    {
+        std::string name;
+        // Runs on a pool thread; the returned text is the job's result (truncated to MaxResult).
+        std::function<std::string(const FollowUpInput&)> run;
+    };
+
+    // Runs `/bin/sh -c command sh <uid> <reader>` and returns the first line of its output, or
+    // "exit <status>" when it fails without output. A command still running after timeoutMs is
+    // killed with its process group and reports "timeout", so a hung one cannot hold a pool thread
+    // or its placement.
+    constexpr uint32_t DefaultJobTimeoutMs = 10000;
+    FollowUpJob execJob(const std::string& name, const std::string& command,
+                        uint32_t timeoutMs = DefaultJobTimeoutMs);
+
+    class FollowUp : public EventSink
+    {
+    public:
+        static constexpr size_t MaxResult = 256;
+        // Escaped results of one placement; the rest of a followup line fits in what is left of
+        // MaxJsonLine. Longer results are cut and the placement counted as truncated.
+        static constexpr size_t MaxMerged = MaxJsonLine - 512;
+
+        // Results are published to out, which may be the bus this sink is attached to. At most
+        // maxPending placements wait for results; further ones are dropped and counted.
+        FollowUp(Reactor& reactor, WorkPool& pool, EventSink& out, size_t maxPending = 256);
+        FollowUp(const FollowUp&) = delete;
+        FollowUp& operator=(const FollowUp&) = delete;
+
+        void add(FollowUpJob job) { _jobs.push_back(std::move(job)); }
+        bool empty() const { return _jobs.empty(); }
+
+        void publish(const PresenceEvent& e) override;
+
+        size_t pending() const { return _pending.size(); }
+        uint64_t completed() const { return _completed; }
+        uint64_t dropped() const { return _dropped; }
+        uint64_t truncated() const { return _truncated; }
+
+    private:
+        struct Placement
+        {
+            FollowUpInput input;
+            size_t remaining;
+            std::string results; // JSON object members, in completion order
+            bool truncated = false;
+        };
+
+        void done(uint64_t id, const std::string& job, const std::string& result);
+
+        Reactor& _reactor;
+        WorkPool& _pool;
+        EventSink& _out;
+        size_t _maxPending;
+        std::vector<FollowUpJob> _jobs;
+        std::unordered_map<uint64_t, Placement> _pending;
+        uint64_t _nextId = 1;
+        uint64_t _completed = 0;
+        uint64_t _dropped = 0;
+        uint64_t _truncated = 0;
+        // Results posted by pool threads reach the loop only while this sink exists.
+        std::shared_ptr<FollowUp*> _self;
+    };
+}
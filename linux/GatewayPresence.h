@@ -0,0 +1,83 @@
+#pragma once
+
+// Host twin of arduino/PresenceTracker.h for the gateway: the tag set of one reader and the
+// placed/removed delta of each update, without the 4-tag limit of the firmware.
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace Gateway
+{
+    // A tag as one discovery round reported it: the text form used in events and logs, plus the
+    // raw identity for binary consumers.
+    struct TagId
+    {
+        std::string uid;  // formatted, see GatewayReader.cpp formatUid()
+        uint8_t type = 0; // rfalNfcDevType
+        uint8_t idLen = 0;
+        uint8_t id[10] = {}; // wire byte order; NFC-A triple-size UIDs are the longest
+    };
+
+    struct Sighting
+    {
+        TagId tag;
+        uint64_t firstSeenMs;
+        uint64_t lastSeenMs;
+    };
+
+    struct PresenceDelta
+    {
+        std::vector<TagId> placed;
+        std::vector<Sighting> removed; // as last seen, for the dwell time
+    };
+
+    class PresenceTracker
+    {
+    public:
+        // nowTags is the complete set seen in this round; anything tracked but missing is removed.
+        PresenceDelta update(const std::vector<TagId>& nowTags, uint64_t nowMs)
+        {
+            PresenceDelta delta;
+            std::vector<Sighting> next;
+            next.reserve(nowTags.size());
+            for (const TagId& tag : nowTags)
+            {
+                if (find(next, tag.uid))
+                    continue; // the same tag reported twice in one round
+                if (Sighting* s = find(_tags, tag.uid))
+                    next.push_back({tag, s->firstSeenMs, nowMs});
+                else
+                {
+                    next.push_back({tag, nowMs, nowMs});
+                    delta.placed.push_back(tag);
+                }
+            }
+            for (const Sighting& s : _tags)
+            {
+                if (!find(next, s.tag.uid))
+                    delta.removed.push_back(s);
+            }
+            _tags.swap(next);
+            return delta;
+        }
+
+        // Current set, in the order of the last update.
+        const std::vector<Sighting>& tags() const { return _tags; }
+        bool empty() const { return _tags.empty(); }
+
+    private:
+        static Sighting* find(std::vector<Sighting>& tags, const std::string& uid)
+        {
+            for (Sighting& s : tags)
+            {
+                if (s.tag.uid == uid)
+                    return &s;
+            }
+            return nullptr;
+        }
+
+        std::vector<Sighting> _tags;
+    };
+}
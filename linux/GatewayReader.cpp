@@ -0,0 +1,266 @@
+// Gateway reader loop; see GatewayReader.h.
+
+#include "GatewayReader.h"
+
+#include <string.h>
+#include <time.h>
+
+using namespace SerRfalAsync;
+
+namespace Gateway
+{
+    namespace
+    {
+        uint64_t nowMs()
+        {
+            return Reactor::nowUs() / 1000;
+        }
+
+        uint64_t wallNs()
+        {
+            timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+        }
+
+        const char* techTag(rfalNfcDevType type)
+        {
+            switch (type)
+            {
+                case RFAL_NFC_LISTEN_TYPE_NFCA: return "A";
+                case RFAL_NFC_LISTEN_TYPE_NFCB: return "B";
+                case RFAL_NFC_LISTEN_TYPE_NFCF: return "F";
+                case RFAL_NFC_LISTEN_TYPE_NFCV: return "V";
+                case RFAL_NFC_LISTEN_TYPE_ST25TB: return "TB";
+                default: return "?";
+            }
+        }
+
+        // Same text as St25r200Reader::formatUid: wire byte order, tech-tagged unless only NFC-V
+        // is polled, so the gateway and the Portenta reader report a tag identically.
+        std::string formatUid(rfalNfcDevType type, const uint8_t* id, size_t len, bool techTagged)
+        {
+            static const char* hex = "0123456789ABCDEF";
+            std::string s;
+            if (techTagged)
+            {
+                s = techTag(type);
+                s += ':';
+            }
+            for (size_t i = 0; i < len; ++i)
+            {
+                s += hex[id[i] >> 4];
+                s += hex[id[i] & 0x0F];
+            }
+            return s;
+        }
+
+        TagId makeTag(rfalNfcDevType type, const uint8_t* id, size_t len, bool techTagged)
+        {
+            TagId tag;
+            tag.uid = formatUid(type, id, len, techTagged);
+            tag.type = static_cast<uint8_t>(type);
+            tag.idLen = static_cast<uint8_t>(len < sizeof(tag.id) ? len : sizeof(tag.id));
+            memcpy(tag.id, id, tag.idLen);
+            return tag;
+        }
+    }
+
+    Reader::Reader(Reactor& reactor, const std::string& path, const ReaderOptions& options, EventSink& events)
+        : _reactor(reactor), _path(path), _opt(options), _events(events), _port(reactor)
+    {
+        _port.setTimeout(_opt.timeoutMs);
+    }
+
+    bool Reader::open(int32_t& error)
+    {
+        return _port.open(_path.c_str(), error);
+    }
+
+    void Reader::start(std::function<void(Reader&)> onExit)
+    {
+        _onExit = std::move(onExit);
+        run();
+    }
+
+    void Reader::stop()
+    {
+        _stopping = true;
+        _port.close();
+    }
+
+    // Counts a failed request; true when the loop should end.
+    template <typename T>
+    bool Reader::failed(const Result<T>& r)
+    {
+        if (r.ok())
+        {
+            _consecutiveErrors = 0;
+            return false;
+        }
+        _counters.errors++;
+        if (r.status == Status::PortError || r.status == Status::Closed)
+            return true;
+        return ++_consecutiveErrors >= _opt.maxErrors;
+    }
+
+    // Results are awaited into locals: GCC 12 mis-handles co_await inside a call argument.
+    Task Reader::run()
+    {
+        serRfalNfcDiscoverParam discParam;
+        serRfalNfcDefaultDiscParams(&discParam);
+        discParam.devLimit = _opt.devLimit;
+        discParam.totalDuration = _opt.discoverMs;
+        discParam.techs2Find = _opt.techs;
+        discParam.wakeupEnabled = false;
+        discParam.wakeupConfigDefault = false;
+        discParam.wakeupNPolls = 0;
+
+        Result<ReturnCode> ret = co_await _port.rfalInitialize();
+        bool alive = !failed(ret);
+        if (alive)
+        {
+            ret = co_await _port.rfalNfcInitialize();
+            alive = !failed(ret);
+        }
+
+        while (alive && !_stopping)
+        {
+            ret = co_await _port.rfalNfcDiscover(discParam);
+            if (failed(ret))
+                break;
+            _counters.rounds++;
+
+            for (;;)
+            {
+                Result<rfalNfcState> state = co_await _port.rfalNfcGetState();
+                if (failed(state))
+                {
+                    alive = false;
+                    break;
+                }
+                if (state.value == RFAL_NFC_STATE_ACTIVATED || state.value == RFAL_NFC_STATE_POLL_SELECT)
+                {
+                    Result<Devices> devices = co_await _port.rfalNfcGetDevicesFound();
+                    if (failed(devices))
+                        alive = devices.status != Status::PortError && devices.status != Status::Closed;
+                    else if (devices.value.ret == RFAL_ERR_NONE)
+                    {
+                        std::vector<TagId> tags;
+                        std::vector<TagData> data;
+                        collect(devices.value.list, tags, data);
+                        _counters.sightings++;
+                        _lastSightingMs = nowMs();
+                        publish(tags, data);
+                    }
+                    break;
+                }
+                // Discovery never reaches Activated with an empty field, so absence is a timeout.
+                if (!_tracker.empty() && nowMs() - _lastSightingMs > _opt.absentAfterMs)
+                    publish({});
+                if (_stopping)
+                    break;
+                co_await delay(_reactor, _opt.pollMs);
+            }
+            if (!alive)
+                break;
+            ret = co_await _port.rfalNfcDeactivate(RFAL_NFC_DEACTIVATE_IDLE);
+            if (failed(ret))
+                break;
+        }
+        finish();
+    }
+
+    void Reader::collect(const std::vector<serFlatRfalNfcDevice>& devices, std::vector<TagId>& tags,
+                         std::vector<TagData>& data) const
+    {
+        bool tagged = _opt.techs != RFAL_NFC_POLL_TECH_V;
+        auto add = [&](rfalNfcDevType type, const uint8_t* id, size_t idLen, const uint8_t* bytes, size_t len) {
+            tags.push_back(makeTag(type, id, idLen, tagged));
+            TagData d;
+            d.len = static_cast<uint8_t>(len < sizeof(d.bytes) ? len : sizeof(d.bytes));
+            memcpy(d.bytes, bytes, d.len);
+            data.push_back(d);
+        };
+        for (const serFlatRfalNfcDevice& d : devices)
+        {
+            switch (d.type)
+            {
+                case RFAL_NFC_LISTEN_TYPE_NFCA:
+                {
+                    uint8_t atqaSak[3] = {d.nfca.sensRes.anticollisionInfo, d.nfca.sensRes.platformInfo,
+                                          d.nfca.selRes.sak};
+                    add(d.type, d.nfca.nfcId1, d.nfca.nfcId1Len, atqaSak, sizeof(atqaSak));
+                    break;
+                }
+                case RFAL_NFC_LISTEN_TYPE_NFCB:
+                {
+                    // Application data and protocol info: the SENSB_RES after its command byte and PUPI.
+                    size_t tail = d.nfcb.sensbResLen > 1 + RFAL_NFCB_NFCID0_LEN
+                                      ? d.nfcb.sensbResLen - 1 - RFAL_NFCB_NFCID0_LEN : 0;
+                    size_t room = sizeof(d.nfcb.sensbRes.appData) + sizeof(d.nfcb.sensbRes.protInfo);
+                    add(d.type, d.nfcb.sensbRes.nfcid0, RFAL_NFCB_NFCID0_LEN,
+                        reinterpret_cast<const uint8_t*>(&d.nfcb.sensbRes.appData), tail < room ? tail : room);
+                    break;
+                }
+                case RFAL_NFC_LISTEN_TYPE_NFCF:
+                {
+                    // PAD0 through RD: the SENSF_RES after its command byte and NFCID2.
+                    size_t tail = d.nfcf.sensfResLen > 1 + RFAL_NFCF_NFCID2_LEN
+                                      ? d.nfcf.sensfResLen - 1 - RFAL_NFCF_NFCID2_LEN : 0;
+                    size_t room = sizeof(d.nfcf.sensfRes) - 1 - RFAL_NFCF_NFCID2_LEN;
+                    add(d.type, d.nfcf.sensfRes.NFCID2, RFAL_NFCF_NFCID2_LEN, d.nfcf.sensfRes.PAD0,
+                        tail < room ? tail : room);
+                    break;
+                }
+                case RFAL_NFC_LISTEN_TYPE_NFCV:
+                    add(d.type, d.nfcv.InvRes.UID, sizeof(d.nfcv.InvRes.UID), &d.nfcv.InvRes.RES_FLAG, 2);
+                    break;
+                case RFAL_NFC_LISTEN_TYPE_ST25TB:
+                    add(d.type, d.st25tb.UID, RFAL_ST25TB_UID_LEN, &d.st25tb.chipID, 1);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    void Reader::publish(const std::vector<TagId>& tags, const std::vector<TagData>& data)
+    {
+        uint64_t now = nowMs();
+        PresenceDelta delta = _tracker.update(tags, now);
+        uint64_t wall = wallNs();
+        for (const TagId& tag : delta.placed)
+        {
+            _counters.placed++;
+            _events.publish({PresenceEvent::Kind::Placed, &_path, &tag, wall, 0});
+            for (size_t i = 0; i < tags.size() && i < data.size(); ++i)
+            {
+                if (tags[i].uid == tag.uid && data[i].len)
+                {
+                    _events.publish({PresenceEvent::Kind::TagData, &_path, &tag, wall, 0, data[i].bytes, data[i].len});
+                    break;
+                }
+            }
+        }
+        for (const Sighting& s : delta.removed)
+        {
+            _counters.removed++;
+            uint32_t dwell = static_cast<uint32_t>(s.lastSeenMs - s.firstSeenMs);
+            _events.publish({PresenceEvent::Kind::Removed, &_path, &s.tag, wall, dwell});
+        }
+    }
+
+    void Reader::finish()
+    {
+        // A reader that goes away takes its tags with it.
+        if (!_tracker.empty())
+            publish({});
+        _port.close();
+        // The coroutine frame is still running; hand over once it has returned.
+        _reactor.after(0, [this] {
+            if (_onExit)
+                _onExit(*this);
+        });
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// One reader of the gateway: a SerRfalAsync::Port and the coroutine that keeps it discovering
+// (initialize, discover, poll the state, read the devices, deactivate, repeat), feeding a
+// PresenceTracker and publishing placed/removed events. Polling waits are reactor timers, so one
+// thread runs every reader.
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "GatewayEvents.h"
+#include "GatewayPresence.h"
+#include "SerRfalAsync.h"
+
+namespace Gateway
+{
+    struct ReaderOptions
+    {
+        uint16_t techs = RFAL_NFC_POLL_TECH_A | RFAL_NFC_POLL_TECH_B | RFAL_NFC_POLL_TECH_F |
+                         RFAL_NFC_POLL_TECH_V | RFAL_NFC_POLL_TECH_ST25TB;
+        uint8_t devLimit = 4;
+        uint16_t discoverMs = 200;   // totalDuration of one discovery round
+        uint32_t pollMs = 10;        // between rfalNfcGetState polls (the console sleeps 100)
+        uint32_t absentAfterMs = 1000; // empty field for this long removes the tracked tags
+        uint32_t timeoutMs = 200;    // per request
+        uint8_t maxErrors = 5;       // consecutive failed requests before the port is reopened
+    };
+
+    // Totals since the reader was opened; the gateway reports per-interval deltas.
+    struct ReaderCounters
+    {
+        uint64_t rounds = 0;    // discovery rounds
+        uint64_t sightings = 0; // rounds that reached activation
+        uint64_t placed = 0;
+        uint64_t removed = 0;
+        uint64_t errors = 0;    // failed requests
+    };
+
+    class Reader
+    {
+    public:
+        Reader(Reactor& reactor, const std::string& path, const ReaderOptions& options, EventSink& events);
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        bool open(int32_t& error);
+
+        // Starts the discovery loop. onExit runs from the loop once it has ended (port error,
+        // hang-up, too many errors or stop()), after the port is closed; it may destroy the Reader.
+        void start(std::function<void(Reader&)> onExit);
+        // Closes the port; tracked tags are published as removed and the loop ends.
+        void stop();
+
+        const std::string& path() const { return _path; }
+        SerRfalAsync::Port& port() { return _port; }
+        const ReaderCounters& counters() const { return _counters; }
+        const PresenceTracker& presence() const { return _tracker; }
+
+    private:
+        SerRfalAsync::Task run();
+        template <typename T>
+        bool failed(const SerRfalAsync::Result<T>& r);
+        // Activation bytes of one tag, carried by the TagData event.
+        struct TagData
+        {
+            uint8_t len = 0;
+            uint8_t bytes[16];
+        };
+
+        void collect(const std::vector<serFlatRfalNfcDevice>& devices, std::vector<TagId>& tags,
+                     std::vector<TagData>& data) const;
+        void publish(const std::vector<TagId>& tags, const std::vector<TagData>& data = {});
+        void finish();
+
+        Reactor& _reactor;
+        std::string _path;
+        ReaderOptions _opt;
+        EventSink& _events;
+        SerRfalAsync::Port _port;
+        std::function<void(Reader&)> _onExit;
+
+        PresenceTracker _tracker;
+        uint64_t _lastSightingMs = 0;
+        ReaderCounters _counters;
+        uint8_t _consecutiveErrors = 0;
+        bool _stopping = false;
+    };
+}
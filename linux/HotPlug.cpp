@@ -0,0 +1,103 @@
+// Serial port hot-plug; see HotPlug.h.
+
+#include "HotPlug.h"
+
+#include <errno.h>
+#include <fnmatch.h>
+#include <glob.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+HotPlug::~HotPlug()
+{
+    if (_fd >= 0)
+    {
+        _reactor.remove(_fd, this);
+        close(_fd);
+    }
+}
+
+bool HotPlug::watch(const std::vector<std::string>& patterns, int& error)
+{
+    _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_fd < 0)
+    {
+        error = errno;
+        return false;
+    }
+    _patterns = patterns;
+    for (const std::string& pattern : patterns)
+    {
+        size_t slash = pattern.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : pattern.substr(0, slash ? slash : 1);
+        std::string base = slash == std::string::npos ? pattern : pattern.substr(slash + 1);
+
+        auto it = std::find_if(_dirs.begin(), _dirs.end(), [&](const Dir& d) { return d.path == dir; });
+        if (it == _dirs.end())
+        {
+            int wd = inotify_add_watch(_fd, dir.c_str(), IN_CREATE | IN_DELETE | IN_ATTRIB | IN_MOVED_TO | IN_MOVED_FROM);
+            if (wd < 0)
+            {
+                error = errno;
+                return false;
+            }
+            _dirs.push_back({wd, dir, {}});
+            it = _dirs.end() - 1;
+        }
+        it->globs.push_back(base);
+    }
+    if (!_reactor.add(_fd, EPOLLIN, this))
+    {
+        error = errno;
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> HotPlug::scan() const
+{
+    std::vector<std::string> paths;
+    for (const std::string& pattern : _patterns)
+    {
+        glob_t g;
+        if (glob(pattern.c_str(), 0, nullptr, &g) == 0)
+        {
+            for (size_t i = 0; i < g.gl_pathc; ++i)
+                paths.push_back(g.gl_pathv[i]);
+        }
+        globfree(&g);
+    }
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    return paths;
+}
+
+void HotPlug::onEvents(uint32_t)
+{
+    alignas(inotify_event) char buf[4096];
+    for (;;)
+    {
+        ssize_t n = read(_fd, buf, sizeof(buf));
+        if (n <= 0)
+            return;
+        for (char* p = buf; p < buf + n;)
+        {
+            const inotify_event* ev = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + ev->len;
+            if (ev->len == 0)
+                continue;
+            for (const Dir& d : _dirs)
+            {
+                if (d.wd != ev->wd)
+                    continue;
+                bool match = std::any_of(d.globs.begin(), d.globs.end(), [&](const std::string& g) {
+                    return fnmatch(g.c_str(), ev->name, 0) == 0;
+                });
+                if (match && onChange)
+                    onChange(d.path + "/" + ev->name, (ev->mask & (IN_DELETE | IN_MOVED_FROM)) == 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+// Serial port hot-plug on a Reactor: inotify on the directories of a set of glob patterns
+// (default /dev/ttyACM* and /dev/ttyUSB*), reporting matching nodes as they appear and vanish.
+// udev creates the node before it sets its permissions, so IN_ATTRIB also counts as an appearance.
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Reactor.h"
+
+class HotPlug : public Reactor::Handler
+{
+public:
+    explicit HotPlug(Reactor& reactor) : _reactor(reactor) {}
+    ~HotPlug() override;
+    HotPlug(const HotPlug&) = delete;
+    HotPlug& operator=(const HotPlug&) = delete;
+
+    // added is true for a created (or re-permissioned) node, false for a deleted one. A node may be
+    // reported as added more than once.
+    std::function<void(const std::string& path, bool added)> onChange;
+
+    // Starts watching; returns false with error set to errno.
+    bool watch(const std::vector<std::string>& patterns, int& error);
+    // Paths matching the patterns now, sorted.
+    std::vector<std::string> scan() const;
+
+private:
+    struct Dir
+    {
+        int wd;
+        std::string path;                 // without the trailing '/'
+        std::vector<std::string> globs;   // basename patterns
+    };
+
+    void onEvents(uint32_t events) override;
+
+    Reactor& _reactor;
+    int _fd = -1;
+    std::vector<std::string> _patterns;
+    std::vector<Dir> _dirs;
+};
@@ -0,0 +1,180 @@
+#include "Reactor.h"
+
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+Reactor::Reactor()
+{
+    _epfd = epoll_create1(EPOLL_CLOEXEC);
+    _wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_epfd >= 0 && _wakefd >= 0)
+    {
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr; // the wake-up fd is the only registration without a handler
+        epoll_ctl(_epfd, EPOLL_CTL_ADD, _wakefd, &ev);
+    }
+}
+
+Reactor::~Reactor()
+{
+    if (_wakefd >= 0)
+        close(_wakefd);
+    if (_epfd >= 0)
+        close(_epfd);
+}
+
+uint64_t Reactor::nowUs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+bool Reactor::add(int fd, uint32_t events, Handler* handler)
+{
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.ptr = handler;
+    return epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+bool Reactor::modify(int fd, uint32_t events, Handler* handler)
+{
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.ptr = handler;
+    return epoll_ctl(_epfd, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+void Reactor::remove(int fd, Handler* handler)
+{
+    epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, nullptr);
+    // The handler may be destroyed right after this; drop its events still queued in this batch.
+    for (int i = _batchNext; i < _batchCount; ++i)
+    {
+        if (_events[i].data.ptr == handler)
+            _events[i].events = 0;
+    }
+}
+
+Reactor::TimerId Reactor::at(uint64_t deadlineUs, std::function<void()> fn)
+{
+    TimerId id = _nextTimer++;
+    _timers.emplace(std::make_pair(deadlineUs, id), std::move(fn));
+    _timerDeadlines.emplace(id, deadlineUs);
+    return id;
+}
+
+Reactor::TimerId Reactor::after(uint32_t delayMs, std::function<void()> fn)
+{
+    return at(nowUs() + delayMs * 1000ULL, std::move(fn));
+}
+
+bool Reactor::cancel(TimerId id)
+{
+    auto it = _timerDeadlines.find(id);
+    if (it == _timerDeadlines.end())
+        return false;
+    _timers.erase(std::make_pair(it->second, id));
+    _timerDeadlines.erase(it);
+    return true;
+}
+
+void Reactor::stop()
+{
+    _stop = true;
+    uint64_t one = 1;
+    ssize_t n = write(_wakefd, &one, sizeof(one));
+    (void)n;
+}
+
+void Reactor::post(std::function<void()> fn)
+{
+    {
+        std::lock_guard<std::mutex> lock(_postLock);
+        _posted.push_back(std::move(fn));
+    }
+    uint64_t one = 1;
+    ssize_t n = write(_wakefd, &one, sizeof(one));
+    (void)n;
+}
+
+void Reactor::runPosted()
+{
+    {
+        std::lock_guard<std::mutex> lock(_postLock);
+        _running.swap(_posted);
+    }
+    // Callbacks may post again; those run on the next wake-up.
+    for (std::function<void()>& fn : _running)
+        fn();
+    _running.clear();
+}
+
+int Reactor::waitMs(int maxWaitMs) const
+{
+    if (_timers.empty())
+        return maxWaitMs;
+    uint64_t next = _timers.begin()->first.first;
+    uint64_t now = nowUs();
+    if (next <= now)
+        return 0;
+    uint64_t ms = (next - now + 999) / 1000;
+    return maxWaitMs >= 0 && ms > static_cast<uint64_t>(maxWaitMs) ? maxWaitMs : static_cast<int>(ms);
+}
+
+void Reactor::runTimers()
+{
+    // Only timers due at entry run now; ones added meanwhile (even with a zero delay) wait for the
+    // next pass, so a timer that reschedules itself cannot starve fd events.
+    uint64_t now = nowUs();
+    _due.clear();
+    for (auto it = _timers.begin(); it != _timers.end() && it->first.first <= now; ++it)
+        _due.push_back(it->first.second);
+
+    for (TimerId id : _due)
+    {
+        auto d = _timerDeadlines.find(id);
+        if (d == _timerDeadlines.end())
+            continue; // cancelled by an earlier callback of this pass
+        auto it = _timers.find(std::make_pair(d->second, id));
+        std::function<void()> fn = std::move(it->second);
+        _timers.erase(it);
+        _timerDeadlines.erase(d);
+        fn();
+    }
+}
+
+void Reactor::runOnce(int maxWaitMs)
+{
+    int n = epoll_wait(_epfd, _events, MaxEvents, waitMs(maxWaitMs));
+    if (n < 0 && errno != EINTR)
+        return;
+    _batchCount = n > 0 ? n : 0;
+    for (_batchNext = 0; _batchNext < _batchCount;)
+    {
+        epoll_event ev = _events[_batchNext++];
+        if (ev.data.ptr == nullptr)
+        {
+            uint64_t count;
+            ssize_t r = read(_wakefd, &count, sizeof(count));
+            (void)r;
+            runPosted();
+            continue;
+        }
+        if (ev.events)
+            static_cast<Handler*>(ev.data.ptr)->onEvents(ev.events);
+    }
+    _batchCount = 0;
+    runTimers();
+}
+
+void Reactor::run()
+{
+    _stop = false;
+    while (!_stop)
+        runOnce(-1);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Single-threaded epoll loop: fd readiness goes to a Handler, timers run callbacks at a monotonic
+// deadline. Everything registered with a reactor runs on the thread that calls run(); only post()
+// and stop() may be called from another thread, and only stop() from a signal handler.
+class Reactor
+{
+public:
+    using TimerId = uint64_t;
+
+    class Handler
+    {
+    public:
+        virtual ~Handler() = default;
+        virtual void onEvents(uint32_t events) = 0; // EPOLLIN / EPOLLOUT / EPOLLERR / EPOLLHUP
+    };
+
+    Reactor();
+    ~Reactor();
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    bool valid() const { return _epfd >= 0; }
+
+    bool add(int fd, uint32_t events, Handler* handler);
+    bool modify(int fd, uint32_t events, Handler* handler);
+    void remove(int fd, Handler* handler);
+
+    // Runs fn once at deadlineUs (CLOCK_MONOTONIC, see nowUs()) or after delayMs. A zero delay runs
+    // on the next loop iteration, never inside the call.
+    TimerId at(uint64_t deadlineUs, std::function<void()> fn);
+    TimerId after(uint32_t delayMs, std::function<void()> fn);
+    bool cancel(TimerId id);
+
+    // Runs fn on the loop thread at its next iteration. Thread-safe: worker threads hand results
+    // back with it.
+    void post(std::function<void()> fn);
+
+    void run();                  // until stop()
+    void runOnce(int maxWaitMs); // one epoll_wait (shortened to the next timer) and its callbacks
+    void stop();
+    bool stopping() const { return _stop; }
+
+    static uint64_t nowUs();
+
+private:
+    static constexpr int MaxEvents = 64;
+
+    void runTimers();
+    void runPosted();
+    int waitMs(int maxWaitMs) const;
+
+    int _epfd = -1;
+    int _wakefd = -1; // eventfd; stop() and post() write it
+    volatile bool _stop = false;
+
+    std::mutex _postLock;
+    std::vector<std::function<void()>> _posted;
+    std::vector<std::function<void()>> _running;
+
+    epoll_event _events[MaxEvents];
+    int _batchNext = 0; // events [_batchNext, _batchCount) of the current batch are undispatched
+    int _batchCount = 0;
+
+    TimerId _nextTimer = 1;
+    std::map<std::pair<uint64_t, TimerId>, std::function<void()>> _timers;
+    std::unordered_map<TimerId, uint64_t> _timerDeadlines;
+    std::vector<TimerId> _due;
+};
@@ -0,0 +1,500 @@
+// ST25R200 register shadow; see RegShadow.h.
+
+#include "RegShadow.h"
+
+#include "SerRfalWire.h"
+
+using namespace SerRfalWire;
+
+namespace
+{
+    // Everything from 0x20 up is treated as volatile: the wake-up measurement, FIFO, collision, IRQ
+    // and display registers live there. The few configuration registers among them (IRQ masks,
+    // wake-up setup) are cheap to leave uncached; setKind() caches them where it matters. 0x3F is
+    // the IC identity, which never changes.
+    constexpr uint16_t FirstVolatile = 0x20;
+    constexpr uint16_t LastVolatile = 0x3E;
+
+    // A run of changed registers absorbs up to this many unchanged known ones between them: an
+    // extra byte in the SPI burst is cheaper than another request.
+    constexpr uint16_t MaxGap = 8;
+
+    bool unsupported(ReturnCode ret)
+    {
+        return ret == RFAL_ERR_NOT_IMPLEMENTED || ret == RFAL_ERR_NOTSUPP;
+    }
+}
+
+RegShadow::RegShadow()
+{
+    for (uint16_t reg = FirstVolatile; reg <= LastVolatile; ++reg)
+        _volatile.set(reg);
+    serGetChipEpoch(_epoch);
+}
+
+void RegShadow::setKind(uint16_t reg, Kind kind)
+{
+    if (reg >= RegCount)
+        return;
+    _volatile.set(reg, kind == Kind::Volatile);
+    if (kind == Kind::Volatile)
+        _known.reset(reg);
+}
+
+void RegShadow::invalidate()
+{
+    _known.reset();
+    _dirty.reset();
+    _testKnown.reset();
+}
+
+// Drops the values when another command may have changed the chip since the shadow last looked.
+// Pending writes are the host's intent and survive.
+void RegShadow::sync()
+{
+    uint32_t epoch = 0;
+    serGetChipEpoch(epoch);
+    if (epoch == _epoch)
+        return;
+    _epoch = epoch;
+    if ((_known & ~_dirty).any() || _testKnown.any())
+        _stats.invalidations++;
+    _known = _dirty;
+    _testKnown.reset();
+}
+
+// The shadow's own writes bump the chip epoch too; they are already accounted for.
+void RegShadow::settle()
+{
+    serGetChipEpoch(_epoch);
+}
+
+// Reads, in one batch, each run of static registers not yet known, and the span of volatile
+// registers within [first, end) if there are any. Other volatile registers are left alone: reading
+// IRQ, FIFO or collision registers clears them. Static registers that are not pending keep the value
+// read; all receives every byte read.
+bool RegShadow::load(uint16_t first, uint16_t end, uint8_t* all, ReturnCode* ret)
+{
+    struct Span
+    {
+        uint16_t first;
+        uint16_t count;
+    };
+    Span spans[RegCount];
+    size_t spanCount = 0;
+    for (uint16_t reg = 0; reg < RegCount; ++reg)
+    {
+        if (_volatile[reg])
+            continue;
+        uint16_t last = reg;
+        while (last + 1 < RegCount && !_volatile[last + 1])
+            last++;
+        bool missing = false;
+        for (uint16_t i = reg; i <= last; ++i)
+            missing = missing || !_known[i];
+        if (missing)
+            spans[spanCount++] = {reg, static_cast<uint16_t>(last - reg + 1)};
+        reg = last;
+    }
+    uint16_t volFirst = first;
+    uint16_t volLast = static_cast<uint16_t>(end - 1);
+    while (volFirst < end && !_volatile[volFirst])
+        volFirst++;
+    while (volLast > volFirst && !_volatile[volLast])
+        volLast--;
+    if (volFirst < end)
+        spans[spanCount++] = {volFirst, static_cast<uint16_t>(volLast - volFirst + 1)};
+
+    uint8_t tx[RegCount][3];
+    serBatchItem items[RegCount] = {};
+    for (size_t i = 0; i < spanCount; ++i)
+    {
+        Writer w(tx[i]);
+        w.u16(spans[i].first);
+        w.u8(static_cast<uint8_t>(spans[i].count));
+        items[i].cmdId = RfalChipReadRegReq;
+        items[i].payload = tx[i];
+        items[i].payloadLen = static_cast<uint16_t>(w.size());
+    }
+    _stats.frames += spanCount;
+    if (!serExecBatch(items, spanCount))
+        return false;
+
+    for (size_t i = 0; i < spanCount; ++i)
+    {
+        ReturnCode r = RFAL_ERR_NONE;
+        const uint8_t* values;
+        uint16_t got;
+        if (!decodeRetBytes(items[i].rsp, items[i].rspLen, r, values, got))
+            return false;
+        if (r != RFAL_ERR_NONE)
+        {
+            if (ret)
+                *ret = r;
+            return true;
+        }
+        if (got != spans[i].count)
+            return false;
+        memcpy(all + spans[i].first, values, got);
+        for (uint16_t reg = spans[i].first; reg < spans[i].first + spans[i].count; ++reg)
+        {
+            if (_volatile[reg] || _dirty[reg])
+                continue;
+            _value[reg] = values[reg - spans[i].first];
+            _known.set(reg);
+        }
+    }
+    if (ret)
+        *ret = RFAL_ERR_NONE;
+    return true;
+}
+
+bool RegShadow::read(uint16_t reg, uint8_t* values, uint8_t len, ReturnCode* ret)
+{
+    if (ret)
+        *ret = RFAL_ERR_NONE;
+    if (!values)
+        return false;
+    sync();
+    uint16_t end = static_cast<uint16_t>(reg + len);
+    if (end > RegCount)
+    {
+        ReturnCode r = RFAL_ERR_NONE;
+        if (!flush(&r))
+            return false;
+        uint8_t* rsp = nullptr;
+        uint8_t got = 0;
+        _stats.frames++;
+        if (!serExecRfalChipReadReg(&r, reg, len, &rsp, &got))
+            return false;
+        if (ret)
+            *ret = r;
+        memcpy(values, rsp, got < len ? got : len);
+        _stats.misses += got;
+        return true;
+    }
+
+    bool anyVolatile = false;
+    bool allKnown = true;
+    for (uint16_t i = reg; i < end; ++i)
+    {
+        anyVolatile = anyVolatile || _volatile[i];
+        allKnown = allKnown && (_volatile[i] || _known[i]);
+    }
+    if (!anyVolatile && allKnown)
+    {
+        memcpy(values, _value + reg, len);
+        _stats.hits += len;
+        return true;
+    }
+
+    // The chip has to be read: pending writes go first, so it reports what the host wrote.
+    ReturnCode r = RFAL_ERR_NONE;
+    if (!flush(&r) || r != RFAL_ERR_NONE)
+    {
+        if (ret)
+            *ret = r;
+        return r != RFAL_ERR_NONE;
+    }
+    uint8_t all[RegCount];
+    if (!load(reg, end, all, &r))
+        return false;
+    if (ret)
+        *ret = r;
+    if (r != RFAL_ERR_NONE)
+        return true;
+    for (uint16_t i = reg; i < end; ++i)
+    {
+        if (_volatile[i])
+        {
+            values[i - reg] = all[i];
+            _stats.misses++;
+        }
+        else
+        {
+            values[i - reg] = _value[i];
+            _stats.hits++;
+        }
+    }
+    return true;
+}
+
+bool RegShadow::write(uint16_t reg, const uint8_t* values, uint8_t len, ReturnCode* ret)
+{
+    if (ret)
+        *ret = RFAL_ERR_NONE;
+    if (!values)
+        return false;
+    sync();
+    uint16_t end = static_cast<uint16_t>(reg + len);
+    bool anyVolatile = end > RegCount;
+    for (uint16_t i = reg; i < end && i < RegCount; ++i)
+        anyVolatile = anyVolatile || _volatile[i];
+    if (anyVolatile)
+        return writeThrough(reg, values, len, ret);
+
+    for (uint16_t i = reg; i < end; ++i)
+    {
+        uint8_t v = values[i - reg];
+        if (_known[i] && _value[i] == v)
+        {
+            // Either the chip has it already or a pending write does.
+            _stats.elided++;
+            continue;
+        }
+        if (_dirty[i])
+            _stats.merged++;
+        _value[i] = v;
+        _known.set(i);
+        _dirty.set(i);
+    }
+    return true;
+}
+
+bool RegShadow::writeThrough(uint16_t reg, const uint8_t* values, uint8_t len, ReturnCode* ret)
+{
+    ReturnCode r = RFAL_ERR_NONE;
+    if (!flush(&r) || r != RFAL_ERR_NONE)
+    {
+        if (ret)
+            *ret = r;
+        return r != RFAL_ERR_NONE;
+    }
+    _stats.frames++;
+    bool ok = serExecRfalChipWriteReg(&r, reg, const_cast<uint8_t*>(values), len);
+    settle();
+    if (!ok)
+        return false;
+    if (ret)
+        *ret = r;
+    if (r != RFAL_ERR_NONE)
+        return true;
+    _stats.written += len;
+    for (uint16_t i = reg; i < reg + len && i < RegCount; ++i)
+    {
+        if (_volatile[i])
+            continue;
+        _value[i] = values[i - reg];
+        _known.set(i);
+        _dirty.reset(i);
+    }
+    return true;
+}
+
+bool RegShadow::changeBits(uint16_t reg, uint8_t mask, uint8_t value, ReturnCode* ret)
+{
+    if (ret)
+        *ret = RFAL_ERR_NONE;
+    sync();
+    if (reg >= RegCount || _volatile[reg])
+    {
+        // Read-modify-write has to happen on the chip for registers that change on their own.
+        ReturnCode r = RFAL_ERR_NONE;
+        if (!flush(&r) || r != RFAL_ERR_NONE)
+        {
+            if (ret)
+                *ret = r;
+            return r != RFAL_ERR_NONE;
+        }
+        _stats.frames++;
+        bool ok = serExecRfalChipChangeRegBits(ret, reg, mask, value);
+        settle();
+        return ok;
+    }
+    if (!_known[reg])
+    {
+        uint8_t all[RegCount];
+        ReturnCode r = RFAL_ERR_NONE;
+        if (!load(reg, static_cast<uint16_t>(reg + 1), all, &r) || r != RFAL_ERR_NONE)
+        {
+            if (ret)
+                *ret = r;
+            return r != RFAL_ERR_NONE;
+        }
+        _stats.misses++;
+    }
+    uint8_t v = static_cast<uint8_t>((_value[reg] & ~mask) | (value & mask));
+    return write(reg, &v, 1, ret);
+}
+
+bool RegShadow::flush(ReturnCode* ret)
+{
+    if (ret)
+        *ret = RFAL_ERR_NONE;
+    if (_dirty.none())
+        return true;
+    if (_spi)
+    {
+        ReturnCode r = RFAL_ERR_NONE;
+        if (!flushRuns(true, &r))
+            return false;
+        if (!unsupported(r))
+        {
+            if (ret)
+                *ret = r;
+            return true;
+        }
+        _spi = false;
+    }
+    return flushRuns(false, ret);
+}
+
+// Sends the pending registers as runs: SysSpiTxRx register bursts or rfalChipWriteReg requests, all
+// in one batch.
+bool RegShadow::flushRuns(bool spi, ReturnCode* ret)
+{
+    struct Run
+    {
+        uint16_t first;
+        uint16_t count;
+        size_t ofs;
+        size_t len;
+    };
+    Run runs[RegCount];
+    size_t runCount = 0;
+    _tx.clear();
+    for (uint16_t reg = 0; reg < RegCount; ++reg)
+    {
+        if (!_dirty[reg])
+            continue;
+        uint16_t last = reg;
+        for (uint16_t next = static_cast<uint16_t>(reg + 1); next < RegCount && next - last <= MaxGap + 1; ++next)
+        {
+            if (!_known[next])
+                break;
+            if (_dirty[next])
+                last = next;
+        }
+        Run& run = runs[runCount++];
+        run = {reg, static_cast<uint16_t>(last - reg + 1), _tx.size(), 0};
+        uint8_t head[4];
+        Writer w(head);
+        if (spi)
+        {
+            w.u16(static_cast<uint16_t>(1 + run.count));
+            w.u8(static_cast<uint8_t>(SpiRegWrite | (reg & SpiRegMask)));
+        }
+        else
+        {
+            w.u16(reg);
+            w.u16(run.count);
+        }
+        _tx.insert(_tx.end(), head, head + w.size());
+        _tx.insert(_tx.end(), _value + reg, _value + reg + run.count);
+        run.len = _tx.size() - run.ofs;
+        reg = last;
+    }
+
+    serBatchItem items[RegCount] = {};
+    for (size_t i = 0; i < runCount; ++i)
+    {
+        items[i].cmdId = spi ? SysSpiTxRxReq : RfalChipWriteRegReq;
+        items[i].payload = _tx.data() + runs[i].ofs;
+        items[i].payloadLen = static_cast<uint16_t>(runs[i].len);
+    }
+    bool ok = serExecBatch(items, runCount);
+    settle();
+
+    for (size_t i = 0; i < runCount; ++i)
+    {
+        if (!items[i].ok)
+            break;
+        _stats.frames++;
+        // An error answer is the return code alone, also for SysSpiTxRx.
+        ReturnCode r = RFAL_ERR_NONE;
+        const uint8_t* rx;
+        uint16_t rxLen;
+        if (!decodeRet(items[i].rsp, items[i].rspLen, r))
+            return false;
+        if (r == RFAL_ERR_NONE && spi && !decodeRetBytes(items[i].rsp, items[i].rspLen, r, rx, rxLen))
+            return false;
+        if (r != RFAL_ERR_NONE)
+        {
+            if (ret)
+                *ret = r;
+            return true;
+        }
+        for (uint16_t reg = runs[i].first; reg < runs[i].first + runs[i].count; ++reg)
+            _dirty.reset(reg);
+        _stats.written += runs[i].count;
+    }
+    return ok;
+}
+
+bool RegShadow::readTest(uint16_t reg, uint8_t& value, ReturnCode* ret)
+{
+    if (ret)
+        *ret = RFAL_ERR_NONE;
+    sync();
+    if (reg < TestRegCount && _testKnown[reg])
+    {
+        value = _test[reg];
+        _stats.hits++;
+        return true;
+    }
+    ReturnCode r = RFAL_ERR_NONE;
+    if (!flush(&r) || r != RFAL_ERR_NONE)
+    {
+        if (ret)
+            *ret = r;
+        return r != RFAL_ERR_NONE;
+    }
+    _stats.frames++;
+    if (!serExecRfalChipReadTestReg(&r, reg, &value))
+        return false;
+    if (ret)
+        *ret = r;
+    _stats.misses++;
+    if (r == RFAL_ERR_NONE && reg < TestRegCount)
+    {
+        _test[reg] = value;
+        _testKnown.set(reg);
+    }
+    return true;
+}
+
+bool RegShadow::writeTest(uint16_t reg, uint8_t value, ReturnCode* ret)
+{
+    if (ret)
+        *ret = RFAL_ERR_NONE;
+    sync();
+    if (reg < TestRegCount && _testKnown[reg] && _test[reg] == value)
+    {
+        _stats.elided++;
+        return true;
+    }
+    ReturnCode r = RFAL_ERR_NONE;
+    if (!flush(&r) || r != RFAL_ERR_NONE)
+    {
+        if (ret)
+            *ret = r;
+        return r != RFAL_ERR_NONE;
+    }
+    _stats.frames++;
+    bool ok = serExecRfalChipWriteTestReg(&r, reg, value);
+    settle();
+    if (!ok)
+        return false;
+    if (ret)
+        *ret = r;
+    if (r == RFAL_ERR_NONE && reg < TestRegCount)
+    {
+        _stats.written++;
+        _test[reg] = value;
+        _testKnown.set(reg);
+    }
+    return true;
+}
+
+bool RegShadow::changeTestBits(uint16_t reg, uint8_t mask, uint8_t value, ReturnCode* ret)
+{
+    uint8_t current = 0;
+    ReturnCode r = RFAL_ERR_NONE;
+    if (!readTest(reg, current, &r) || r != RFAL_ERR_NONE)
+    {
+        if (ret)
+            *ret = r;
+        return r != RFAL_ERR_NONE;
+    }
+    return writeTest(reg, static_cast<uint8_t>((current & ~mask) | (value & mask)), ret);
+}
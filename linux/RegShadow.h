@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <bitset>
+#include <vector>
+
+#include "SerRfalHost.h"
+
+// Host-side copy of the ST25R200 registers for diagnostics and tuning code that would otherwise
+// spend a serial round trip on every rfalChip register call. Registers are Static (configuration:
+// changes only when written) or Volatile (IRQ, FIFO, collision, display and wake-up measurement
+// results: change on their own or clear on read).
+//
+// - Static reads are served from the shadow. The first miss loads every static register in one
+//   batch of rfalChipReadReg runs, so a tuning session costs one round trip, not one per register.
+// - Volatile reads always go to the chip, after any pending writes, and only for the registers
+//   asked for: reading IRQ, FIFO or collision registers clears them.
+// - write() and changeBits() on Static registers only update the shadow; writes of an unchanged
+//   value are dropped and bit changes merge into the pending value. flush() sends what changed as
+//   SysSpiTxRx register writes, one SPI burst per run of changed registers (short gaps of known
+//   registers are rewritten to keep a run together), all runs in one serExecBatch. Firmware without
+//   SysSpiTxRx gets rfalChipWriteReg runs instead.
+// - Volatile writes and bit changes go out at once, after the pending ones, so their order holds.
+// - Test registers are cached per address and written through, skipping unchanged values.
+//
+// Any other command that may touch the chip (serGetChipEpoch) drops the shadow's values, so RF
+// commands between accesses never leave it stale; pending writes are kept. Not thread-safe, like
+// SerRfalHost.
+class RegShadow
+{
+public:
+    static constexpr uint16_t RegCount = 0x40; // ST25R200 register space
+    static constexpr uint16_t TestRegCount = 0x100;
+
+    enum class Kind : uint8_t
+    {
+        Static,
+        Volatile,
+    };
+
+    struct Stats
+    {
+        uint64_t hits;          // register bytes served from the shadow
+        uint64_t misses;        // register bytes read from the chip
+        uint64_t elided;        // writes of the value a register already had
+        uint64_t merged;        // writes and bit changes folded into a pending write
+        uint64_t written;       // register bytes written by flush() or write-through
+        uint64_t frames;        // serial requests issued
+        uint64_t invalidations; // shadow dropped after other chip commands
+    };
+
+    RegShadow();
+
+    void setKind(uint16_t reg, Kind kind);
+    Kind kind(uint16_t reg) const { return reg < RegCount && !_volatile[reg] ? Kind::Static : Kind::Volatile; }
+
+    // Same contracts as the serExecRfalChip* calls; ret is the chip's return code of the request
+    // that answered, RFAL_ERR_NONE when the shadow did. Registers past RegCount pass through.
+    bool read(uint16_t reg, uint8_t* values, uint8_t len, ReturnCode* ret = nullptr);
+    bool write(uint16_t reg, const uint8_t* values, uint8_t len, ReturnCode* ret = nullptr);
+    bool changeBits(uint16_t reg, uint8_t mask, uint8_t value, ReturnCode* ret = nullptr);
+    bool flush(ReturnCode* ret = nullptr);
+
+    bool readTest(uint16_t reg, uint8_t& value, ReturnCode* ret = nullptr);
+    bool writeTest(uint16_t reg, uint8_t value, ReturnCode* ret = nullptr);
+    bool changeTestBits(uint16_t reg, uint8_t mask, uint8_t value, ReturnCode* ret = nullptr);
+
+    // Forgets every value (pending writes included), e.g. after a chip reset outside SerRfalHost.
+    void invalidate();
+    size_t pending() const { return _dirty.count(); }
+    bool spiWrites() const { return _spi; }
+    const Stats& stats() const { return _stats; }
+
+private:
+    void sync();
+    void settle();
+    bool load(uint16_t first, uint16_t end, uint8_t* all, ReturnCode* ret);
+    bool flushRuns(bool spi, ReturnCode* ret);
+    bool writeThrough(uint16_t reg, const uint8_t* values, uint8_t len, ReturnCode* ret);
+
+    uint8_t _value[RegCount] = {};
+    std::bitset<RegCount> _volatile;
+    std::bitset<RegCount> _known;
+    std::bitset<RegCount> _dirty;
+    uint8_t _test[TestRegCount] = {};
+    std::bitset<TestRegCount> _testKnown;
+    uint32_t _epoch = 0;
+    bool _spi = true; // SysSpiTxRx works; cleared when the firmware does not implement it
+    std::vector<uint8_t> _tx; // flush payloads
+    Stats _stats = {};
+};
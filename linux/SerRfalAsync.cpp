@@ -0,0 +1,718 @@
+// Asynchronous serRfal host API; see SerRfalAsync.h.
+//
+// Each port keeps a window of requests on the wire, bounded by its rx credit: queued frames are
+// appended to one write buffer while the bytes of unanswered requests fit the credit, and each
+// response frees the credit of the oldest. Writes are non-blocking and wait for EPOLLOUT only when
+// the tty buffer is full; each EPOLLIN drains the tty and parses every complete frame. Deadlines
+// are reactor timers, one per request.
+
+#include "SerRfalAsync.h"
+
+using namespace SerRfalWire;
+
+namespace SerRfalAsync
+{
+    namespace
+    {
+        bool decodeNone(const uint8_t*, size_t, None&)
+        {
+            return true;
+        }
+
+        bool decodeReturnCode(const uint8_t* p, size_t len, ReturnCode& ret)
+        {
+            return decodeRet(p, len, ret);
+        }
+
+        bool decodeU8(const uint8_t* p, size_t len, RetU8& out)
+        {
+            return decodeRetU8(p, len, out.ret, out.value);
+        }
+
+        bool decodeBytes(const uint8_t* p, size_t len, RetBytes& out)
+        {
+            const uint8_t* data;
+            uint16_t dataLen;
+            if (!decodeRetBytes(p, len, out.ret, data, dataLen))
+                return false;
+            out.data.assign(data, data + dataLen);
+            return true;
+        }
+
+        bool decodeRegs(const uint8_t* p, size_t len, RetBytes& out)
+        {
+            return decodeBytes(p, len, out) && out.data.size() <= 0xFF;
+        }
+
+        bool decodeVersionText(const uint8_t* p, size_t len, Version& out)
+        {
+            VersionInfo v;
+            if (!decodeVersion(p, len, v))
+                return false;
+            out.text.assign(reinterpret_cast<const char*>(v.text), v.textLen);
+            out.rfalVersion = v.rfalVersion;
+            out.fwVersion = v.fwVersion;
+            out.serHash = v.serHash;
+            return true;
+        }
+
+        bool decodeHashes(const uint8_t* p, size_t len, ConfigHashes& out)
+        {
+            return decodeConfigHashes(p, len, out);
+        }
+
+        bool decodeState(const uint8_t* p, size_t len, rfalNfcState& state)
+        {
+            Cursor c(p, len);
+            state = static_cast<rfalNfcState>(c.u32());
+            return c.ok();
+        }
+
+        bool decodeDeviceList(const uint8_t* p, size_t len, Devices& out)
+        {
+            size_t count = 0;
+            if (!decodeDevices(p, len, out.ret, nullptr, 0, count))
+                return false;
+            out.list.resize(count);
+            return decodeDevices(p, len, out.ret, out.list.data(), count, count);
+        }
+    }
+
+    const char* statusName(Status status)
+    {
+        switch (status)
+        {
+            case Status::Ok: return "ok";
+            case Status::Timeout: return "timeout";
+            case Status::Cancelled: return "cancelled";
+            case Status::PortError: return "port error";
+            case Status::Closed: return "closed";
+            case Status::Malformed: return "malformed";
+            case Status::Invalid: return "invalid";
+        }
+        return "?";
+    }
+
+    Port::Port(Reactor& reactor) : _reactor(reactor)
+    {
+    }
+
+    Port::~Port()
+    {
+        close();
+    }
+
+    bool Port::open(const char* path, int32_t& error, const serComParameters* params)
+    {
+        close();
+        static const serComParameters kDefault = {115200, 8, 1, 0};
+        int fd = openPort(path, params ? *params : kDefault, &_saved, error);
+        if (fd < 0)
+            return false;
+        if (!_reactor.add(fd, EPOLLIN, this))
+        {
+            error = errno;
+            ::close(fd);
+            return false;
+        }
+        _fd = fd;
+        _path = path;
+        _watchingOut = false;
+        return true;
+    }
+
+    void Port::close()
+    {
+        teardown(Status::Closed);
+    }
+
+    void Port::teardown(Status status)
+    {
+        if (_fd < 0)
+            return;
+        _reactor.remove(_fd, this);
+        tcsetattr(_fd, TCSANOW, &_saved);
+        ::close(_fd);
+        _fd = -1;
+        _epoch++;
+        _rxLen = 0;
+        if (_failTimer)
+        {
+            _reactor.cancel(_failTimer);
+            _failTimer = 0;
+        }
+
+        while (!_inFlight.empty())
+        {
+            Request& r = _inFlight.front();
+            _reactor.cancel(r.timer);
+            completeLater(std::move(r.done), status);
+            _inFlight.pop_front();
+        }
+        _inFlightBytes = 0;
+        _tx.clear();
+        _txOfs = 0;
+        while (!_queue.empty())
+        {
+            Request& r = _queue.front();
+            _reactor.cancel(r.timer);
+            completeLater(std::move(r.done), status);
+            _queue.pop_front();
+        }
+    }
+
+    void Port::completeLater(Completion done, Status status)
+    {
+        if (!done)
+            return;
+        if (status == Status::Timeout || status == Status::PortError)
+            _stats.failures++;
+        // Captures only the completion, so it may outlive the port.
+        _reactor.after(0, [done = std::move(done), status] { done(status, nullptr, 0); });
+    }
+
+    // Failures found while submitting are reported from the loop, not from inside submit().
+    void Port::failLater(int error)
+    {
+        if (_failTimer)
+            return;
+        _failError = error;
+        _failTimer = _reactor.after(0, [this] {
+            _failTimer = 0;
+            fail(_failError);
+        });
+    }
+
+    void Port::fail(int error)
+    {
+        teardown(Status::PortError);
+        if (onClosed)
+            onClosed(error);
+    }
+
+    RequestId Port::submit(uint16_t cmdId, std::vector<uint8_t> frame, uint32_t timeoutMs, Completion done)
+    {
+        RequestId id = _nextId++;
+        if (_fd < 0 || frame.empty())
+        {
+            completeLater(std::move(done), _fd < 0 ? Status::Closed : Status::Invalid);
+            return id;
+        }
+
+        Request r;
+        r.id = id;
+        r.cmdId = cmdId;
+        r.frame = std::move(frame);
+        r.done = std::move(done);
+        r.timer = _reactor.after(timeoutMs, [this, id] { expire(id); });
+        _queue.push_back(std::move(r));
+        pump();
+        return id;
+    }
+
+    bool Port::cancel(RequestId id)
+    {
+        for (Request& r : _inFlight)
+        {
+            if (r.id == id)
+            {
+                if (!r.done)
+                    return false;
+                completeLater(std::move(r.done), Status::Cancelled);
+                r.done = nullptr;
+                return true;
+            }
+        }
+        for (auto it = _queue.begin(); it != _queue.end(); ++it)
+        {
+            if (it->id == id)
+            {
+                _reactor.cancel(it->timer);
+                completeLater(std::move(it->done), Status::Cancelled);
+                _queue.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Port::cancelAll()
+    {
+        for (Request& r : _inFlight)
+        {
+            if (r.done)
+            {
+                completeLater(std::move(r.done), Status::Cancelled);
+                r.done = nullptr;
+            }
+        }
+        while (!_queue.empty())
+        {
+            _reactor.cancel(_queue.front().timer);
+            completeLater(std::move(_queue.front().done), Status::Cancelled);
+            _queue.pop_front();
+        }
+    }
+
+    size_t Port::pending() const
+    {
+        size_t n = _queue.size();
+        for (const Request& r : _inFlight)
+            n += r.done ? 1 : 0;
+        return n;
+    }
+
+    void Port::stats(serLinkStats& out, bool reset)
+    {
+        out = _stats;
+        if (reset)
+            _stats = {};
+    }
+
+    // Moves queued requests onto the wire while the credit allows; the oldest always goes.
+    void Port::pump()
+    {
+        if (_fd < 0 || _corked)
+            return;
+        bool added = false;
+        uint64_t now = Reactor::nowUs();
+        while (!_queue.empty())
+        {
+            if (!_inFlight.empty() && _inFlightBytes + _queue.front().frame.size() > _credit)
+                break;
+            Request r = std::move(_queue.front());
+            _queue.pop_front();
+            if (_txOfs == _tx.size())
+            {
+                _tx.clear();
+                _txOfs = 0;
+            }
+            _tx.insert(_tx.end(), r.frame.begin(), r.frame.end());
+            r.frameLen = r.frame.size();
+            r.frame = std::vector<uint8_t>();
+            r.txEnd = _txWritten + (_tx.size() - _txOfs);
+            r.sentUs = now;
+            _inFlightBytes += r.frameLen;
+            _inFlight.push_back(std::move(r));
+            added = true;
+        }
+        if (!added)
+            return;
+        int error = writeSome();
+        if (error)
+            failLater(error);
+    }
+
+    int Port::writeSome()
+    {
+        while (_txOfs < _tx.size())
+        {
+            ssize_t n = write(_fd, _tx.data() + _txOfs, _tx.size() - _txOfs);
+            if (n > 0)
+            {
+                _txOfs += static_cast<size_t>(n);
+                _txWritten += static_cast<uint64_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && errno == EAGAIN)
+            {
+                watchOut(true);
+                return 0;
+            }
+            return n < 0 ? errno : EIO;
+        }
+        watchOut(false);
+        return 0;
+    }
+
+    void Port::watchOut(bool on)
+    {
+        if (on == _watchingOut)
+            return;
+        _watchingOut = on;
+        _reactor.modify(_fd, on ? EPOLLIN | EPOLLOUT : EPOLLIN, this);
+    }
+
+    void Port::onEvents(uint32_t events)
+    {
+        if (events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+        {
+            unsigned epoch = _epoch;
+            readSome();
+            if (_epoch != epoch || _fd < 0)
+                return;
+            if (events & (EPOLLERR | EPOLLHUP))
+            {
+                fail(EIO);
+                return;
+            }
+        }
+        if ((events & EPOLLOUT) && _txOfs < _tx.size())
+        {
+            int error = writeSome();
+            if (error)
+                fail(error);
+        }
+    }
+
+    void Port::readSome()
+    {
+        unsigned epoch = _epoch;
+        for (;;)
+        {
+            ssize_t n = read(_fd, _rx + _rxLen, sizeof(_rx) - _rxLen);
+            if (n < 0 && errno == EINTR)
+                continue;
+            // With VMIN=0/VTIME=0 an empty tty reads 0 rather than EAGAIN; a hang-up shows up as
+            // EPOLLHUP or EIO.
+            if (n == 0 || (n < 0 && errno == EAGAIN))
+                return;
+            if (n < 0)
+            {
+                fail(errno);
+                return;
+            }
+            _rxLen += static_cast<size_t>(n);
+            if (!parseRx() || _epoch != epoch)
+                return;
+        }
+    }
+
+    // Hands every complete frame in _rx to onFrame; false once a callback closed the port.
+    bool Port::parseRx()
+    {
+        unsigned epoch = _epoch;
+        size_t ofs = 0;
+        size_t consumed = 0;
+        uint32_t skipped = 0;
+        Frame f;
+        while (parseFrame(_rx + ofs, _rxLen - ofs, f, consumed, skipped))
+        {
+            ofs += consumed;
+            onFrame(f);
+            if (_epoch != epoch)
+                return false; // closed (and maybe re-opened) by a callback
+        }
+        ofs += consumed;
+        _stats.skipped += skipped;
+        _rxLen -= ofs;
+        memmove(_rx, _rx + ofs, _rxLen);
+        return true;
+    }
+
+    // A header still short of its frame when the oldest request timed out goes (see parseFrame),
+    // and the frames it held up are parsed. False once a callback closed the port.
+    bool Port::dropStalledHeader()
+    {
+        if (_rxLen == 0)
+            return true;
+        _stats.skipped++;
+        _rxLen--;
+        memmove(_rx, _rx + 1, _rxLen);
+        return parseRx();
+    }
+
+    void Port::onFrame(const Frame& f)
+    {
+        // Responses come in request order, so only the oldest request on the wire can match. An
+        // expired request whose response is not this one is not getting one: a later request's
+        // response has come.
+        while (!_inFlight.empty() && _inFlight.front().expired && _txWritten >= _inFlight.front().txEnd &&
+               f.cmdId != static_cast<uint16_t>(_inFlight.front().cmdId + 1))
+        {
+            unsigned epoch = _epoch;
+            finish(Status::Timeout, nullptr, 0);
+            if (_epoch != epoch)
+                return;
+        }
+        if (!_inFlight.empty())
+        {
+            const Request& r = _inFlight.front();
+            if (_txWritten >= r.txEnd && f.cmdId == static_cast<uint16_t>(r.cmdId + 1))
+            {
+                uint32_t rtt = static_cast<uint32_t>(Reactor::nowUs() - r.sentUs);
+                _stats.exchanges++;
+                _stats.rttSumUs += rtt;
+                if (_stats.rttMinUs == 0 || rtt < _stats.rttMinUs)
+                    _stats.rttMinUs = rtt;
+                if (rtt > _stats.rttMaxUs)
+                    _stats.rttMaxUs = rtt;
+                finish(Status::Ok, f.payload, f.payloadLen);
+                return;
+            }
+        }
+        // A late response to a request that timed out.
+        _stats.skipped++;
+    }
+
+    // Completes the oldest request on the wire and lets the next ones out.
+    void Port::finish(Status status, const uint8_t* payload, size_t payloadLen)
+    {
+        Request r = std::move(_inFlight.front());
+        _inFlight.pop_front();
+        _inFlightBytes -= r.frameLen;
+        _reactor.cancel(r.timer);
+        if (status != Status::Ok && !r.expired)
+            _stats.failures++;
+        armOrphan();
+        pump();
+        if (r.done)
+            r.done(status, payload, payloadLen);
+    }
+
+    // A request that expired behind an older one and is now the oldest gets one more timeout to
+    // take its late response off the wire.
+    void Port::armOrphan()
+    {
+        if (_inFlight.empty() || !_inFlight.front().expired || _inFlight.front().timer)
+            return;
+        RequestId id = _inFlight.front().id;
+        _inFlight.front().timer = _reactor.after(_timeoutMs, [this, id] { expire(id); });
+    }
+
+    void Port::expire(RequestId id)
+    {
+        for (size_t i = 0; i < _inFlight.size(); ++i)
+        {
+            Request& r = _inFlight[i];
+            if (r.id != id)
+                continue;
+            r.timer = 0;
+            if (i == 0 && (r.expired || _rxLen > 0))
+            {
+                // Given up: an orphan's second deadline, or a header still short of its frame, which
+                // was this response or noise. The frames it held up belong to the requests behind.
+                unsigned epoch = _epoch;
+                finish(Status::Timeout, nullptr, 0);
+                if (_epoch == epoch)
+                    dropStalledHeader();
+                return;
+            }
+            // Its caller hears now, but the request keeps its place on the wire as an orphan, so that
+            // a late response is not taken for the next request's. As the oldest it waits one more
+            // timeout (armOrphan); a response to a later request ends it sooner (onFrame).
+            r.expired = true;
+            _stats.failures++;
+            Completion done = std::move(r.done);
+            r.done = nullptr;
+            if (i == 0)
+                armOrphan();
+            if (done)
+                done(Status::Timeout, nullptr, 0);
+            return;
+        }
+        for (auto it = _queue.begin(); it != _queue.end(); ++it)
+        {
+            if (it->id == id)
+            {
+                Completion done = std::move(it->done);
+                _queue.erase(it);
+                _stats.failures++;
+                done(Status::Timeout, nullptr, 0);
+                return;
+            }
+        }
+    }
+
+    Op<None> Port::sysPing()
+    {
+        return Op<None>(*this, SysPingReq, nullptr, 0, decodeNone);
+    }
+
+    Op<Version> Port::sysGetVersion()
+    {
+        return Op<Version>(*this, SysGetVersionReq, nullptr, 0, decodeVersionText);
+    }
+
+    Op<ConfigHashes> Port::sysGetConfigHashes(uint8_t configId)
+    {
+        return Op<ConfigHashes>(*this, SysGetConfigHashesReq, &configId, 1, decodeHashes);
+    }
+
+    Op<ReturnCode> Port::sysNfcReset()
+    {
+        return Op<ReturnCode>(*this, SysNfcResetReq, nullptr, 0, decodeReturnCode);
+    }
+
+    Op<RetBytes> Port::sysSpiTxRx(const uint8_t* tx, uint16_t txLen)
+    {
+        // u16 length, bytes clocked out in one chip select; the response has the bytes clocked in
+        std::vector<uint8_t> payload(2 + static_cast<size_t>(txLen));
+        Writer w(payload.data());
+        w.u16(txLen);
+        if (txLen)
+            w.bytes(tx, txLen);
+        return Op<RetBytes>(*this, SysSpiTxRxReq, payload.data(), w.size(), decodeBytes);
+    }
+
+    Op<ReturnCode> Port::rfalInitialize()
+    {
+        return Op<ReturnCode>(*this, RfalInitializeReq, nullptr, 0, decodeReturnCode);
+    }
+
+    Op<ReturnCode> Port::rfalFieldOff()
+    {
+        return Op<ReturnCode>(*this, RfalFieldOffReq, nullptr, 0, decodeReturnCode);
+    }
+
+    Op<ReturnCode> Port::rfalWakeUpModeStop()
+    {
+        return Op<ReturnCode>(*this, RfalWakeUpModeStopReq, nullptr, 0, decodeReturnCode);
+    }
+
+    Op<ReturnCode> Port::rfalNfcInitialize()
+    {
+        return Op<ReturnCode>(*this, RfalNfcInitializeReq, nullptr, 0, decodeReturnCode);
+    }
+
+    Op<ReturnCode> Port::rfalNfcDiscover(const serRfalNfcDiscoverParam& params)
+    {
+        uint8_t payload[DiscoverParamsLen];
+        size_t len = writeDiscoverParams(payload, params);
+        return Op<ReturnCode>(*this, RfalNfcDiscoverReq, payload, len, decodeReturnCode);
+    }
+
+    Op<rfalNfcState> Port::rfalNfcGetState()
+    {
+        return Op<rfalNfcState>(*this, RfalNfcGetStateReq, nullptr, 0, decodeState);
+    }
+
+    Op<Devices> Port::rfalNfcGetDevicesFound()
+    {
+        return Op<Devices>(*this, RfalNfcGetDevicesReq, nullptr, 0, decodeDeviceList);
+    }
+
+    Op<ReturnCode> Port::rfalNfcDeactivate(rfalNfcDeactivateType type)
+    {
+        uint8_t payload[4];
+        Writer w(payload);
+        w.u32(static_cast<uint32_t>(type));
+        return Op<ReturnCode>(*this, RfalNfcDeactivateReq, payload, w.size(), decodeReturnCode);
+    }
+
+    Op<ReturnCode> Port::rfalAnalogConfigListWriteRaw(const uint8_t* configTbl, uint16_t configTblSize)
+    {
+        // u16 length, table; an oversize table leaves the frame empty and completes with Invalid.
+        std::vector<uint8_t> payload(2 + static_cast<size_t>(configTblSize));
+        Writer w(payload.data());
+        w.u16(configTblSize);
+        if (configTblSize)
+            w.bytes(configTbl, configTblSize);
+        return Op<ReturnCode>(*this, RfalAnalogConfigListWriteRawReq, payload.data(), w.size(), decodeReturnCode);
+    }
+
+    Op<RetBytes> Port::rfalAnalogConfigListReadRaw()
+    {
+        return Op<RetBytes>(*this, RfalAnalogConfigListReadRawReq, nullptr, 0, decodeBytes);
+    }
+
+    Op<ReturnCode> Port::rfalDpoTableWrite(const rfalDpoEntry* powerTbl, uint8_t powerTblEntries)
+    {
+        // count u8, count x {rfoRes, inc, dec}
+        std::vector<uint8_t> payload(1 + 3 * static_cast<size_t>(powerTblEntries));
+        Writer w(payload.data());
+        w.u8(powerTblEntries);
+        for (uint8_t i = 0; i < powerTblEntries; ++i)
+        {
+            w.u8(powerTbl[i].rfoRes);
+            w.u8(powerTbl[i].inc);
+            w.u8(powerTbl[i].dec);
+        }
+        return Op<ReturnCode>(*this, RfalDpoTableWriteReq, payload.data(), w.size(), decodeReturnCode);
+    }
+
+    Op<ReturnCode> Port::rfalDpoSetEnable(bool enable)
+    {
+        uint8_t payload = enable ? 1 : 0;
+        return Op<ReturnCode>(*this, RfalDpoSetEnableReq, &payload, 1, decodeReturnCode);
+    }
+
+    Op<ReturnCode> Port::rfalChipWriteReg(uint16_t reg, const uint8_t* values, uint8_t len)
+    {
+        // reg u16, u16 length, values
+        std::vector<uint8_t> payload(4 + static_cast<size_t>(len));
+        Writer w(payload.data());
+        w.u16(reg);
+        w.u16(len);
+        if (len)
+            w.bytes(values, len);
+        return Op<ReturnCode>(*this, RfalChipWriteRegReq, payload.data(), w.size(), decodeReturnCode);
+    }
+
+    Op<RetBytes> Port::rfalChipReadReg(uint16_t reg, uint8_t len)
+    {
+        uint8_t payload[3];
+        Writer w(payload);
+        w.u16(reg);
+        w.u8(len);
+        return Op<RetBytes>(*this, RfalChipReadRegReq, payload, w.size(), decodeRegs);
+    }
+
+    Op<ReturnCode> Port::rfalChipChangeRegBits(uint16_t reg, uint8_t valueMask, uint8_t value)
+    {
+        // reg u16, mask u8, value u8
+        uint8_t payload[4];
+        Writer w(payload);
+        w.u16(reg);
+        w.u8(valueMask);
+        w.u8(value);
+        return Op<ReturnCode>(*this, RfalChipChangeRegBitsReq, payload, w.size(), decodeReturnCode);
+    }
+
+    Op<ReturnCode> Port::rfalChipWriteTestReg(uint16_t reg, uint8_t value)
+    {
+        uint8_t payload[3];
+        Writer w(payload);
+        w.u16(reg);
+        w.u8(value);
+        return Op<ReturnCode>(*this, RfalChipWriteTestRegReq, payload, w.size(), decodeReturnCode);
+    }
+
+    Op<RetU8> Port::rfalChipReadTestReg(uint16_t reg)
+    {
+        uint8_t payload[2];
+        Writer w(payload);
+        w.u16(reg);
+        return Op<RetU8>(*this, RfalChipReadTestRegReq, payload, w.size(), decodeU8);
+    }
+
+    Op<ReturnCode> Port::rfalChipChangeTestRegBits(uint16_t reg, uint8_t valueMask, uint8_t value)
+    {
+        uint8_t payload[4];
+        Writer w(payload);
+        w.u16(reg);
+        w.u8(valueMask);
+        w.u8(value);
+        return Op<ReturnCode>(*this, RfalChipChangeTestRegBitsReq, payload, w.size(), decodeReturnCode);
+    }
+
+    Op<ReturnCode> Port::rfalChipExecCmd(uint16_t cmd)
+    {
+        uint8_t payload[2];
+        Writer w(payload);
+        w.u16(cmd);
+        return Op<ReturnCode>(*this, RfalChipExecCmdReq, payload, w.size(), decodeReturnCode);
+    }
+
+    Op<ReturnCode> Port::rfalChipSetRFO(uint8_t rfo)
+    {
+        return Op<ReturnCode>(*this, RfalChipSetRFOReq, &rfo, 1, decodeReturnCode);
+    }
+
+    Op<RetU8> Port::rfalChipGetRFO()
+    {
+        return Op<RetU8>(*this, RfalChipGetRFOReq, nullptr, 0, decodeU8);
+    }
+
+    Op<RetU8> Port::rfalChipMeasureAmplitude()
+    {
+        return Op<RetU8>(*this, RfalChipMeasureAmplitudeReq, nullptr, 0, decodeU8);
+    }
+
+    Op<RetU8> Port::rfalChipMeasurePhase()
+    {
+        return Op<RetU8>(*this, RfalChipMeasurePhaseReq, nullptr, 0, decodeU8);
+    }
+}
@@ -0,0 +1,374 @@
+#pragma once
+
+// Asynchronous serRfal host API: the serExec* commands of SerRfalHost as requests on a Reactor, so
+// one thread keeps many readers busy. Every command returns an Op with a callback form and, when
+// compiled as C++20, a coroutine form:
+//
+//   port.rfalNfcGetState().timeout(200).then([](Result<rfalNfcState> r) { ... });
+//   Result<rfalNfcState> r = co_await port.rfalNfcGetState();
+//
+// Requests to one port are queued and written back to back while their frames fit the device's
+// receive buffer (the port's rx credit); the firmware answers in order, so responses are matched
+// to the oldest request on the wire. Different ports run concurrently. Callbacks run on the
+// reactor thread, never inside the call that submits, cancels or closes.
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include <exception>
+#endif
+
+#include "Reactor.h"
+#include "SerRfalWire.h"
+
+namespace SerRfalAsync
+{
+    enum class Status
+    {
+        Ok,
+        Timeout,   // no response before the request's deadline
+        Cancelled, // cancel() / cancelAll()
+        PortError, // read/write error or hang-up; the port is closed
+        Closed,    // the port was closed, or was not open at submit
+        Malformed, // the response payload does not decode
+        Invalid,   // the request does not fit one frame
+    };
+
+    const char* statusName(Status status);
+
+    template <typename T>
+    struct Result
+    {
+        Status status = Status::Ok;
+        T value{};
+
+        bool ok() const { return status == Status::Ok; }
+    };
+
+    using RequestId = uint64_t;
+
+    struct None
+    {
+    };
+
+    // ret u16, result u8 (rfalChipGetRFO, rfalChipMeasureAmplitude/Phase)
+    struct RetU8
+    {
+        ReturnCode ret;
+        uint8_t value;
+    };
+
+    // ret u16, bytes (rfalChipReadReg, rfalAnalogConfigListReadRaw)
+    struct RetBytes
+    {
+        ReturnCode ret;
+        std::vector<uint8_t> data;
+    };
+
+    struct Version
+    {
+        std::string text;
+        uint32_t rfalVersion;
+        uint32_t fwVersion;
+        uint32_t serHash;
+    };
+
+    using ConfigHashes = SerRfalWire::ConfigHashes;
+
+    struct Devices
+    {
+        ReturnCode ret;
+        std::vector<serFlatRfalNfcDevice> list;
+    };
+
+    class Port;
+
+    // One command, built but not yet sent. then() or co_await submits it; the deadline (timeout(),
+    // default Port::timeoutMs()) counts from submission, so it covers the time queued behind other
+    // requests to the same port.
+    template <typename T>
+    class Op
+    {
+    public:
+        using Decoder = bool (*)(const uint8_t* payload, size_t payloadLen, T& out);
+
+        Op(Port& port, uint16_t cmdId, const uint8_t* payload, size_t payloadLen, Decoder decode);
+
+        // The rvalue forms return the Op by value: `co_await port.x().timeout(50)` must await an
+        // object that lives in the coroutine frame, not a reference to a temporary.
+        Op& timeout(uint32_t ms) &
+        {
+            _timeoutMs = ms;
+            return *this;
+        }
+
+        Op timeout(uint32_t ms) &&
+        {
+            _timeoutMs = ms;
+            return std::move(*this);
+        }
+
+        // Stores the request ID at submission, for Port::cancel() of a co_await.
+        Op& track(RequestId& id) &
+        {
+            _track = &id;
+            return *this;
+        }
+
+        Op track(RequestId& id) &&
+        {
+            _track = &id;
+            return std::move(*this);
+        }
+
+        RequestId then(std::function<void(Result<T>)> done);
+
+#if defined(__cpp_impl_coroutine)
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            then([this, h](Result<T> r) {
+                _result = std::move(r);
+                h.resume();
+            });
+        }
+
+        Result<T> await_resume() { return std::move(_result); }
+#endif
+
+    private:
+        Port& _port;
+        uint16_t _cmdId;
+        std::vector<uint8_t> _frame; // empty when the payload does not fit
+        Decoder _decode;
+        uint32_t _timeoutMs = 0;
+        RequestId* _track = nullptr;
+        Result<T> _result;
+    };
+
+    // A serial port driven by a Reactor. Not thread-safe: use it from the reactor thread only.
+    class Port : public Reactor::Handler
+    {
+    public:
+        using Completion = std::function<void(Status status, const uint8_t* payload, size_t payloadLen)>;
+
+        explicit Port(Reactor& reactor);
+        ~Port() override;
+        Port(const Port&) = delete;
+        Port& operator=(const Port&) = delete;
+
+        // Same port setup as serComOpen (non-blocking, exclusive, low latency); params defaults to
+        // 115200 8N1. Returns false with error set to errno.
+        bool open(const char* path, int32_t& error, const serComParameters* params = nullptr);
+        // Completes every pending request with Closed and restores the terminal settings.
+        void close();
+        bool isOpen() const { return _fd >= 0; }
+        const std::string& path() const { return _path; }
+
+        // Called after a read/write error or hang-up closed the port (pending requests complete with
+        // PortError). It is the last thing the port does in that dispatch, so it may destroy the
+        // Port; request callbacks must not.
+        std::function<void(int error)> onClosed;
+
+        void setTimeout(uint32_t ms) { _timeoutMs = ms; }
+        uint32_t timeoutMs() const { return _timeoutMs; }
+
+        // Request bytes allowed on the wire before the oldest is answered (default
+        // SerRfalWire::DefaultRxCredit). A request larger than the credit is sent alone; 0 sends
+        // one request at a time.
+        void setRxCredit(size_t bytes) { _credit = bytes; }
+        size_t rxCredit() const { return _credit; }
+
+        // Holds writes while it lives, so the requests submitted meanwhile leave in one write()
+        // (as many as the credit allows; the rest follow as responses free it).
+        class Batch
+        {
+        public:
+            explicit Batch(Port& port) : _port(port) { _port._corked++; }
+            ~Batch()
+            {
+                if (--_port._corked == 0)
+                    _port.pump();
+            }
+            Batch(const Batch&) = delete;
+            Batch& operator=(const Batch&) = delete;
+
+        private:
+            Port& _port;
+        };
+
+        // Queues one encoded frame (see SerRfalWire::encodeFrame) and completes with the payload of
+        // the response cmdId + 1. The payload pointer is valid during the call only.
+        RequestId submit(uint16_t cmdId, std::vector<uint8_t> frame, uint32_t timeoutMs, Completion done);
+
+        // A queued request is dropped. One already sent completes with Cancelled now, but keeps its
+        // place on the wire until its response comes, so the late response cannot be taken for a
+        // later request's. A request that times out on the wire stays the same way. Either leaves
+        // once a later request's response shows its own is not coming, or one timeout after its
+        // deadline as the oldest.
+        bool cancel(RequestId id);
+        void cancelAll();
+        size_t pending() const;
+        size_t inFlight() const { return _inFlight.size(); }
+
+        void stats(serLinkStats& out, bool reset = false);
+
+        Op<None> sysPing();
+        Op<Version> sysGetVersion();
+        Op<ConfigHashes> sysGetConfigHashes(uint8_t configId);
+        Op<ReturnCode> sysNfcReset();
+        Op<RetBytes> sysSpiTxRx(const uint8_t* tx, uint16_t txLen);
+
+        Op<ReturnCode> rfalInitialize();
+        Op<ReturnCode> rfalFieldOff();
+        Op<ReturnCode> rfalWakeUpModeStop();
+
+        Op<ReturnCode> rfalNfcInitialize();
+        Op<ReturnCode> rfalNfcDiscover(const serRfalNfcDiscoverParam& params);
+        Op<rfalNfcState> rfalNfcGetState();
+        Op<Devices> rfalNfcGetDevicesFound();
+        Op<ReturnCode> rfalNfcDeactivate(rfalNfcDeactivateType type);
+
+        Op<ReturnCode> rfalAnalogConfigListWriteRaw(const uint8_t* configTbl, uint16_t configTblSize);
+        Op<RetBytes> rfalAnalogConfigListReadRaw();
+        Op<ReturnCode> rfalDpoTableWrite(const rfalDpoEntry* powerTbl, uint8_t powerTblEntries);
+        Op<ReturnCode> rfalDpoSetEnable(bool enable);
+
+        Op<ReturnCode> rfalChipWriteReg(uint16_t reg, const uint8_t* values, uint8_t len);
+        Op<RetBytes> rfalChipReadReg(uint16_t reg, uint8_t len);
+        Op<ReturnCode> rfalChipChangeRegBits(uint16_t reg, uint8_t valueMask, uint8_t value);
+        Op<ReturnCode> rfalChipWriteTestReg(uint16_t reg, uint8_t value);
+        Op<RetU8> rfalChipReadTestReg(uint16_t reg);
+        Op<ReturnCode> rfalChipChangeTestRegBits(uint16_t reg, uint8_t valueMask, uint8_t value);
+        Op<ReturnCode> rfalChipExecCmd(uint16_t cmd);
+        Op<ReturnCode> rfalChipSetRFO(uint8_t rfo);
+        Op<RetU8> rfalChipGetRFO();
+        Op<RetU8> rfalChipMeasureAmplitude();
+        Op<RetU8> rfalChipMeasurePhase();
+
+    private:
+        struct Request
+        {
+            RequestId id = 0;
+            uint16_t cmdId = 0;
+            std::vector<uint8_t> frame; // emptied once copied to the write buffer
+            size_t frameLen = 0;
+            uint64_t txEnd = 0;         // stream offset just past the frame
+            uint64_t sentUs = 0;
+            Reactor::TimerId timer = 0;
+            Completion done; // empty once cancelled or timed out in flight
+            bool expired = false;
+        };
+
+        void onEvents(uint32_t events) override;
+        void pump();
+        int writeSome();
+        void watchOut(bool on);
+        void readSome();
+        bool parseRx();
+        bool dropStalledHeader();
+        void onFrame(const SerRfalWire::Frame& f);
+        void finish(Status status, const uint8_t* payload, size_t payloadLen);
+        void expire(RequestId id);
+        void armOrphan();
+        void completeLater(Completion done, Status status);
+        void failLater(int error);
+        void fail(int error);
+        void teardown(Status status);
+
+        Reactor& _reactor;
+        int _fd = -1;
+        termios _saved;
+        std::string _path;
+        uint32_t _timeoutMs = DEFAULT_RX_TIMEOUT;
+        unsigned _epoch = 0; // bumped on close, so loops over the rx buffer notice a re-open
+        RequestId _nextId = 1;
+
+        std::deque<Request> _queue;    // not written yet
+        std::deque<Request> _inFlight; // written (or being written), oldest first
+        size_t _credit = SerRfalWire::DefaultRxCredit;
+        size_t _inFlightBytes = 0;
+        int _corked = 0;
+        std::vector<uint8_t> _tx; // bytes of _inFlight not yet written: [_txOfs, size)
+        size_t _txOfs = 0;
+        uint64_t _txWritten = 0;   // stream offset of the next byte written
+        bool _watchingOut = false;
+        Reactor::TimerId _failTimer = 0;
+        int _failError = 0;
+
+        uint8_t _rx[SerRfalWire::MaxRspFrameSize]; // holds the largest response frame
+        size_t _rxLen = 0;
+
+        serLinkStats _stats = {};
+    };
+
+    template <typename T>
+    Op<T>::Op(Port& port, uint16_t cmdId, const uint8_t* payload, size_t payloadLen, Decoder decode)
+        : _port(port), _cmdId(cmdId), _decode(decode)
+    {
+        if (payloadLen <= SerRfalWire::MaxFramePayload)
+        {
+            _frame.resize(SerRfalWire::FrameHeaderSize + payloadLen);
+            SerRfalWire::encodeFrame(_frame.data(), cmdId, payload, payloadLen);
+        }
+    }
+
+    template <typename T>
+    RequestId Op<T>::then(std::function<void(Result<T>)> done)
+    {
+        Decoder decode = _decode;
+        RequestId id = _port.submit(_cmdId, std::move(_frame), _timeoutMs ? _timeoutMs : _port.timeoutMs(),
+                                    [decode, done = std::move(done)](Status status, const uint8_t* p, size_t len) {
+                                        Result<T> r;
+                                        r.status = status;
+                                        if (status == Status::Ok && !decode(p, len, r.value))
+                                            r.status = Status::Malformed;
+                                        done(std::move(r));
+                                    });
+        if (_track)
+            *_track = id;
+        return id;
+    }
+
+#if defined(__cpp_impl_coroutine)
+    // Fire-and-forget coroutine: starts immediately, runs on whichever callback resumes it, and
+    // frees itself when it returns.
+    struct Task
+    {
+        struct promise_type
+        {
+            Task get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    // co_await delay(reactor, ms): the coroutine form of Reactor::after, in place of Sleep().
+    class Delay
+    {
+    public:
+        Delay(Reactor& reactor, uint32_t ms) : _reactor(reactor), _ms(ms) {}
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { _reactor.after(_ms, [h] { h.resume(); }); }
+        void await_resume() const noexcept {}
+
+    private:
+        Reactor& _reactor;
+        uint32_t _ms;
+    };
+
+    inline Delay delay(Reactor& reactor, uint32_t ms)
+    {
+        return Delay(reactor, ms);
+    }
+#endif
+}
@@ -0,0 +1,856 @@
+// serRfal host API over POSIX termios; see SerRfalHost.h.
+//
+// Latency: the port is opened O_NONBLOCK with VMIN=0/VTIME=0, so the kernel never holds bytes back
+// waiting for a count or an inter-byte timer; poll() wakes on the first byte of the response and
+// each wake-up drains everything buffered in one read(). ASYNC_LOW_LATENCY and, for FTDI adapters,
+// a 1 ms latency_timer are requested best-effort (USB CDC and ptys do not support them).
+
+#include "SerRfalHost.h"
+
+#include <glob.h>
+#include <poll.h>
+
+#include "SerRfalWire.h"
+
+using namespace SerRfalWire;
+
+namespace
+{
+    struct Port
+    {
+        int fd = -1;
+        termios saved;
+        serComParameters params = {115200, 8, 1, 0};
+        unsigned rxTimeoutMs = DEFAULT_RX_TIMEOUT;
+        unsigned txTimeoutMs = DEFAULT_TX_TIMEOUT;
+        int traceMode = 0;
+        t_fnLog trace = printf;
+        serLinkStats stats = {};
+        uint32_t chipEpoch = 0;
+
+        // Bytes read but not yet consumed: [rxHead, rxTail). Holds the largest response frame.
+        uint8_t rx[MaxRspFrameSize];
+        size_t rxHead = 0;
+        size_t rxTail = 0;
+
+        uint8_t tx[MaxFrameSize];
+        uint8_t rsp[MaxRspPayload]; // payload of the last response; out-pointers point here
+        size_t rspLen = 0;
+
+        // serExecBatch: frames written in one go, and the responses of the last batch.
+        size_t rxCredit = DefaultRxCredit;
+        std::vector<uint8_t> batchTx;
+        std::vector<uint8_t> batchRsp;
+    };
+
+    Port g;
+
+    // Commands after which the chip's registers are still what the host last read or wrote.
+    bool keepsChipState(uint16_t cmdId)
+    {
+        switch (cmdId)
+        {
+            case SysPingReq:
+            case SysGetVersionReq:
+            case SysGetConfigHashesReq:
+            case RfalChipReadRegReq:
+            case RfalChipReadTestRegReq:
+            case RfalChipGetRFOReq:
+            case RfalChipMeasureAmplitudeReq:
+            case RfalChipMeasurePhaseReq:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool tracing(int flag)
+    {
+        return g.trace && (g.traceMode & SerTrace_Enable) && (g.traceMode & flag);
+    }
+
+    void traceBytes(const char* dir, const uint8_t* buf, size_t len)
+    {
+        if (!tracing(SerTrace_BufferContent))
+            return;
+        char line[3 * 64 + 1];
+        for (size_t ofs = 0; ofs < len; ofs += 64)
+        {
+            size_t n = len - ofs < 64 ? len - ofs : 64;
+            for (size_t i = 0; i < n; ++i)
+                snprintf(line + 3 * i, 4, "%02X ", buf[ofs + i]);
+            line[3 * n] = '\0';
+            g.trace("  %s %s\n", ofs == 0 ? dir : "  ", line);
+        }
+    }
+
+    bool writeAll(const uint8_t* buf, size_t len)
+    {
+        uint64_t deadline = nowUs() + g.txTimeoutMs * 1000ULL;
+        while (len > 0)
+        {
+            ssize_t n = write(g.fd, buf, len);
+            if (n > 0)
+            {
+                buf += n;
+                len -= static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno != EINTR && errno != EAGAIN)
+                return false;
+
+            uint64_t now = nowUs();
+            if (now >= deadline)
+                return false;
+            pollfd pfd = {g.fd, POLLOUT, 0};
+            poll(&pfd, 1, static_cast<int>((deadline - now + 999) / 1000));
+        }
+        return true;
+    }
+
+    // Reads whatever is buffered (waiting until the deadline for the first byte). Returns false
+    // on timeout or a port error.
+    bool fill(uint64_t deadlineUs)
+    {
+        if (g.rxHead == g.rxTail)
+            g.rxHead = g.rxTail = 0;
+        else if (g.rxTail == sizeof(g.rx))
+        {
+            memmove(g.rx, g.rx + g.rxHead, g.rxTail - g.rxHead);
+            g.rxTail -= g.rxHead;
+            g.rxHead = 0;
+        }
+
+        while (true)
+        {
+            ssize_t n = read(g.fd, g.rx + g.rxTail, sizeof(g.rx) - g.rxTail);
+            if (n > 0)
+            {
+                g.rxTail += static_cast<size_t>(n);
+                return true;
+            }
+            if (n < 0 && errno != EINTR && errno != EAGAIN)
+                return false;
+
+            uint64_t now = nowUs();
+            if (now >= deadlineUs)
+                return false;
+            pollfd pfd = {g.fd, POLLIN, 0};
+            if (poll(&pfd, 1, static_cast<int>((deadlineUs - now + 999) / 1000)) < 0 && errno != EINTR)
+                return false;
+        }
+    }
+
+    // Next complete frame from the port; skips bytes up to a header.
+    bool readFrame(uint16_t& cmdId, uint64_t deadlineUs)
+    {
+        while (true)
+        {
+            Frame f;
+            size_t consumed = 0;
+            bool found = parseFrame(g.rx + g.rxHead, g.rxTail - g.rxHead, f, consumed, g.stats.skipped);
+            if (found)
+            {
+                cmdId = f.cmdId;
+                g.rspLen = f.payloadLen;
+                memcpy(g.rsp, f.payload, f.payloadLen);
+                traceBytes("rx", g.rx + g.rxHead + consumed - f.size, f.size);
+            }
+            g.rxHead += consumed;
+            if (found)
+                return true;
+            if (!fill(deadlineUs))
+            {
+                // Whatever header is left waited a whole timeout for its frame (see parseFrame).
+                if (g.rxHead < g.rxTail)
+                {
+                    g.rxHead++;
+                    g.stats.skipped++;
+                }
+                return false;
+            }
+        }
+    }
+
+    // One request/response exchange; the response payload is left in g.rsp/g.rspLen.
+    bool exchange(const char* fn, uint16_t cmdId, const uint8_t* payload, size_t payloadLen)
+    {
+        if (tracing(SerTrace_FunctionCall))
+            g.trace("%s\n", fn);
+        g.rspLen = 0;
+        if (g.fd < 0 || payloadLen > MaxFramePayload)
+        {
+            if (tracing(SerTrace_ProtocolErrors))
+                g.trace("%s: %s\n", fn, g.fd < 0 ? "port not open" : "request too large");
+            g.stats.failures++;
+            return false;
+        }
+
+        size_t frameLen = encodeFrame(g.tx, cmdId, payload, payloadLen);
+        traceBytes("tx", g.tx, frameLen);
+        if (!keepsChipState(cmdId))
+            g.chipEpoch++;
+
+        uint64_t t0 = nowUs();
+        if (!writeAll(g.tx, frameLen))
+        {
+            if (tracing(SerTrace_ProtocolErrors))
+                g.trace("%s: write failed: %s\n", fn, strerror(errno));
+            g.stats.failures++;
+            return false;
+        }
+
+        uint64_t deadline = t0 + g.rxTimeoutMs * 1000ULL;
+        uint16_t rspCmd = 0;
+        while (readFrame(rspCmd, deadline))
+        {
+            if (rspCmd == static_cast<uint16_t>(cmdId + 1))
+            {
+                uint32_t rtt = static_cast<uint32_t>(nowUs() - t0);
+                g.stats.exchanges++;
+                g.stats.rttSumUs += rtt;
+                if (g.stats.rttMinUs == 0 || rtt < g.stats.rttMinUs)
+                    g.stats.rttMinUs = rtt;
+                if (rtt > g.stats.rttMaxUs)
+                    g.stats.rttMaxUs = rtt;
+                return true;
+            }
+            // A late response to an earlier, timed-out request.
+            g.stats.skipped++;
+        }
+
+        if (tracing(SerTrace_ProtocolErrors))
+            g.trace("%s: no response to 0x%04X within %u ms\n", fn, cmdId, g.rxTimeoutMs);
+        g.stats.failures++;
+        return false;
+    }
+
+    bool malformed(const char* fn)
+    {
+        if (tracing(SerTrace_ProtocolErrors))
+            g.trace("%s: malformed response (%zu bytes)\n", fn, g.rspLen);
+        g.stats.failures++;
+        return false;
+    }
+
+    void checkRet(const char* fn, ReturnCode ret)
+    {
+        if (ret != RFAL_ERR_NONE && tracing(SerTrace_WrongReturnCode))
+            g.trace("%s: ret=%u\n", fn, ret);
+    }
+
+    // Commands whose response is just ret u16.
+    bool execRet(const char* fn, uint16_t cmdId, const uint8_t* payload, size_t payloadLen, ReturnCode* ret)
+    {
+        if (!exchange(fn, cmdId, payload, payloadLen))
+            return false;
+        ReturnCode r;
+        if (!decodeRet(g.rsp, g.rspLen, r))
+            return malformed(fn);
+        checkRet(fn, r);
+        if (ret)
+            *ret = r;
+        return true;
+    }
+
+    // Commands whose response is ret u16, result u8.
+    bool execRetU8(const char* fn, uint16_t cmdId, ReturnCode* ret, uint8_t* result, const uint8_t* payload = nullptr,
+                   size_t payloadLen = 0)
+    {
+        if (!exchange(fn, cmdId, payload, payloadLen))
+            return false;
+        ReturnCode r;
+        uint8_t v;
+        if (!decodeRetU8(g.rsp, g.rspLen, r, v))
+            return malformed(fn);
+        checkRet(fn, r);
+        if (ret)
+            *ret = r;
+        if (result)
+            *result = v;
+        return true;
+    }
+}
+
+bool serComOpen(const char* lpComName, int32_t& error)
+{
+    if (g.fd >= 0)
+    {
+        int32_t ignored;
+        serComClose(ignored);
+    }
+
+    int fd = openPort(lpComName, g.params, &g.saved, error);
+    if (fd < 0)
+        return false;
+    g.fd = fd;
+    g.rxHead = g.rxTail = 0;
+    g.stats = {};
+    g.chipEpoch++;
+    if (tracing(SerTrace_StdLog))
+        g.trace("serComOpen %s %d baud\n", lpComName, g.params.BaudRate);
+    return true;
+}
+
+bool serComClose(int32_t& error)
+{
+    error = 0;
+    if (g.fd < 0)
+        return true;
+    tcsetattr(g.fd, TCSANOW, &g.saved);
+    if (close(g.fd) != 0)
+        error = errno;
+    g.fd = -1;
+    return error == 0;
+}
+
+bool serComPurge()
+{
+    if (g.fd < 0)
+        return false;
+    g.rxHead = g.rxTail = 0;
+    return tcflush(g.fd, TCIOFLUSH) == 0;
+}
+
+bool serComRawSnd(uint8_t* buf, uint16_t bufLen)
+{
+    if (g.fd < 0)
+        return false;
+    traceBytes("tx", buf, bufLen);
+    g.chipEpoch++;
+    return writeAll(buf, bufLen);
+}
+
+bool serComRawRcv(uint8_t* buf, uint16_t& bufLen)
+{
+    if (g.fd < 0)
+        return false;
+    if (g.rxHead == g.rxTail && !fill(nowUs() + g.rxTimeoutMs * 1000ULL))
+    {
+        bufLen = 0;
+        return false;
+    }
+    size_t n = g.rxTail - g.rxHead;
+    if (n > bufLen)
+        n = bufLen;
+    memcpy(buf, g.rx + g.rxHead, n);
+    g.rxHead += n;
+    bufLen = static_cast<uint16_t>(n);
+    traceBytes("rx", buf, n);
+    return true;
+}
+
+bool serSetTraceMode(int32_t value)
+{
+    g.traceMode = value;
+    return true;
+}
+
+bool serGetTraceMode(int& value)
+{
+    value = g.traceMode;
+    return true;
+}
+
+bool serSetTraceFunction(t_fnLog fn)
+{
+    g.trace = fn;
+    return true;
+}
+
+bool serSetTimeouts(const unsigned int rxTimeout, const unsigned int txTimeout)
+{
+    g.rxTimeoutMs = rxTimeout;
+    g.txTimeoutMs = txTimeout;
+    return true;
+}
+
+bool serGetTimeouts(unsigned int* rxTimeout, unsigned int* txTimeout)
+{
+    if (rxTimeout)
+        *rxTimeout = g.rxTimeoutMs;
+    if (txTimeout)
+        *txTimeout = g.txTimeoutMs;
+    return true;
+}
+
+bool serSetSerialParams(const serComParameters& serialParam)
+{
+    if (toSpeed(serialParam.BaudRate) == 0)
+        return false;
+    g.params = serialParam;
+    return true;
+}
+
+bool serApplySerialParams(const serComParameters& serialParam)
+{
+    if (!serSetSerialParams(serialParam))
+        return false;
+    return g.fd < 0 || applyParams(g.fd, serialParam);
+}
+
+bool serGetSerialParams(serComParameters& serialParam)
+{
+    serialParam = g.params;
+    return true;
+}
+
+bool serInitDefaultSerialParams(serComParameters& serialParam)
+{
+    serialParam = {115200, 8, 1, 0};
+    return true;
+}
+
+std::vector<std::string> serComEnumeratePorts()
+{
+    std::vector<std::string> ports;
+    static const char* kPatterns[] = {"/dev/ttyACM*", "/dev/ttyUSB*"};
+    for (const char* pattern : kPatterns)
+    {
+        glob_t gl;
+        if (glob(pattern, 0, nullptr, &gl) == 0)
+        {
+            for (size_t i = 0; i < gl.gl_pathc; ++i)
+                ports.push_back(gl.gl_pathv[i]);
+        }
+        globfree(&gl);
+    }
+    return ports;
+}
+
+bool serGetLinkStats(serLinkStats& stats, bool reset)
+{
+    stats = g.stats;
+    if (reset)
+        g.stats = {};
+    return true;
+}
+
+bool serSetRxCredit(size_t bytes)
+{
+    g.rxCredit = bytes;
+    return true;
+}
+
+bool serGetRxCredit(size_t& bytes)
+{
+    bytes = g.rxCredit;
+    return true;
+}
+
+bool serExecBatch(serBatchItem* items, size_t count)
+{
+    if (tracing(SerTrace_FunctionCall))
+        g.trace("serExecBatch %zu\n", count);
+    g.rspLen = 0;
+    g.batchRsp.clear();
+    bool valid = g.fd >= 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        items[i].ok = false;
+        items[i].rsp = nullptr;
+        items[i].rspLen = 0;
+        valid = valid && items[i].payloadLen <= MaxFramePayload;
+    }
+    if (!valid)
+    {
+        if (tracing(SerTrace_ProtocolErrors))
+            g.trace("serExecBatch: %s\n", g.fd < 0 ? "port not open" : "request too large");
+        g.stats.failures++;
+        return false;
+    }
+
+    // Response payloads are appended to batchRsp; the item pointers are set once it stops growing.
+    std::vector<size_t> rspOfs(count);
+    std::vector<uint64_t> sentUs(count);
+    size_t sent = 0;
+    size_t done = 0;
+    size_t inFlightBytes = 0;
+    bool ok = true;
+    while (done < count)
+    {
+        // Everything that fits the credit goes out in one write; the oldest always goes.
+        g.batchTx.clear();
+        size_t first = sent;
+        while (sent < count)
+        {
+            size_t frameLen = FrameHeaderSize + items[sent].payloadLen;
+            if (sent > done && inFlightBytes + frameLen > g.rxCredit)
+                break;
+            size_t ofs = g.batchTx.size();
+            g.batchTx.resize(ofs + frameLen);
+            encodeFrame(g.batchTx.data() + ofs, items[sent].cmdId, items[sent].payload, items[sent].payloadLen);
+            if (!keepsChipState(items[sent].cmdId))
+                g.chipEpoch++;
+            inFlightBytes += frameLen;
+            sent++;
+        }
+        if (!g.batchTx.empty())
+        {
+            traceBytes("tx", g.batchTx.data(), g.batchTx.size());
+            uint64_t t0 = nowUs();
+            if (!writeAll(g.batchTx.data(), g.batchTx.size()))
+            {
+                if (tracing(SerTrace_ProtocolErrors))
+                    g.trace("serExecBatch: write failed: %s\n", strerror(errno));
+                g.stats.failures++;
+                ok = false;
+                break;
+            }
+            for (size_t i = first; i < sent; ++i)
+                sentUs[i] = t0;
+        }
+
+        serBatchItem& item = items[done];
+        uint64_t deadline = sentUs[done] + g.rxTimeoutMs * 1000ULL;
+        uint16_t rspCmd = 0;
+        bool found = false;
+        while (readFrame(rspCmd, deadline))
+        {
+            if (rspCmd == static_cast<uint16_t>(item.cmdId + 1))
+            {
+                found = true;
+                break;
+            }
+            g.stats.skipped++;
+        }
+        if (!found)
+        {
+            if (tracing(SerTrace_ProtocolErrors))
+                g.trace("serExecBatch: no response to 0x%04X within %u ms\n", item.cmdId, g.rxTimeoutMs);
+            g.stats.failures++;
+            ok = false;
+            break;
+        }
+
+        uint32_t rtt = static_cast<uint32_t>(nowUs() - sentUs[done]);
+        g.stats.exchanges++;
+        g.stats.rttSumUs += rtt;
+        if (g.stats.rttMinUs == 0 || rtt < g.stats.rttMinUs)
+            g.stats.rttMinUs = rtt;
+        if (rtt > g.stats.rttMaxUs)
+            g.stats.rttMaxUs = rtt;
+        rspOfs[done] = g.batchRsp.size();
+        g.batchRsp.insert(g.batchRsp.end(), g.rsp, g.rsp + g.rspLen);
+        item.ok = true;
+        item.rspLen = static_cast<uint16_t>(g.rspLen);
+        inFlightBytes -= FrameHeaderSize + item.payloadLen;
+        done++;
+    }
+
+    for (size_t i = 0; i < done; ++i)
+        items[i].rsp = g.batchRsp.data() + rspOfs[i];
+    return ok;
+}
+
+bool serGetChipEpoch(uint32_t& epoch)
+{
+    epoch = g.chipEpoch;
+    return true;
+}
+
+bool serExecSysPing(void)
+{
+    return exchange(__func__, SysPingReq, nullptr, 0);
+}
+
+bool serExecSysGetVersion(uint8_t** version, uint16_t* versionLen, uint32_t* rfalVersion, uint32_t* fwVersion,
+                          uint32_t* serHash)
+{
+    if (!exchange(__func__, SysGetVersionReq, nullptr, 0))
+        return false;
+    VersionInfo v;
+    if (!decodeVersion(g.rsp, g.rspLen, v))
+        return malformed(__func__);
+    if (version)
+        *version = const_cast<uint8_t*>(v.text);
+    if (versionLen)
+        *versionLen = v.textLen;
+    if (rfalVersion)
+        *rfalVersion = v.rfalVersion;
+    if (fwVersion)
+        *fwVersion = v.fwVersion;
+    if (serHash)
+        *serHash = v.serHash;
+    return true;
+}
+
+bool serExecSysGetConfigHashes(ReturnCode* ret, uint8_t configID, uint32_t* hashOriginal, uint32_t* hashFlash,
+                               uint32_t* hashRAM)
+{
+    if (!exchange(__func__, SysGetConfigHashesReq, &configID, 1))
+        return false;
+    ConfigHashes h;
+    if (!decodeConfigHashes(g.rsp, g.rspLen, h))
+        return malformed(__func__);
+    checkRet(__func__, h.ret);
+    if (ret)
+        *ret = h.ret;
+    if (hashOriginal)
+        *hashOriginal = h.original;
+    if (hashFlash)
+        *hashFlash = h.flash;
+    if (hashRAM)
+        *hashRAM = h.ram;
+    return true;
+}
+
+bool serExecSysNfcReset(ReturnCode* ret)
+{
+    return execRet(__func__, SysNfcResetReq, nullptr, 0, ret);
+}
+
+bool serExecSysSpiTxRx(ReturnCode* ret, uint8_t* txBuf, uint16_t txBufLen, uint8_t** rxBuf, uint16_t* actLen)
+{
+    // u16 length, bytes clocked out in one chip select; the response has the bytes clocked in
+    if (!txBuf || 2u + txBufLen > MaxFramePayload)
+        return false;
+    uint8_t payload[MaxFramePayload];
+    Writer w(payload);
+    w.u16(txBufLen);
+    w.bytes(txBuf, txBufLen);
+    if (!exchange(__func__, SysSpiTxRxReq, payload, w.size()))
+        return false;
+
+    ReturnCode r;
+    const uint8_t* bytes;
+    uint16_t got;
+    if (!decodeRetBytes(g.rsp, g.rspLen, r, bytes, got))
+        return malformed(__func__);
+    checkRet(__func__, r);
+    if (ret)
+        *ret = r;
+    if (rxBuf)
+        *rxBuf = const_cast<uint8_t*>(bytes);
+    if (actLen)
+        *actLen = got;
+    return true;
+}
+
+bool serExecRfalInitialize(ReturnCode* ret)
+{
+    return execRet(__func__, RfalInitializeReq, nullptr, 0, ret);
+}
+
+bool serExecRfalFieldOff(ReturnCode* ret)
+{
+    return execRet(__func__, RfalFieldOffReq, nullptr, 0, ret);
+}
+
+bool serExecRfalNfcInitialize(ReturnCode* ret)
+{
+    return execRet(__func__, RfalNfcInitializeReq, nullptr, 0, ret);
+}
+
+bool serExecRfalNfcDiscover(ReturnCode* ret, serRfalNfcDiscoverParam* disParams)
+{
+    if (!disParams)
+        return false;
+    uint8_t params[DiscoverParamsLen];
+    size_t len = writeDiscoverParams(params, *disParams);
+    return execRet(__func__, RfalNfcDiscoverReq, params, len, ret);
+}
+
+bool serExecRfalNfcGetState(rfalNfcState* state)
+{
+    if (!exchange(__func__, RfalNfcGetStateReq, nullptr, 0))
+        return false;
+    Cursor c(g.rsp, g.rspLen);
+    uint32_t st = c.u32();
+    if (!c.ok())
+        return malformed(__func__);
+    if (state)
+        *state = static_cast<rfalNfcState>(st);
+    return true;
+}
+
+bool serExecRfalNfcGetDevicesFound(ReturnCode* ret, serFlatRfalNfcDevice* devList, uint8_t* devCnt)
+{
+    if (!exchange(__func__, RfalNfcGetDevicesReq, nullptr, 0))
+        return false;
+    uint8_t cap = devCnt ? *devCnt : 0;
+    ReturnCode r;
+    size_t n = 0;
+    if (!decodeDevices(g.rsp, g.rspLen, r, devList, cap, n))
+        return malformed(__func__);
+    checkRet(__func__, r);
+    if (ret)
+        *ret = r;
+    if (devCnt)
+        *devCnt = static_cast<uint8_t>(n < cap ? n : cap);
+    return true;
+}
+
+bool serExecRfalNfcDeactivate(ReturnCode* ret, rfalNfcDeactivateType deactType)
+{
+    uint8_t payload[4];
+    Writer w(payload);
+    w.u32(static_cast<uint32_t>(deactType));
+    return execRet(__func__, RfalNfcDeactivateReq, payload, w.size(), ret);
+}
+
+bool serExecRfalAnalogConfigListWriteRaw(ReturnCode* ret, uint8_t* configTbl, uint16_t configTblSize)
+{
+    // u16 length, table
+    if (!configTbl || configTblSize > MaxFramePayload - 2)
+    {
+        if (tracing(SerTrace_ProtocolErrors))
+            g.trace("%s: table of %u bytes does not fit one frame\n", __func__, configTblSize);
+        return false;
+    }
+    uint8_t payload[MaxFramePayload];
+    Writer w(payload);
+    w.u16(configTblSize);
+    w.bytes(configTbl, configTblSize);
+    return execRet(__func__, RfalAnalogConfigListWriteRawReq, payload, w.size(), ret);
+}
+
+bool serExecRfalAnalogConfigListReadRaw(ReturnCode* ret, uint8_t** configTbl, uint16_t* configTblSize)
+{
+    if (!exchange(__func__, RfalAnalogConfigListReadRawReq, nullptr, 0))
+        return false;
+    ReturnCode r;
+    const uint8_t* tbl;
+    uint16_t size;
+    if (!decodeRetBytes(g.rsp, g.rspLen, r, tbl, size))
+        return malformed(__func__);
+    checkRet(__func__, r);
+    if (ret)
+        *ret = r;
+    if (configTbl)
+        *configTbl = const_cast<uint8_t*>(tbl);
+    if (configTblSize)
+        *configTblSize = size;
+    return true;
+}
+
+bool serExecRfalDpoTableWrite(ReturnCode* ret, rfalDpoEntry* powerTbl, uint8_t powerTblEntries)
+{
+    // count u8, count x {rfoRes, inc, dec}
+    if (!powerTbl || 1u + 3u * powerTblEntries > MaxFramePayload)
+        return false;
+    uint8_t payload[MaxFramePayload];
+    Writer w(payload);
+    w.u8(powerTblEntries);
+    for (uint8_t i = 0; i < powerTblEntries; ++i)
+    {
+        w.u8(powerTbl[i].rfoRes);
+        w.u8(powerTbl[i].inc);
+        w.u8(powerTbl[i].dec);
+    }
+    return execRet(__func__, RfalDpoTableWriteReq, payload, w.size(), ret);
+}
+
+bool serExecRfalDpoSetEnable(ReturnCode* ret, bool enable)
+{
+    uint8_t payload = enable ? 1 : 0;
+    return execRet(__func__, RfalDpoSetEnableReq, &payload, 1, ret);
+}
+
+bool serExecRfalChipWriteReg(ReturnCode* ret, uint16_t reg, uint8_t* values, uint8_t len)
+{
+    // reg u16, u16 length, values
+    if (!values || 4u + len > MaxFramePayload)
+        return false;
+    uint8_t payload[MaxFramePayload];
+    Writer w(payload);
+    w.u16(reg);
+    w.u16(len);
+    w.bytes(values, len);
+    return execRet(__func__, RfalChipWriteRegReq, payload, w.size(), ret);
+}
+
+bool serExecRfalChipReadReg(ReturnCode* ret, uint16_t reg, uint8_t len, uint8_t** values, uint8_t* actLen)
+{
+    uint8_t payload[3];
+    Writer w(payload);
+    w.u16(reg);
+    w.u8(len);
+    if (!exchange(__func__, RfalChipReadRegReq, payload, w.size()))
+        return false;
+
+    ReturnCode r;
+    const uint8_t* bytes;
+    uint16_t got;
+    if (!decodeRetBytes(g.rsp, g.rspLen, r, bytes, got) || got > 0xFF)
+        return malformed(__func__);
+    checkRet(__func__, r);
+    if (ret)
+        *ret = r;
+    if (values)
+        *values = const_cast<uint8_t*>(bytes);
+    if (actLen)
+        *actLen = static_cast<uint8_t>(got);
+    return true;
+}
+
+bool serExecRfalChipChangeRegBits(ReturnCode* ret, uint16_t reg, uint8_t valueMask, uint8_t value)
+{
+    // reg u16, mask u8, value u8
+    uint8_t payload[4];
+    Writer w(payload);
+    w.u16(reg);
+    w.u8(valueMask);
+    w.u8(value);
+    return execRet(__func__, RfalChipChangeRegBitsReq, payload, w.size(), ret);
+}
+
+bool serExecRfalChipWriteTestReg(ReturnCode* ret, uint16_t reg, uint8_t value)
+{
+    uint8_t payload[3];
+    Writer w(payload);
+    w.u16(reg);
+    w.u8(value);
+    return execRet(__func__, RfalChipWriteTestRegReq, payload, w.size(), ret);
+}
+
+bool serExecRfalChipReadTestReg(ReturnCode* ret, uint16_t reg, uint8_t* value)
+{
+    uint8_t payload[2];
+    Writer w(payload);
+    w.u16(reg);
+    return execRetU8(__func__, RfalChipReadTestRegReq, ret, value, payload, w.size());
+}
+
+bool serExecRfalChipChangeTestRegBits(ReturnCode* ret, uint16_t reg, uint8_t valueMask, uint8_t value)
+{
+    uint8_t payload[4];
+    Writer w(payload);
+    w.u16(reg);
+    w.u8(valueMask);
+    w.u8(value);
+    return execRet(__func__, RfalChipChangeTestRegBitsReq, payload, w.size(), ret);
+}
+
+bool serExecRfalChipExecCmd(ReturnCode* ret, uint16_t cmd)
+{
+    uint8_t payload[2];
+    Writer w(payload);
+    w.u16(cmd);
+    return execRet(__func__, RfalChipExecCmdReq, payload, w.size(), ret);
+}
+
+bool serExecRfalChipSetRFO(ReturnCode* ret, uint8_t RFO)
+{
+    return execRet(__func__, RfalChipSetRFOReq, &RFO, 1, ret);
+}
+
+bool serExecRfalChipGetRFO(ReturnCode* ret, uint8_t* result)
+{
+    return execRetU8(__func__, RfalChipGetRFOReq, ret, result);
+}
+
+bool serExecRfalChipMeasureAmplitude(ReturnCode* ret, uint8_t* result)
+{
+    return execRetU8(__func__, RfalChipMeasureAmplitudeReq, ret, result);
+}
+
+bool serExecRfalChipMeasurePhase(ReturnCode* ret, uint8_t* result)
+{
+    return execRetU8(__func__, RfalChipMeasurePhaseReq, ret, result);
+}
+
+bool serExecRfalWakeUpModeStop(ReturnCode* ret)
+{
+    return execRet(__func__, RfalWakeUpModeStopReq, nullptr, 0, ret);
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+// Linux implementation of the serRfal host API (serRfal_api.h / serHost.h of the Windows
+// ser_Rfal.dll) over POSIX termios. Same names and signatures for the serCom* calls and for the
+// serExec* subset listed in README.md, so code written against the DLL (ST25R200_Console.cpp)
+// ports by swapping the include. Types come from the ST headers:
+//
+//   -I ../ST25R200_Eval_GUI/Exe_Demos/Includes -I ../arduino
+//
+// One port per process, like the DLL. Not thread-safe; call from one thread.
+
+#ifndef RFAL_FEATURE_NFC_RF_BUF_LEN
+#define RFAL_FEATURE_NFC_RF_BUF_LEN 1024
+#endif
+
+#include "rfal_platform.h"
+#include "serCommonTypes.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+typedef int (*t_fnLog)(const char*, ...);
+
+enum
+{
+    SerTrace_Enable = 0x0001,
+    SerTrace_StdLog = 0x0002,
+    SerTrace_ProtocolErrors = 0x0004,
+    SerTrace_WrongReturnCode = 0x0008,
+    SerTrace_FunctionCall = 0x0010,
+    SerTrace_BufferContent = 0x0020,
+    SerTrace_ConsoleDefault = SerTrace_Enable | SerTrace_ProtocolErrors | SerTrace_WrongReturnCode |
+                              SerTrace_FunctionCall | SerTrace_BufferContent,
+    SerTrace_Default = SerTrace_Enable | SerTrace_StdLog,
+    SerTrace_StdLogEnable = SerTrace_Enable | SerTrace_StdLog,
+};
+
+#define DEFAULT_RX_TIMEOUT 2000
+#define DEFAULT_TX_TIMEOUT 200
+
+typedef struct serComParameters
+{
+    int BaudRate; // 9600 ... 2000000
+    int ByteSize; // 5 to 8
+    int StopBits; // OneStop = 1, TwoStop = 2
+    int Parity;   // NoParity = 0, EvenParity = 2, OddParity = 3
+} serComParameters;
+
+// Transport counters since serComOpen (Linux addition; the DLL has no equivalent).
+struct serLinkStats
+{
+    uint32_t exchanges; // serExec* calls that got their response
+    uint32_t failures;  // write errors, timeouts, malformed responses
+    uint32_t skipped;   // bytes or stale frames dropped while looking for a response
+    uint32_t rttMinUs;
+    uint32_t rttMaxUs;
+    uint64_t rttSumUs;
+};
+
+bool serComClose(int32_t& error);
+bool serComOpen(const char* lpComName, int32_t& error);
+bool serComPurge();
+bool serComRawSnd(uint8_t* buf, uint16_t bufLen);
+bool serComRawRcv(uint8_t* buf, uint16_t& bufLen);
+
+bool serSetTraceMode(int32_t value);
+bool serGetTraceMode(int& value);
+bool serSetTraceFunction(t_fnLog fn);
+
+bool serSetTimeouts(const unsigned int rxTimeout, const unsigned int txTimeout);
+bool serGetTimeouts(unsigned int* rxTimeout, unsigned int* txTimeout);
+bool serSetSerialParams(const serComParameters& serialParam);   // used by the next serComOpen
+bool serApplySerialParams(const serComParameters& serialParam); // also applied to the open port
+bool serGetSerialParams(serComParameters& serialParam);
+bool serInitDefaultSerialParams(serComParameters& serialParam);
+std::vector<std::string> serComEnumeratePorts();
+
+bool serGetLinkStats(serLinkStats& stats, bool reset = false);
+
+// One request of serExecBatch (Linux addition): a raw serRfal payload, encoded and decoded with
+// SerRfalWire. The response payload stays valid until the next call.
+struct serBatchItem
+{
+    uint16_t cmdId;         // request; the response is cmdId + 1
+    const uint8_t* payload;
+    uint16_t payloadLen;
+    bool ok;                // out: the response arrived
+    const uint8_t* rsp;     // out: response payload
+    uint16_t rspLen;
+};
+
+// Request bytes allowed on the wire before the oldest is answered (default
+// SerRfalWire::DefaultRxCredit; 0 sends one request at a time). Used by serExecBatch only.
+bool serSetRxCredit(size_t bytes);
+bool serGetRxCredit(size_t& bytes);
+
+// Writes independent requests back to back, as many at a time as the rx credit allows, and takes
+// the responses in order; each response frees the credit of its request. After a timeout the
+// remaining items fail (their late responses are skipped like any other). True when all are ok.
+bool serExecBatch(serBatchItem* items, size_t count);
+
+// Bumped before every command that may change chip registers behind a host-side copy (anything
+// but reads, pings and measurements, including register writes). Linux addition, for RegShadow.
+bool serGetChipEpoch(uint32_t& epoch);
+
+// Out-pointers (uint8_t**) point into a response buffer that stays valid until the next call.
+extern "C"
+{
+    bool serExecSysPing(void);
+    bool serExecSysGetVersion(uint8_t** version, uint16_t* versionLen, uint32_t* rfalVersion, uint32_t* fwVersion,
+                              uint32_t* serHash);
+    bool serExecSysGetConfigHashes(ReturnCode* ret, uint8_t configID, uint32_t* hashOriginal, uint32_t* hashFlash,
+                                   uint32_t* hashRAM);
+    bool serExecSysNfcReset(ReturnCode* ret);
+    bool serExecSysSpiTxRx(ReturnCode* ret, uint8_t* txBuf, uint16_t txBufLen, uint8_t** rxBuf, uint16_t* actLen);
+
+    bool serExecRfalInitialize(ReturnCode* ret);
+    bool serExecRfalFieldOff(ReturnCode* ret);
+
+    bool serExecRfalNfcInitialize(ReturnCode* ret);
+    bool serExecRfalNfcDiscover(ReturnCode* ret, serRfalNfcDiscoverParam* disParams);
+    bool serExecRfalNfcGetState(rfalNfcState* state);
+    bool serExecRfalNfcGetDevicesFound(ReturnCode* ret, serFlatRfalNfcDevice* devList, uint8_t* devCnt);
+    bool serExecRfalNfcDeactivate(ReturnCode* ret, rfalNfcDeactivateType deactType);
+
+    bool serExecRfalAnalogConfigListWriteRaw(ReturnCode* ret, uint8_t* configTbl, uint16_t configTblSize);
+    bool serExecRfalAnalogConfigListReadRaw(ReturnCode* ret, uint8_t** configTbl, uint16_t* configTblSize);
+    bool serExecRfalDpoTableWrite(ReturnCode* ret, rfalDpoEntry* powerTbl, uint8_t powerTblEntries);
+    bool serExecRfalDpoSetEnable(ReturnCode* ret, bool enable);
+
+    bool serExecRfalChipWriteReg(ReturnCode* ret, uint16_t reg, uint8_t* values, uint8_t len);
+    bool serExecRfalChipReadReg(ReturnCode* ret, uint16_t reg, uint8_t len, uint8_t** values, uint8_t* actLen);
+    bool serExecRfalChipChangeRegBits(ReturnCode* ret, uint16_t reg, uint8_t valueMask, uint8_t value);
+    bool serExecRfalChipWriteTestReg(ReturnCode* ret, uint16_t reg, uint8_t value);
+    bool serExecRfalChipReadTestReg(ReturnCode* ret, uint16_t reg, uint8_t* value);
+    bool serExecRfalChipChangeTestRegBits(ReturnCode* ret, uint16_t reg, uint8_t valueMask, uint8_t value);
+    bool serExecRfalChipExecCmd(ReturnCode* ret, uint16_t cmd);
+    bool serExecRfalChipSetRFO(ReturnCode* ret, uint8_t RFO);
+    bool serExecRfalChipGetRFO(ReturnCode* ret, uint8_t* result);
+    bool serExecRfalChipMeasureAmplitude(ReturnCode* ret, uint8_t* result);
+    bool serExecRfalChipMeasurePhase(ReturnCode* ret, uint8_t* result);
+
+    bool serExecRfalWakeUpModeStop(ReturnCode* ret);
+}
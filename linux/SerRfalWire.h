@@ -0,0 +1,512 @@
+#pragma once
+
+// Frame codec, command payloads and port setup shared by SerRfalHost (blocking) and SerRfalAsync
+// (reactor). Header-only; needs the ST include path like SerRfalHost.h.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/serial.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "FlatNfcDevice.h"
+#include "SerRfalHost.h"
+#include "WakeUpConfig.h"
+
+namespace SerRfalWire
+{
+    constexpr uint8_t FrameHeader = 0xAA;
+    constexpr size_t FrameHeaderSize = 5;   // 0xAA, u16 length, u16 command ID
+    constexpr size_t MaxFramePayload = 256; // firmware receive buffer: the request limit
+    constexpr size_t MaxFrameSize = FrameHeaderSize + MaxFramePayload;
+    // Responses are not bounded by that buffer: the u16 length counts the command ID, so a response
+    // payload (an analog config table, say) can be anything up to this.
+    constexpr size_t MaxRspPayload = 0xFFFF - 2;
+    constexpr size_t MaxRspFrameSize = FrameHeaderSize + MaxRspPayload;
+    constexpr size_t DiscoverParamsLen = 167;
+    // Receive path assumption, the same for every host in this tree (this one, the Arduino reader
+    // and the C# service): the firmware buffers one whole request frame of the largest size written
+    // at full baud, so a frame goes out in one write without pacing. The default credit, the request
+    // bytes that may be on the wire unanswered, is that one frame and nothing more. st25-link-bench
+    // -w measures what a given device really takes.
+    constexpr size_t DefaultRxCredit = MaxFrameSize;
+
+    enum : uint16_t
+    {
+        SysPingReq = 0xF000,
+        SysGetVersionReq = 0xF002,
+        SysGetConfigHashesReq = 0xF004,
+        SysSpiTxRxReq = 0xF00E,
+        SysNfcResetReq = 0xF016,
+        RfalInitializeReq = 0x1000,
+        RfalFieldOffReq = 0x1014,
+        RfalAnalogConfigListWriteRawReq = 0x1142,
+        RfalAnalogConfigListReadRawReq = 0x1144,
+        RfalDpoTableWriteReq = 0x1152,
+        RfalDpoSetEnableReq = 0x1156,
+        RfalChipWriteRegReq = 0x1160,
+        RfalChipReadRegReq = 0x1162,
+        RfalChipChangeRegBitsReq = 0x1164,
+        RfalChipWriteTestRegReq = 0x1166,
+        RfalChipReadTestRegReq = 0x1168,
+        RfalChipChangeTestRegBitsReq = 0x116A,
+        RfalChipExecCmdReq = 0x116C,
+        RfalChipSetRFOReq = 0x116E,
+        RfalChipGetRFOReq = 0x1170,
+        RfalChipMeasureAmplitudeReq = 0x1172,
+        RfalChipMeasurePhaseReq = 0x1174,
+        RfalWakeUpModeStopReq = 0x1196,
+        RfalNfcInitializeReq = 0x2000,
+        RfalNfcDiscoverReq = 0x2002,
+        RfalNfcGetStateReq = 0x2004,
+        RfalNfcGetDevicesReq = 0x2006,
+        RfalNfcDeactivateReq = 0x2010,
+    };
+
+    // ST25R200 SPI, as clocked out by SysSpiTxRx: a chip select starts with the mode/address byte.
+    // Register accesses continue with the data of that register and the following ones; a direct
+    // command is its command byte alone.
+    constexpr uint8_t SpiRegWrite = 0x00;
+    constexpr uint8_t SpiRegRead = 0x80;
+    constexpr uint8_t SpiRegMask = 0x3F;
+    // Bytes of one chip select: the response (ret, length, the bytes clocked in) has to fit a frame.
+    constexpr size_t SpiMaxSelect = MaxFramePayload - 4;
+
+    inline uint64_t nowUs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+    }
+
+    // ---- port setup ----
+
+    inline speed_t toSpeed(int baud)
+    {
+        switch (baud)
+        {
+            case 9600: return B9600;
+            case 19200: return B19200;
+            case 38400: return B38400;
+            case 57600: return B57600;
+            case 115200: return B115200;
+            case 230400: return B230400;
+            case 460800: return B460800;
+            case 921600: return B921600;
+            case 1000000: return B1000000;
+            case 2000000: return B2000000;
+            default: return 0;
+        }
+    }
+
+    // Raw mode, VMIN=0/VTIME=0: with O_NONBLOCK and poll()/epoll nothing waits on a byte count or
+    // an inter-byte timer.
+    inline bool applyParams(int fd, const serComParameters& p)
+    {
+        speed_t speed = toSpeed(p.BaudRate);
+        if (speed == 0 || p.ByteSize < 5 || p.ByteSize > 8 || (p.StopBits != 1 && p.StopBits != 2) ||
+            (p.Parity != 0 && p.Parity != 2 && p.Parity != 3))
+            return false;
+
+        termios tio;
+        if (tcgetattr(fd, &tio) != 0)
+            return false;
+        cfmakeraw(&tio);
+        static const tcflag_t kSizes[] = {CS5, CS6, CS7, CS8};
+        tio.c_cflag &= ~(CSIZE | CSTOPB | PARENB | PARODD | CRTSCTS);
+        tio.c_cflag |= CLOCAL | CREAD | kSizes[p.ByteSize - 5];
+        if (p.StopBits == 2)
+            tio.c_cflag |= CSTOPB;
+        if (p.Parity != 0)
+            tio.c_cflag |= PARENB | (p.Parity == 3 ? PARODD : 0);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+        return tcsetattr(fd, TCSANOW, &tio) == 0;
+    }
+
+    // FTDI and other usb-serial adapters buffer up to latency_timer ms (default 16) before sending
+    // a USB packet to the host.
+    inline void lowerLatencyTimer(const char* path)
+    {
+        char real[PATH_MAX];
+        if (!realpath(path, real))
+            return;
+        const char* name = strrchr(real, '/');
+        char sysfs[PATH_MAX + 64];
+        snprintf(sysfs, sizeof(sysfs), "/sys/class/tty/%s/device/latency_timer", name ? name + 1 : real);
+        FILE* f = fopen(sysfs, "w");
+        if (!f)
+            return;
+        fputs("1", f);
+        fclose(f);
+    }
+
+    inline void lowLatency(int fd, const char* path)
+    {
+        serial_struct ss;
+        if (ioctl(fd, TIOCGSERIAL, &ss) == 0)
+        {
+            ss.flags |= ASYNC_LOW_LATENCY;
+            ioctl(fd, TIOCSSERIAL, &ss);
+        }
+        lowerLatencyTimer(path);
+    }
+
+    // Opens path non-blocking and exclusive (a second process cannot interleave frames), applies
+    // the parameters and the low-latency settings. Returns the fd, or -1 with error set to errno.
+    inline int openPort(const char* path, const serComParameters& params, termios* saved, int32_t& error)
+    {
+        error = 0;
+        int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+        {
+            error = errno;
+            return -1;
+        }
+        ioctl(fd, TIOCEXCL);
+        termios tio;
+        if (tcgetattr(fd, saved ? saved : &tio) != 0 || !applyParams(fd, params))
+        {
+            error = errno ? errno : EINVAL;
+            close(fd);
+            return -1;
+        }
+        lowLatency(fd, path);
+        tcflush(fd, TCIOFLUSH);
+        return fd;
+    }
+
+    // ---- frames ----
+
+    inline size_t encodeFrame(uint8_t* out, uint16_t cmdId, const uint8_t* payload, size_t payloadLen)
+    {
+        uint16_t len = static_cast<uint16_t>(2 + payloadLen);
+        out[0] = FrameHeader;
+        out[1] = static_cast<uint8_t>(len >> 8);
+        out[2] = static_cast<uint8_t>(len);
+        out[3] = static_cast<uint8_t>(cmdId >> 8);
+        out[4] = static_cast<uint8_t>(cmdId);
+        if (payloadLen)
+            memcpy(out + FrameHeaderSize, payload, payloadLen);
+        return FrameHeaderSize + payloadLen;
+    }
+
+    struct Frame
+    {
+        uint16_t cmdId;
+        const uint8_t* payload;
+        size_t payloadLen;
+        size_t size; // whole frame including the header
+    };
+
+    // Looks for one complete response frame in buf[0, len). skipped counts bytes dropped before a
+    // header (noise, a truncated earlier frame); consumed is how far the caller may discard. A
+    // header whose frame has not fully arrived stays at buf[consumed]; if the response timeout
+    // passes first, the caller drops that header byte, so a false header in noise cannot hold up
+    // the frames behind it.
+    inline bool parseFrame(const uint8_t* buf, size_t len, Frame& out, size_t& consumed, uint32_t& skipped)
+    {
+        size_t ofs = 0;
+        while (ofs < len)
+        {
+            if (buf[ofs] != FrameHeader)
+            {
+                ofs++;
+                skipped++;
+                continue;
+            }
+            if (len - ofs < FrameHeaderSize)
+                break;
+            size_t frameLen = static_cast<size_t>((buf[ofs + 1] << 8) | buf[ofs + 2]);
+            if (frameLen < 2 || frameLen - 2 > MaxRspPayload)
+            {
+                // Not a header after all; resynchronize on the next 0xAA.
+                ofs++;
+                skipped++;
+                continue;
+            }
+            if (len - ofs < 3 + frameLen)
+                break;
+            const uint8_t* f = buf + ofs;
+            out = {static_cast<uint16_t>((f[3] << 8) | f[4]), f + FrameHeaderSize, frameLen - 2, 3 + frameLen};
+            consumed = ofs + out.size;
+            return true;
+        }
+        consumed = ofs;
+        return false;
+    }
+
+    // ---- payloads ----
+
+    class Writer
+    {
+    public:
+        explicit Writer(uint8_t* buf) : _p(buf) {}
+
+        void u8(uint8_t v) { _p[_len++] = v; }
+        void u16(uint16_t v)
+        {
+            u8(static_cast<uint8_t>(v >> 8));
+            u8(static_cast<uint8_t>(v));
+        }
+        void u32(uint32_t v)
+        {
+            u16(static_cast<uint16_t>(v >> 16));
+            u16(static_cast<uint16_t>(v));
+        }
+        void bytes(const void* src, size_t n)
+        {
+            memcpy(_p + _len, src, n);
+            _len += n;
+        }
+
+        size_t size() const { return _len; }
+
+    private:
+        uint8_t* _p;
+        size_t _len = 0;
+    };
+
+    // Bounds-checked big-endian reader; any short read latches ok() false.
+    class Cursor
+    {
+    public:
+        Cursor(const uint8_t* p, size_t len) : _p(p), _len(len) {}
+
+        uint8_t u8() { return need(1) ? _p[_ofs++] : 0; }
+
+        uint16_t u16()
+        {
+            if (!need(2))
+                return 0;
+            uint16_t v = static_cast<uint16_t>((_p[_ofs] << 8) | _p[_ofs + 1]);
+            _ofs += 2;
+            return v;
+        }
+
+        uint32_t u32()
+        {
+            uint32_t hi = u16();
+            return (hi << 16) | u16();
+        }
+
+        const uint8_t* bytes(size_t n)
+        {
+            if (!need(n))
+                return nullptr;
+            const uint8_t* at = _p + _ofs;
+            _ofs += n;
+            return at;
+        }
+
+        bool ok() const { return _ok; }
+
+    private:
+        bool need(size_t n)
+        {
+            if (_ok && _len - _ofs >= n)
+                return true;
+            _ok = false;
+            return false;
+        }
+
+        const uint8_t* _p;
+        size_t _len;
+        size_t _ofs = 0;
+        bool _ok = true;
+    };
+
+    inline void writeWakeUpConfig(Writer& w, const serRfalWakeUpConfig& in)
+    {
+        WakeUp::Config cfg;
+        cfg.period = in.period;
+        cfg.irqTout = in.irqTout;
+        cfg.autoAvg = in.autoAvg;
+        cfg.skipCal = in.skipCal;
+        cfg.skipReCal = in.skipReCal;
+        cfg.delCal = in.delCal;
+        cfg.delRef = in.delRef;
+        cfg.measDur = in.measDur;
+        cfg.measFil = in.measFil;
+        const rfalWumMeasChannel* src[2] = {&in.I, &in.Q};
+        WakeUp::Channel* dst[2] = {&cfg.i, &cfg.q};
+        for (int k = 0; k < 2; ++k)
+        {
+            dst[k]->enabled = src[k]->enabled;
+            dst[k]->delta = src[k]->delta;
+            dst[k]->reference = src[k]->reference;
+            dst[k]->threshold = src[k]->threshold;
+            dst[k]->aaInclMeas = src[k]->aaInclMeas;
+            dst[k]->aaWeight = src[k]->aaWeight;
+        }
+        uint8_t buf[WakeUp::Config::WireSize];
+        cfg.write(buf);
+        w.bytes(buf, sizeof(buf));
+    }
+
+    // serRfalNfcDiscoverParam in struct order; enums as u32, bools as one byte, callbacks dropped.
+    inline size_t writeDiscoverParams(uint8_t* out, const serRfalNfcDiscoverParam& p)
+    {
+        static_assert(sizeof(p.nfcid3) == 10 && sizeof(p.GB) == 48, "serRfalNfcDiscoverParam layout");
+        Writer w(out);
+        w.u32(p.compMode);
+        w.u16(p.techs2Find);
+        w.u16(p.techs2Bail);
+        w.u16(p.totalDuration);
+        w.u8(p.devLimit);
+        w.u32(p.maxBR);
+        w.u32(p.nfcfBR);
+        w.bytes(p.nfcid3, sizeof(p.nfcid3));
+        w.bytes(p.GB, sizeof(p.GB));
+        w.u8(p.GBLen);
+        w.u32(p.ap2pBR);
+        w.u8(p.p2pNfcaPrio ? 1 : 0);
+        w.u32(p.isoDepFS);
+        w.u8(p.nfcDepLR);
+        w.u32(p.lmConfigPA.nfcidLen);
+        w.bytes(p.lmConfigPA.nfcid, sizeof(p.lmConfigPA.nfcid));
+        w.bytes(p.lmConfigPA.SENS_RES, sizeof(p.lmConfigPA.SENS_RES));
+        w.u8(p.lmConfigPA.SEL_RES);
+        w.bytes(p.lmConfigPF.SC, sizeof(p.lmConfigPF.SC));
+        w.bytes(p.lmConfigPF.SENSF_RES, sizeof(p.lmConfigPF.SENSF_RES));
+        w.u8(p.wakeupEnabled ? 1 : 0);
+        w.u8(p.wakeupConfigDefault ? 1 : 0);
+        writeWakeUpConfig(w, p.wakeupConfig);
+        w.u8(p.wakeupPollBefore ? 1 : 0);
+        w.u16(p.wakeupNPolls);
+        return w.size();
+    }
+
+    inline void readFlatDevice(const FlatNfcDevice::View& v, serFlatRfalNfcDevice& d)
+    {
+        static_assert(sizeof(d.nfcb.sensbRes) == FlatNfcDevice::fieldSize(FlatNfcDevice::Field::NfcbSensbRes),
+                      "rfalNfcbSensbRes is the wire SENSB_RES");
+        static_assert(sizeof(d.nfcf.sensfRes) == FlatNfcDevice::fieldSize(FlatNfcDevice::Field::NfcfSensfRes),
+                      "rfalNfcfSensfRes is the wire SENSF_RES");
+        memset(&d, 0, sizeof(d));
+        d.type = static_cast<rfalNfcDevType>(v.devType());
+
+        d.nfca.type = static_cast<rfalNfcaListenDeviceType>(v.nfcaType());
+        d.nfca.sensRes.anticollisionInfo = v.nfcaSensRes()[0];
+        d.nfca.sensRes.platformInfo = v.nfcaSensRes()[1];
+        d.nfca.selRes.sak = v.nfcaSelRes();
+        d.nfca.nfcId1Len = v.nfcaNfcId1Len();
+        memcpy(d.nfca.nfcId1, v.nfcaNfcId1(), v.nfcaNfcId1Len());
+        d.nfca.isSleep = v.nfcaIsSleep();
+
+        d.nfcb.sensbResLen = v.nfcbSensbResLen();
+        memcpy(&d.nfcb.sensbRes, v.at<FlatNfcDevice::Field::NfcbSensbRes>(), sizeof(d.nfcb.sensbRes));
+        d.nfcb.isSleep = v.nfcbIsSleep();
+
+        d.nfcf.sensfResLen = v.nfcfSensfResLen();
+        memcpy(&d.nfcf.sensfRes, v.at<FlatNfcDevice::Field::NfcfSensfRes>(), sizeof(d.nfcf.sensfRes));
+
+        d.nfcv.InvRes.RES_FLAG = v.nfcvResFlag();
+        d.nfcv.InvRes.DSFID = v.nfcvDsfid();
+        memcpy(d.nfcv.InvRes.UID, v.nfcvUid(), sizeof(d.nfcv.InvRes.UID));
+        memcpy(d.nfcv.InvRes.crc, v.at<FlatNfcDevice::Field::NfcvCrc>(), sizeof(d.nfcv.InvRes.crc));
+        d.nfcv.isSleep = v.nfcvIsSleep();
+
+        d.st25tb.chipID = v.st25tbChipId();
+        memcpy(d.st25tb.UID, v.st25tbUid(), sizeof(d.st25tb.UID));
+        d.st25tb.isDeselected = v.st25tbIsDeselected();
+    }
+
+    // ---- responses ----
+
+    // ret u16
+    inline bool decodeRet(const uint8_t* p, size_t len, ReturnCode& ret)
+    {
+        Cursor c(p, len);
+        ret = c.u16();
+        return c.ok();
+    }
+
+    // ret u16, value u8
+    inline bool decodeRetU8(const uint8_t* p, size_t len, ReturnCode& ret, uint8_t& value)
+    {
+        Cursor c(p, len);
+        ret = c.u16();
+        value = c.u8();
+        return c.ok();
+    }
+
+    // ret u16, length u16, bytes (rfalChipReadReg, rfalAnalogConfigListReadRaw)
+    inline bool decodeRetBytes(const uint8_t* p, size_t len, ReturnCode& ret, const uint8_t*& data, uint16_t& dataLen)
+    {
+        Cursor c(p, len);
+        ret = c.u16();
+        dataLen = c.u16();
+        data = c.bytes(dataLen);
+        return c.ok();
+    }
+
+    // versionLen u16, version, rfalVersion u32, fwVersion u32, serHash u32 (no ret)
+    struct VersionInfo
+    {
+        const uint8_t* text;
+        uint16_t textLen;
+        uint32_t rfalVersion;
+        uint32_t fwVersion;
+        uint32_t serHash;
+    };
+
+    inline bool decodeVersion(const uint8_t* p, size_t len, VersionInfo& v)
+    {
+        Cursor c(p, len);
+        v.textLen = c.u16();
+        v.text = c.bytes(v.textLen);
+        v.rfalVersion = c.u32();
+        v.fwVersion = c.u32();
+        v.serHash = c.u32();
+        return c.ok();
+    }
+
+    // ret u16, hashOriginal u32, hashFlash u32, hashRAM u32
+    struct ConfigHashes
+    {
+        ReturnCode ret;
+        uint32_t original;
+        uint32_t flash;
+        uint32_t ram;
+    };
+
+    inline bool decodeConfigHashes(const uint8_t* p, size_t len, ConfigHashes& h)
+    {
+        Cursor c(p, len);
+        h.ret = c.u16();
+        h.original = c.u32();
+        h.flash = c.u32();
+        h.ram = c.u32();
+        return c.ok();
+    }
+
+    // ret u16, devCnt u8, devCnt records. Decodes up to cap records into out (out may be null);
+    // count reports how many the device sent.
+    inline bool decodeDevices(const uint8_t* p, size_t len, ReturnCode& ret, serFlatRfalNfcDevice* out, size_t cap,
+                              size_t& count)
+    {
+        FlatNfcDevice::ListView devices;
+        if (!devices.parse(p, len))
+            return false;
+        count = 0;
+        FlatNfcDevice::View v;
+        while (devices.next(v))
+        {
+            if (out && count < cap)
+                readFlatDevice(v, out[count]);
+            count++;
+        }
+        ret = devices.ret();
+        return !devices.malformed();
+    }
+}
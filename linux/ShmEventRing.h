@@ -0,0 +1,353 @@
+#pragma once
+
+// Single-producer, multi-consumer event ring in POSIX shared memory (/dev/shm/<name>). The gateway
+// publishes presence and tag-data events; any number of local processes map the ring read-only and
+// follow it with their own cursor, so consumers never slow the producer or each other.
+//
+// Each 64-byte slot is a seqlock (as in arduino/PresenceSnapshot.h): the producer marks the slot
+// odd, writes the event, then stores the even sequence 2n+2 for event n. A consumer that finds any
+// other sequence was lapped, and counts the skipped events as lost. Header-only and free of the ST
+// headers, so consumers need nothing else.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+
+namespace ShmEventRing
+{
+    constexpr uint32_t Magic = 0x53323545; // "S25E"
+    constexpr uint16_t LayoutVersion = 2;
+    constexpr size_t MaxReaders = 64;
+    constexpr size_t ReaderNameLen = 48;
+
+    enum class Kind : uint8_t
+    {
+        Placed = 1,
+        Removed = 2,
+        TagData = 3, // activation bytes of a newly placed tag, right after its Placed
+    };
+
+    // Fixed binary layout, little-endian as mapped; 56 bytes.
+    struct Event
+    {
+        uint64_t timeNs;   // CLOCK_REALTIME
+        uint32_t dwellMs;  // Removed: first to last sighting
+        uint16_t reader;   // index into Header::readers
+        uint8_t kind;      // Kind
+        uint8_t tech;      // rfalNfcDevType: 0 A, 1 B, 2 F, 3 V, 4 ST25TB
+        uint8_t uidLen;    // 8 for NFC-V / ST25TB / NFC-F, 4 for NFC-B, 4/7/10 for NFC-A
+        uint8_t uid[10];   // wire byte order
+        uint8_t dataLen;   // TagData only
+        uint8_t data[28];
+    };
+    static_assert(sizeof(Event) == 56, "Event layout");
+
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> seq; // 2n+1 while event n is written, 2n+2 once it is complete
+        Event event;
+    };
+    static_assert(sizeof(Slot) == 64, "one cache line per slot");
+
+    struct Header
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t slotSize;
+        uint32_t capacity; // slots, a power of two
+        uint32_t producerPid;
+
+        alignas(64) std::atomic<uint64_t> writeIndex; // events published so far
+        std::atomic<uint32_t> wakeSeq;                // futex word, bumped on every publish
+        std::atomic<uint32_t> waiters; // consumers in Consumer::wait() (one killed there leaves a count:
+                                       // the producer then just wakes for nothing)
+
+        alignas(64) std::atomic<uint32_t> readerCount;
+        char readers[MaxReaders][ReaderNameLen]; // port paths; written before first use, never changed
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared atomics must be lock-free");
+
+    inline size_t mappingSize(uint32_t capacity)
+    {
+        return (sizeof(Header) + 63) / 64 * 64 + static_cast<size_t>(capacity) * sizeof(Slot);
+    }
+
+    inline Slot* slotsOf(const Header* h)
+    {
+        return reinterpret_cast<Slot*>(const_cast<char*>(reinterpret_cast<const char*>(h)) +
+                                       (sizeof(Header) + 63) / 64 * 64);
+    }
+
+    inline uint64_t realtimeNs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    class Producer
+    {
+    public:
+        Producer() = default;
+        ~Producer() { close(); }
+        Producer(const Producer&) = delete;
+        Producer& operator=(const Producer&) = delete;
+
+        // Creates (or replaces) /dev/shm/<name> with capacity rounded up to a power of two.
+        bool create(const char* name, uint32_t capacity, int& error)
+        {
+            uint32_t cap = 1;
+            while (cap < capacity && cap < (1u << 24))
+                cap <<= 1;
+            std::string shmName = name[0] == '/' ? name : std::string("/") + name;
+            shm_unlink(shmName.c_str());
+            int fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+            if (fd < 0)
+            {
+                error = errno;
+                return false;
+            }
+            size_t size = mappingSize(cap);
+            void* p = MAP_FAILED;
+            if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+                p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            error = errno;
+            ::close(fd);
+            if (p == MAP_FAILED)
+            {
+                shm_unlink(shmName.c_str());
+                return false;
+            }
+
+            // ftruncate zero-fills: every slot sequence starts at 0, which matches no event.
+            _h = static_cast<Header*>(p);
+            _h->version = LayoutVersion;
+            _h->slotSize = sizeof(Slot);
+            _h->capacity = cap;
+            _h->producerPid = static_cast<uint32_t>(getpid());
+            std::atomic_thread_fence(std::memory_order_release);
+            reinterpret_cast<std::atomic<uint32_t>*>(&_h->magic)->store(Magic, std::memory_order_release);
+            _slots = slotsOf(_h);
+            _mask = cap - 1;
+            _size = size;
+            _name = shmName;
+            _next = 0;
+            return true;
+        }
+
+        void close()
+        {
+            if (!_h)
+                return;
+            munmap(_h, _size);
+            shm_unlink(_name.c_str());
+            _h = nullptr;
+        }
+
+        // Index of a reader name in the header table, registering it on first use; the last entry
+        // is shared once the table is full.
+        uint16_t readerIndex(const char* name)
+        {
+            uint32_t n = _h->readerCount.load(std::memory_order_relaxed);
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                if (strncmp(_h->readers[i], name, ReaderNameLen - 1) == 0)
+                    return static_cast<uint16_t>(i);
+            }
+            if (n == MaxReaders)
+                return MaxReaders - 1;
+            strncpy(_h->readers[n], name, ReaderNameLen - 1);
+            _h->readerCount.store(n + 1, std::memory_order_release);
+            return static_cast<uint16_t>(n);
+        }
+
+        void publish(const Event& e)
+        {
+            uint64_t n = _next++;
+            Slot& s = _slots[n & _mask];
+            s.seq.store(2 * n + 1, std::memory_order_relaxed); // odd: write in progress
+            std::atomic_thread_fence(std::memory_order_release);
+            memcpy(&s.event, &e, sizeof(e));
+            s.seq.store(2 * n + 2, std::memory_order_release);
+            _h->writeIndex.store(n + 1, std::memory_order_release);
+
+            // The wake is a syscall, so it is made only for consumers blocked in Consumer::wait().
+            // Sequentially consistent with the waiter's increment and its wakeSeq load: either this
+            // sees the waiter, or the waiter sees the new wakeSeq and does not sleep.
+            _h->wakeSeq.fetch_add(1, std::memory_order_seq_cst);
+            if (_h->waiters.load(std::memory_order_seq_cst) != 0)
+                syscall(SYS_futex, &_h->wakeSeq, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+        }
+
+        bool valid() const { return _h != nullptr; }
+        uint64_t published() const { return _next; }
+
+    private:
+        Header* _h = nullptr;
+        Slot* _slots = nullptr;
+        uint64_t _mask = 0;
+        size_t _size = 0;
+        std::string _name;
+        uint64_t _next = 0;
+    };
+
+    class Consumer
+    {
+    public:
+        Consumer() = default;
+        ~Consumer() { close(); }
+        Consumer(const Consumer&) = delete;
+        Consumer& operator=(const Consumer&) = delete;
+
+        // Maps /dev/shm/<name>, replacing any ring already open. The cursor starts at the next
+        // event, or with fromOldest at the oldest event still in the ring. The mapping is writable
+        // when the ring's permissions allow, for Header::waiters only; a consumer of another user
+        // maps it read-only and its wait() polls instead of being woken.
+        bool open(const char* name, int& error, bool fromOldest = false)
+        {
+            close();
+            std::string shmName = name[0] == '/' ? name : std::string("/") + name;
+            int fd = shm_open(shmName.c_str(), O_RDWR | O_CLOEXEC, 0);
+            _writable = fd >= 0;
+            if (fd < 0 && errno == EACCES)
+                fd = shm_open(shmName.c_str(), O_RDONLY | O_CLOEXEC, 0);
+            if (fd < 0)
+            {
+                error = errno;
+                return false;
+            }
+            Header probe;
+            if (pread(fd, &probe, sizeof(probe), 0) != static_cast<ssize_t>(sizeof(probe)) || probe.magic != Magic ||
+                probe.version != LayoutVersion || probe.slotSize != sizeof(Slot) || probe.capacity == 0 ||
+                (probe.capacity & (probe.capacity - 1)) != 0)
+            {
+                error = EPROTO;
+                ::close(fd);
+                return false;
+            }
+            size_t size = mappingSize(probe.capacity);
+            void* p = mmap(nullptr, size, _writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+            error = errno;
+            ::close(fd);
+            if (p == MAP_FAILED)
+                return false;
+
+            _h = static_cast<Header*>(p);
+            _slots = slotsOf(_h);
+            _capacity = _h->capacity;
+            _size = size;
+            uint64_t w = _h->writeIndex.load(std::memory_order_acquire);
+            _cursor = fromOldest && w > _capacity ? w - _capacity : (fromOldest ? 0 : w);
+            _lost = 0;
+            return true;
+        }
+
+        void close()
+        {
+            if (!_h)
+                return;
+            munmap(_h, _size);
+            _h = nullptr;
+        }
+
+        // Copies the next event; false when the consumer is caught up.
+        bool next(Event& out)
+        {
+            for (;;)
+            {
+                uint64_t w = _h->writeIndex.load(std::memory_order_acquire);
+                if (_cursor >= w)
+                    return false;
+                if (w - _cursor > _capacity)
+                {
+                    _lost += w - _capacity - _cursor;
+                    _cursor = w - _capacity;
+                }
+                const Slot& s = _slots[_cursor & (_capacity - 1)];
+                uint64_t expect = 2 * _cursor + 2;
+                if (s.seq.load(std::memory_order_acquire) == expect)
+                {
+                    memcpy(&out, &s.event, sizeof(out));
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (s.seq.load(std::memory_order_relaxed) == expect)
+                    {
+                        _cursor++;
+                        return true;
+                    }
+                }
+                // The producer lapped this slot while we looked.
+                _lost++;
+                _cursor++;
+            }
+        }
+
+        // Blocks until an event is available or timeoutMs passes (-1: forever). True if one is.
+        // A read-only consumer is never woken; it re-checks every PollMs instead.
+        bool wait(int timeoutMs)
+        {
+            if (!_writable)
+            {
+                for (int waited = 0; timeoutMs < 0 || waited < timeoutMs; waited += PollMs)
+                {
+                    if (_cursor < _h->writeIndex.load(std::memory_order_acquire))
+                        return true;
+                    timespec ts = {0, PollMs * 1000000L};
+                    nanosleep(&ts, nullptr);
+                }
+                return _cursor < _h->writeIndex.load(std::memory_order_acquire);
+            }
+            _h->waiters.fetch_add(1, std::memory_order_seq_cst);
+            uint32_t seq = _h->wakeSeq.load(std::memory_order_seq_cst);
+            if (_cursor >= _h->writeIndex.load(std::memory_order_acquire))
+            {
+                timespec ts = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+                syscall(SYS_futex, &_h->wakeSeq, FUTEX_WAIT, seq, timeoutMs < 0 ? nullptr : &ts, nullptr, 0);
+            }
+            _h->waiters.fetch_sub(1, std::memory_order_relaxed);
+            return _cursor < _h->writeIndex.load(std::memory_order_acquire);
+        }
+
+        // Name of Event::reader; empty for an index not registered (yet).
+        std::string readerName(uint16_t index) const
+        {
+            if (index >= _h->readerCount.load(std::memory_order_acquire))
+                return std::string();
+            return std::string(_h->readers[index], strnlen(_h->readers[index], ReaderNameLen));
+        }
+
+        // False once the producer has exited. Its ring is unlinked then, and a restarted producer
+        // creates a new one, so a consumer reopens by name.
+        bool producerAlive() const
+        {
+            return kill(static_cast<pid_t>(_h->producerPid), 0) == 0 || errno == EPERM;
+        }
+
+        uint64_t lost() const { return _lost; }
+        uint64_t cursor() const { return _cursor; }
+        uint32_t producerPid() const { return _h->producerPid; }
+        bool valid() const { return _h != nullptr; }
+
+    private:
+        static constexpr int PollMs = 10;
+
+        Header* _h = nullptr;
+        const Slot* _slots = nullptr;
+        bool _writable = false;
+        uint64_t _capacity = 0;
+        size_t _size = 0;
+        uint64_t _cursor = 0;
+        uint64_t _lost = 0;
+    };
+}
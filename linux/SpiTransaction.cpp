@@ -0,0 +1,146 @@
+// Raw ST25R200 SPI transactions; see SpiTransaction.h.
+
+#include "SpiTransaction.h"
+
+#include "SerRfalWire.h"
+
+using namespace SerRfalWire;
+
+namespace
+{
+    constexpr size_t RegCount = SpiRegMask + 1;
+    constexpr size_t SelectLenSize = 2; // u16 length in front of each SysSpiTxRx payload
+}
+
+bool SpiTransaction::extends(Mode mode, uint8_t reg, uint8_t len) const
+{
+    if (_selects.empty() || mode == Mode::Command)
+        return false;
+    const Select& last = _selects.back();
+    size_t bytes = _tx.size() - last.ofs - SelectLenSize;
+    return last.mode == mode && last.next == reg && bytes + len <= SpiMaxSelect;
+}
+
+void SpiTransaction::open(Mode mode, uint8_t first)
+{
+    _selects.push_back({mode, 0, _tx.size()});
+    _tx.insert(_tx.end(), SelectLenSize, 0); // set by run()
+    _tx.push_back(first);
+}
+
+void SpiTransaction::append(const uint8_t* bytes, size_t len)
+{
+    if (bytes)
+        _tx.insert(_tx.end(), bytes, bytes + len);
+    else
+        _tx.insert(_tx.end(), len, 0);
+}
+
+SpiTransaction::Read SpiTransaction::readReg(uint8_t reg, uint8_t len)
+{
+    Read read = {_reads.size()};
+    _operations++;
+    if (len == 0 || reg + len > RegCount)
+    {
+        _valid = false;
+        _reads.push_back({0, 0});
+        return read;
+    }
+    if (!extends(Mode::Read, reg, len))
+        open(Mode::Read, static_cast<uint8_t>(SpiRegRead | reg));
+    _reads.push_back({_tx.size(), len});
+    append(nullptr, len); // clocked out while the register data comes in
+    _selects.back().next = static_cast<uint8_t>(reg + len);
+    return read;
+}
+
+void SpiTransaction::writeReg(uint8_t reg, const uint8_t* values, uint8_t len)
+{
+    _operations++;
+    if (!values || len == 0 || reg + len > RegCount)
+    {
+        _valid = false;
+        return;
+    }
+    if (!extends(Mode::Write, reg, len))
+        open(Mode::Write, static_cast<uint8_t>(SpiRegWrite | reg));
+    append(values, len);
+    _selects.back().next = static_cast<uint8_t>(reg + len);
+}
+
+void SpiTransaction::command(uint8_t cmd)
+{
+    _operations++;
+    open(Mode::Command, cmd);
+}
+
+void SpiTransaction::clear()
+{
+    _tx.clear();
+    _rx.clear();
+    _selects.clear();
+    _reads.clear();
+    _operations = 0;
+    _valid = true;
+}
+
+bool SpiTransaction::run(ReturnCode* ret)
+{
+    if (ret)
+        *ret = RFAL_ERR_NONE;
+    if (!_valid)
+        return false;
+    if (_selects.empty())
+        return true;
+
+    std::vector<serBatchItem> items(_selects.size());
+    for (size_t i = 0; i < _selects.size(); ++i)
+    {
+        size_t ofs = _selects[i].ofs;
+        size_t end = i + 1 < _selects.size() ? _selects[i + 1].ofs : _tx.size();
+        size_t len = end - ofs - SelectLenSize;
+        _tx[ofs] = static_cast<uint8_t>(len >> 8);
+        _tx[ofs + 1] = static_cast<uint8_t>(len);
+        items[i].cmdId = SysSpiTxRxReq;
+        items[i].payload = _tx.data() + ofs;
+        items[i].payloadLen = static_cast<uint16_t>(SelectLenSize + len);
+    }
+    bool ok = serExecBatch(items.data(), items.size());
+
+    _rx.assign(_tx.size(), 0);
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        if (!items[i].ok)
+            return false;
+        // An error answer is the return code alone.
+        ReturnCode r = RFAL_ERR_NONE;
+        const uint8_t* rx;
+        uint16_t rxLen;
+        if (!decodeRet(items[i].rsp, items[i].rspLen, r))
+            return false;
+        if (r != RFAL_ERR_NONE)
+        {
+            if (ret)
+                *ret = r;
+            return true;
+        }
+        size_t len = items[i].payloadLen - SelectLenSize;
+        if (!decodeRetBytes(items[i].rsp, items[i].rspLen, r, rx, rxLen) || rxLen != len)
+            return false;
+        memcpy(_rx.data() + _selects[i].ofs + SelectLenSize, rx, len);
+    }
+    return ok;
+}
+
+uint8_t SpiTransaction::bits(Read read, uint8_t mask, uint8_t index) const
+{
+    if (mask == 0)
+        return 0;
+    uint8_t v = value(read, index) & mask;
+    while (!(mask & 1))
+    {
+        mask >>= 1;
+        v >>= 1;
+    }
+    return v;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "SerRfalHost.h"
+
+// Raw ST25R200 SPI transaction over SysSpiTxRx: queue register reads, register writes and direct
+// commands, then run() sends them all at once and the reads come back as typed values.
+//
+// The firmware clocks one SysSpiTxRx payload out in one chip select, and the chip takes one register
+// burst or one direct command per chip select, so the operations compile to one SysSpiTxRx request
+// per chip select. Accesses to consecutive registers in the same direction merge into one
+// auto-increment burst. All requests go in one serExecBatch: written back to back as the rx credit
+// allows, answered in order, with no round trip per operation. The chip sees them in queue order.
+//
+// Direct commands that take time (measurements, calibrations) are not waited for: the next chip
+// select follows after the firmware's turnaround. Read the IRQ or display registers to check.
+//
+//   SpiTransaction t;
+//   auto id = t.readReg(0x3F);
+//   t.writeReg(0x02, 0x81);
+//   t.command(cmd);
+//   auto display = t.readReg(0x30, 2);
+//   if (t.run(&ret) && ret == RFAL_ERR_NONE)
+//       printf("%02X %u\n", t.value(id), t.bits(display, 0xF0, 1));
+class SpiTransaction
+{
+public:
+    // Result of a queued read, valid after a successful run().
+    struct Read
+    {
+        size_t slot;
+    };
+
+    Read readReg(uint8_t reg, uint8_t len = 1);
+    void writeReg(uint8_t reg, uint8_t value) { writeReg(reg, &value, 1); }
+    void writeReg(uint8_t reg, const uint8_t* values, uint8_t len);
+    void command(uint8_t cmd);
+    void clear();
+
+    // False when the transaction is invalid (a register past 0x3F) or the link failed; ret is the
+    // first error the firmware returned, RFAL_ERR_NONE when every chip select ran.
+    bool run(ReturnCode* ret = nullptr);
+
+    uint8_t value(Read read, uint8_t index = 0) const { return _rx[_reads[read.slot].ofs + index]; }
+    const uint8_t* values(Read read) const { return _rx.data() + _reads[read.slot].ofs; }
+    // The field selected by mask, shifted down to bit 0.
+    uint8_t bits(Read read, uint8_t mask, uint8_t index = 0) const;
+
+    // False once an operation addressed a register past 0x3F or had no data.
+    bool valid() const { return _valid; }
+    size_t operations() const { return _operations; }
+    size_t chipSelects() const { return _selects.size(); }
+
+private:
+    enum class Mode : uint8_t
+    {
+        Write,
+        Read,
+        Command,
+    };
+
+    struct Select
+    {
+        Mode mode;
+        uint8_t next; // register the burst continues at
+        size_t ofs;   // SysSpiTxRx payload in _tx: u16 length, bytes
+    };
+
+    struct Slot
+    {
+        size_t ofs; // first byte in _rx
+        uint8_t len;
+    };
+
+    bool extends(Mode mode, uint8_t reg, uint8_t len) const;
+    void open(Mode mode, uint8_t first);
+    void append(const uint8_t* bytes, size_t len);
+
+    std::vector<uint8_t> _tx;
+    std::vector<uint8_t> _rx; // bytes clocked in, laid out like _tx
+    std::vector<Select> _selects;
+    std::vector<Slot> _reads;
+    size_t _operations = 0;
+    bool _valid = true;
+};
@@ -0,0 +1,224 @@
+// Drives several readers from one thread through SerRfalAsync: one coroutine per port runs the
+// console's discovery loop (initialize, discover, poll the state, read the devices, deactivate),
+// or a back-to-back SysPing flood with -p, and prints per-port and total exchanges per second.
+//
+//   st25-async-bench [-d ms] [-i pollMs] [-t timeoutMs] [-c rxCredit] [-p [-q depth]] port...
+//
+// -d run time (default 3000), -i delay between rfalNfcGetState polls (default 10; the console
+// sleeps 100), -t per-request deadline (default 200), -c request bytes allowed on the wire per port
+// (default one maximum frame, 0 for one request at a time), -q pings kept outstanding per port
+// (default 1).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "SerRfalAsync.h"
+
+using namespace SerRfalAsync;
+
+namespace
+{
+    struct Options
+    {
+        uint32_t durationMs = 3000;
+        uint32_t pollMs = 10;
+        uint32_t timeoutMs = 200;
+        bool ping = false;
+        unsigned depth = 1;
+        long credit = -1; // port default
+    };
+
+    struct Reader
+    {
+        explicit Reader(Reactor& reactor) : port(reactor) {}
+
+        Port port;
+        uint32_t cards = 0;
+        uint32_t errors = 0;
+        Status lastError = Status::Ok;
+    };
+
+    struct Bench
+    {
+        Reactor reactor;
+        Options opt;
+        bool stopping = false;
+        int active = 0;
+    };
+
+    void usage()
+    {
+        fprintf(stderr, "usage: st25-async-bench [-d ms] [-i pollMs] [-t timeoutMs] [-c rxCredit] [-p [-q depth]] "
+                        "port...\n");
+    }
+
+    // Counts a failed request; true when the coroutine should stop.
+    template <typename T>
+    bool failed(Reader& r, const Result<T>& res)
+    {
+        if (res.ok())
+            return false;
+        r.errors++;
+        r.lastError = res.status;
+        return res.status == Status::PortError || res.status == Status::Closed;
+    }
+
+    Task pingLoop(Bench& b, Reader& r)
+    {
+        b.active++;
+        while (!b.stopping)
+        {
+            Result<None> ping = co_await r.port.sysPing().timeout(b.opt.timeoutMs);
+            if (failed(r, ping))
+                break;
+        }
+        if (--b.active == 0)
+            b.reactor.stop();
+    }
+
+    Task discoveryLoop(Bench& b, Reader& r)
+    {
+        b.active++;
+        Port& port = r.port;
+        uint32_t timeout = b.opt.timeoutMs;
+
+        serRfalNfcDiscoverParam discParam;
+        serRfalNfcDefaultDiscParams(&discParam);
+        discParam.devLimit = 1;
+        discParam.totalDuration = 200;
+        discParam.techs2Find = RFAL_NFC_POLL_TECH_A | RFAL_NFC_POLL_TECH_B | RFAL_NFC_POLL_TECH_V |
+                               RFAL_NFC_POLL_TECH_ST25TB;
+        discParam.wakeupEnabled = false;
+        discParam.wakeupConfigDefault = false;
+        discParam.wakeupNPolls = 0;
+
+        // Results are awaited into locals: GCC 12 mis-handles co_await inside a call argument.
+        Result<ReturnCode> ret = co_await port.rfalInitialize().timeout(timeout);
+        bool ok = !failed(r, ret);
+        if (ok)
+        {
+            ret = co_await port.rfalNfcInitialize().timeout(timeout);
+            ok = !failed(r, ret);
+        }
+        while (ok && !b.stopping)
+        {
+            ret = co_await port.rfalNfcDiscover(discParam).timeout(timeout);
+            if (failed(r, ret))
+                break;
+            for (;;)
+            {
+                Result<rfalNfcState> state = co_await port.rfalNfcGetState().timeout(timeout);
+                if (failed(r, state))
+                {
+                    ok = state.status != Status::PortError && state.status != Status::Closed;
+                    break;
+                }
+                if (state.value == RFAL_NFC_STATE_ACTIVATED || state.value == RFAL_NFC_STATE_POLL_SELECT)
+                {
+                    Result<Devices> devices = co_await port.rfalNfcGetDevicesFound().timeout(timeout);
+                    if (!failed(r, devices) && devices.value.ret == RFAL_ERR_NONE)
+                        r.cards += static_cast<uint32_t>(devices.value.list.size());
+                    break;
+                }
+                if (b.stopping)
+                    break;
+                co_await delay(b.reactor, b.opt.pollMs);
+            }
+            if (!ok)
+                break;
+            ret = co_await port.rfalNfcDeactivate(RFAL_NFC_DEACTIVATE_IDLE).timeout(timeout);
+            if (failed(r, ret))
+                break;
+        }
+        if (--b.active == 0)
+            b.reactor.stop();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Bench b;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            b.opt.durationMs = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+            b.opt.pollMs = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            b.opt.timeoutMs = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+            b.opt.credit = atol(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0)
+            b.opt.ping = true;
+        else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc)
+            b.opt.depth = static_cast<unsigned>(atoi(argv[++i]));
+        else if (argv[i][0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty() || b.opt.depth == 0 || !b.reactor.valid())
+    {
+        usage();
+        return 2;
+    }
+
+    std::vector<std::unique_ptr<Reader>> readers;
+    for (const char* path : paths)
+    {
+        auto r = std::make_unique<Reader>(b.reactor);
+        int32_t error = 0;
+        if (!r->port.open(path, error))
+        {
+            fprintf(stderr, "%s: %s\n", path, strerror(error));
+            continue;
+        }
+        if (b.opt.credit >= 0)
+            r->port.setRxCredit(static_cast<size_t>(b.opt.credit));
+        Port* port = &r->port;
+        port->onClosed = [port](int error) { fprintf(stderr, "%s: %s\n", port->path().c_str(), strerror(error)); };
+        readers.push_back(std::move(r));
+    }
+    if (readers.empty())
+        return 1;
+
+    uint64_t t0 = Reactor::nowUs();
+    for (auto& r : readers)
+    {
+        if (b.opt.ping)
+        {
+            // Each loop keeps one ping outstanding; the port writes them back to back within its
+            // credit.
+            for (unsigned k = 0; k < b.opt.depth; ++k)
+                pingLoop(b, *r);
+        }
+        else
+            discoveryLoop(b, *r);
+    }
+    b.reactor.after(b.opt.durationMs, [&b] { b.stopping = true; });
+    if (b.active > 0)
+        b.reactor.run();
+    double seconds = static_cast<double>(Reactor::nowUs() - t0) / 1e6;
+
+    uint64_t total = 0;
+    for (auto& r : readers)
+    {
+        serLinkStats s;
+        r->port.stats(s);
+        total += s.exchanges;
+        printf("%-20s frames/s=%.0f cards=%u errors=%u%s%s rttUs mean=%u max=%u skipped=%u\n",
+               r->port.path().c_str(), s.exchanges / seconds, r->cards, r->errors, r->errors ? " last=" : "",
+               r->errors ? statusName(r->lastError) : "", s.exchanges ? static_cast<unsigned>(s.rttSumUs / s.exchanges) : 0,
+               s.rttMaxUs, s.skipped);
+    }
+    printf("total readers=%zu frames/s=%.0f\n", readers.size(), total / seconds);
+    return 0;
+}
@@ -0,0 +1,238 @@
+// Linux port of ST25R200_Eval_GUI/Exe_Demos/ST25R200_Console.cpp on SerRfalHost: the same
+// serComOpen / serExec* call sequence (initialize, discover, poll the state, read the devices
+// found, deactivate, repeat), so it checks the host library against a reader or st25-pty-sim.
+//
+//   st25-console [/dev/ttyACM0] [-n cards] [-q] [-r]
+//
+// -n stops after that many cards and prints the link RTT; -q disables the serRfal trace; -r first
+// prints a chip snapshot (registers, RFO, amplitude, phase) read in one serExecBatch.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "SerRfalHost.h"
+#include "SerRfalWire.h"
+
+namespace
+{
+    constexpr int MaxNbOfCards = 1;
+
+    enum
+    {
+        PollingDisabled = 0,
+        PollingNotInit,
+        PollingDeactivated,
+        PollingTechsDetect,
+        PollingWakeup,
+        PollingWakeupEnd,
+        PollingCardFound,
+    };
+
+    void sleepMs(unsigned ms)
+    {
+        usleep(ms * 1000);
+    }
+
+    const char* hex2Str(const uint8_t* data, size_t dataLen, bool invert)
+    {
+        static char hexStr[2 * 128 + 1];
+        static const char* hex = "0123456789ABCDEF";
+        if (dataLen > 128)
+            dataLen = 128;
+        for (size_t i = 0; i < dataLen; ++i)
+        {
+            uint8_t b = data[invert ? dataLen - 1 - i : i];
+            hexStr[2 * i] = hex[b >> 4];
+            hexStr[2 * i + 1] = hex[b & 0x0F];
+        }
+        hexStr[2 * dataLen] = '\0';
+        return hexStr;
+    }
+
+    void printDevice(const serFlatRfalNfcDevice& dev)
+    {
+        switch (dev.type)
+        {
+            case RFAL_NFC_LISTEN_TYPE_NFCA:
+                printf("\nType A: Uid=%s\n", hex2Str(dev.nfca.nfcId1, dev.nfca.nfcId1Len, false));
+                break;
+            case RFAL_NFC_LISTEN_TYPE_NFCB:
+                printf("\nType B: Uid=%s\n", hex2Str(dev.nfcb.sensbRes.nfcid0, RFAL_NFCB_NFCID0_LEN, false));
+                break;
+            case RFAL_NFC_LISTEN_TYPE_ST25TB:
+                printf("\nType ST25TB: Uid=%s\n", hex2Str(dev.st25tb.UID, RFAL_ST25TB_UID_LEN, true));
+                break;
+            case RFAL_NFC_LISTEN_TYPE_NFCV:
+                printf("\nType V: Uid=%s\n", hex2Str(dev.nfcv.InvRes.UID, 8, true));
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Register map and antenna readings as one batch of independent requests: one write while they
+    // fit the rx credit, instead of an exchange per call.
+    void printSnapshot()
+    {
+        constexpr uint8_t RegBlock = 16;
+        constexpr int RegBlocks = 4;
+        uint8_t regReq[RegBlocks][3];
+        serBatchItem items[RegBlocks + 3] = {};
+        for (int i = 0; i < RegBlocks; ++i)
+        {
+            regReq[i][0] = 0;
+            regReq[i][1] = static_cast<uint8_t>(i * RegBlock);
+            regReq[i][2] = RegBlock;
+            items[i].cmdId = SerRfalWire::RfalChipReadRegReq;
+            items[i].payload = regReq[i];
+            items[i].payloadLen = sizeof(regReq[i]);
+        }
+        items[RegBlocks].cmdId = SerRfalWire::RfalChipGetRFOReq;
+        items[RegBlocks + 1].cmdId = SerRfalWire::RfalChipMeasureAmplitudeReq;
+        items[RegBlocks + 2].cmdId = SerRfalWire::RfalChipMeasurePhaseReq;
+        serExecBatch(items, RegBlocks + 3);
+
+        for (int i = 0; i < RegBlocks; ++i)
+        {
+            ReturnCode ret;
+            const uint8_t* data;
+            uint16_t dataLen;
+            if (items[i].ok && SerRfalWire::decodeRetBytes(items[i].rsp, items[i].rspLen, ret, data, dataLen) &&
+                ret == RFAL_ERR_NONE)
+                printf("reg %02X: %s\n", i * RegBlock, hex2Str(data, dataLen, false));
+        }
+        static const char* names[] = {"rfo", "amplitude", "phase"};
+        for (int i = 0; i < 3; ++i)
+        {
+            ReturnCode ret;
+            uint8_t value;
+            const serBatchItem& item = items[RegBlocks + i];
+            if (item.ok && SerRfalWire::decodeRetU8(item.rsp, item.rspLen, ret, value) && ret == RFAL_ERR_NONE)
+                printf("%s %u\n", names[i], value);
+        }
+    }
+
+    void printLinkStats()
+    {
+        serLinkStats s;
+        serGetLinkStats(s);
+        printf("link exchanges=%u failures=%u skipped=%u rttUs min=%u mean=%u max=%u\n", s.exchanges, s.failures,
+               s.skipped, s.rttMinUs, s.exchanges ? static_cast<unsigned>(s.rttSumUs / s.exchanges) : 0, s.rttMaxUs);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* comPort = "/dev/ttyACM0";
+    int maxCards = 0;
+    bool quiet = false;
+    bool snapshot = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            maxCards = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-q") == 0)
+            quiet = true;
+        else if (strcmp(argv[i], "-r") == 0)
+            snapshot = true;
+        else
+            comPort = argv[i];
+    }
+
+    serSetTraceFunction(printf);
+    serSetTraceMode(quiet ? 0 : SerTrace_ConsoleDefault);
+
+    int32_t error = 0;
+    ReturnCode ret = RFAL_ERR_NONE;
+    printf("Test serial on Comport='%s'\n", comPort);
+    if (!serComOpen(comPort, error))
+    {
+        printf("Error in opening/configuring serial port %s (%s)\n", comPort, strerror(error));
+        printf("\nCompatible port(s):");
+        for (const auto& port : serComEnumeratePorts())
+            printf("\n%s", port.c_str());
+        printf("\n");
+        return -1;
+    }
+    printf("opening/configuring serial port successful\n");
+
+    serExecRfalInitialize(&ret);
+    if (snapshot)
+        printSnapshot();
+
+    int pollingState = PollingNotInit;
+    int cards = 0;
+    do
+    {
+        if (pollingState == PollingNotInit || pollingState == PollingDeactivated)
+        {
+            serRfalNfcDiscoverParam discParam;
+            serRfalNfcDefaultDiscParams(&discParam);
+            discParam.devLimit = MaxNbOfCards;
+            discParam.totalDuration = 200;
+            discParam.techs2Find = RFAL_NFC_POLL_TECH_A | RFAL_NFC_POLL_TECH_B | RFAL_NFC_POLL_TECH_V |
+                                   RFAL_NFC_POLL_TECH_ST25TB;
+            discParam.wakeupConfigDefault = false;
+            discParam.wakeupEnabled = false;
+            discParam.wakeupNPolls = 0;
+
+            if (pollingState == PollingNotInit)
+                serExecRfalNfcInitialize(&ret);
+
+            serExecRfalNfcDiscover(&ret, &discParam);
+            if (ret == RFAL_ERR_NONE)
+                pollingState = PollingTechsDetect;
+            printf("Activate Polling\n");
+        }
+        if (pollingState == PollingTechsDetect || pollingState == PollingWakeupEnd)
+        {
+            const int maxLoop = 20;
+            int loop = 0;
+            rfalNfcState state;
+            do
+            {
+                if (loop != 0)
+                    sleepMs(100);
+                if (serExecRfalNfcGetState(&state))
+                {
+                    if (state == RFAL_NFC_STATE_WAKEUP_MODE)
+                    {
+                        pollingState = PollingWakeup;
+                        break;
+                    }
+                    if (state == RFAL_NFC_STATE_ACTIVATED || state == RFAL_NFC_STATE_POLL_SELECT)
+                    {
+                        pollingState = PollingCardFound;
+                        serFlatRfalNfcDevice devList[MaxNbOfCards];
+                        uint8_t devCnt = MaxNbOfCards;
+                        serExecRfalNfcGetDevicesFound(&ret, devList, &devCnt);
+                        if (ret == RFAL_ERR_NONE)
+                        {
+                            for (int index = 0; index < devCnt; index++)
+                                printDevice(devList[index]);
+                            cards += devCnt;
+                        }
+                        if (maxCards > 0 && cards >= maxCards)
+                        {
+                            serExecRfalNfcDeactivate(&ret, RFAL_NFC_DEACTIVATE_IDLE);
+                            pollingState = PollingDisabled;
+                            break;
+                        }
+                        sleepMs(1000);
+                        // Deactivate before making a new discover
+                        serExecRfalNfcDeactivate(&ret, RFAL_NFC_DEACTIVATE_IDLE);
+                        pollingState = PollingDeactivated;
+                        break;
+                    }
+                }
+                ++loop;
+            } while (maxLoop > loop);
+        }
+    } while (pollingState != PollingDisabled);
+
+    printLinkStats();
+    serComClose(error);
+    return 0;
+}
@@ -0,0 +1,358 @@
+// Multi-reader gateway: every ST25R200 reader on the host (or the ports given) on one epoll loop,
+// each running the presence pipeline of GatewayReader. Events are published as JSON lines on
+// stdout and on a Unix socket, and as binary records in a /dev/shm ring. Readers are opened as
+// they are plugged in and dropped when they go away; a per-reader throughput report goes to stderr.
+// Follow-up jobs for placed tags run on a work-stealing pool, off the loop.
+//
+//   st25-gateway [-p pattern]... [-s socket] [-m shmName] [-n shmSlots] [-x name=command]...
+//                [-j jobTimeoutMs] [-w workers] [-r reportSec] [-i pollMs] [-a absentMs] [-t timeoutMs] [-q]
+//                [port...]
+//
+// -p globs to watch (default /dev/ttyACM* and /dev/ttyUSB*), -s event socket (default
+// /tmp/st25-gateway.sock, empty to disable), -m shared-memory ring (default st25-gateway, i.e.
+// /dev/shm/st25-gateway; empty to disable) of -n events (default 4096), -x follow-up command run
+// with the UID and port path as $1 and $2 for every placed tag and killed after -j ms (default
+// 10000), on -w pool threads (default one per core), -r report interval (default 10, 0 disables),
+// -q no events on stdout. Ports given explicitly are opened even if they match no pattern.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GatewayFollowUp.h"
+#include "GatewayReader.h"
+#include "HotPlug.h"
+
+using namespace Gateway;
+
+namespace
+{
+    constexpr uint32_t RetryMs = 1000;
+    constexpr int OpenRetries = 5; // udev sets a new node's permissions shortly after creating it
+
+    struct Options
+    {
+        std::vector<std::string> patterns;
+        std::vector<std::string> ports;
+        std::string socketPath = "/tmp/st25-gateway.sock";
+        std::string shmName = "st25-gateway";
+        uint32_t shmSlots = 4096;
+        std::vector<std::pair<std::string, std::string>> jobs; // name, shell command
+        uint32_t jobTimeoutMs = DefaultJobTimeoutMs;
+        unsigned workers = 0;
+        uint32_t reportSec = 10;
+        bool quiet = false;
+        ReaderOptions reader;
+    };
+
+    Reactor* gReactor = nullptr;
+
+    void onSignal(int)
+    {
+        if (gReactor)
+            gReactor->stop();
+    }
+
+    void usage()
+    {
+        fprintf(stderr, "usage: st25-gateway [-p pattern]... [-s socket] [-m shmName] [-n shmSlots]\n"
+                        "                    [-x name=command]... [-j jobTimeoutMs] [-w workers] [-r reportSec]\n"
+                        "                    [-i pollMs] [-a absentMs] [-t timeoutMs] [-q] [port...]\n");
+    }
+
+    class Daemon
+    {
+    public:
+        Daemon(Reactor& reactor, const Options& opt, EventSink& events)
+            : _reactor(reactor), _opt(opt), _events(events)
+        {
+        }
+
+        void add(const std::string& path)
+        {
+            Entry& e = _entries[path];
+            e.wanted = true;
+            e.attempts = 0;
+            if (!e.reader && !e.retry)
+                open(path);
+        }
+
+        void removed(const std::string& path)
+        {
+            auto it = _entries.find(path);
+            if (it == _entries.end())
+                return;
+            it->second.wanted = isExplicit(path);
+            cancelRetry(it->second);
+            // An open reader sees the hang-up on its own and exits.
+        }
+
+        void report(double seconds)
+        {
+            uint64_t totalFrames = 0;
+            size_t open = 0;
+            for (auto& kv : _entries)
+            {
+                Entry& e = kv.second;
+                if (!e.reader)
+                    continue;
+                open++;
+                serLinkStats s;
+                e.reader->port().stats(s, true);
+                const ReaderCounters& c = e.reader->counters();
+                totalFrames += s.exchanges;
+                fprintf(stderr,
+                        "%s frames/s=%.0f rounds/s=%.1f tags=%zu placed=%llu removed=%llu errors=%llu "
+                        "rttUs mean=%u max=%u\n",
+                        kv.first.c_str(), s.exchanges / seconds, (c.rounds - e.last.rounds) / seconds,
+                        e.reader->presence().tags().size(), static_cast<unsigned long long>(c.placed - e.last.placed),
+                        static_cast<unsigned long long>(c.removed - e.last.removed),
+                        static_cast<unsigned long long>(c.errors - e.last.errors),
+                        s.exchanges ? static_cast<unsigned>(s.rttSumUs / s.exchanges) : 0, s.rttMaxUs);
+                e.last = c;
+            }
+            fprintf(stderr, "gateway readers=%zu frames/s=%.0f\n", open, totalFrames / seconds);
+        }
+
+        // Stops every reader and runs the loop until their final removed events are out.
+        void shutdown()
+        {
+            _stopping = true;
+            for (auto& kv : _entries)
+            {
+                cancelRetry(kv.second);
+                if (kv.second.reader)
+                    kv.second.reader->stop();
+            }
+            uint64_t deadline = Reactor::nowUs() + 2000000;
+            while (openReaders() > 0 && Reactor::nowUs() < deadline)
+                _reactor.runOnce(100);
+        }
+
+    private:
+        struct Entry
+        {
+            std::unique_ptr<Reader> reader;
+            bool wanted = false;
+            int attempts = 0;
+            Reactor::TimerId retry = 0;
+            ReaderCounters last;
+        };
+
+        bool isExplicit(const std::string& path) const
+        {
+            for (const std::string& p : _opt.ports)
+            {
+                if (p == path)
+                    return true;
+            }
+            return false;
+        }
+
+        size_t openReaders() const
+        {
+            size_t n = 0;
+            for (const auto& kv : _entries)
+                n += kv.second.reader ? 1 : 0;
+            return n;
+        }
+
+        void cancelRetry(Entry& e)
+        {
+            if (e.retry)
+                _reactor.cancel(e.retry);
+            e.retry = 0;
+        }
+
+        void scheduleRetry(const std::string& path, Entry& e)
+        {
+            if (_stopping || !e.wanted || e.retry || access(path.c_str(), F_OK) != 0)
+                return;
+            e.retry = _reactor.after(RetryMs, [this, path] {
+                Entry& entry = _entries[path];
+                entry.retry = 0;
+                if (entry.wanted && !entry.reader)
+                    open(path);
+            });
+        }
+
+        void open(const std::string& path)
+        {
+            Entry& e = _entries[path];
+            auto reader = std::make_unique<Reader>(_reactor, path, _opt.reader, _events);
+            int32_t error = 0;
+            if (!reader->open(error))
+            {
+                if (e.attempts++ == 0)
+                    fprintf(stderr, "%s: %s\n", path.c_str(), strerror(error));
+                if (e.attempts < OpenRetries)
+                    scheduleRetry(path, e);
+                return;
+            }
+            fprintf(stderr, "%s: opened\n", path.c_str());
+            e.attempts = 0;
+            e.last = {};
+            e.reader = std::move(reader);
+            e.reader->start([this](Reader& r) { exited(r); });
+        }
+
+        void exited(Reader& r)
+        {
+            std::string path = r.path();
+            Entry& e = _entries[path];
+            fprintf(stderr, "%s: closed after %llu rounds\n", path.c_str(),
+                    static_cast<unsigned long long>(r.counters().rounds));
+            e.reader.reset();
+            scheduleRetry(path, e);
+        }
+
+        Reactor& _reactor;
+        const Options& _opt;
+        EventSink& _events;
+        std::map<std::string, Entry> _entries;
+        bool _stopping = false;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasArg = i + 1 < argc;
+        if (strcmp(argv[i], "-p") == 0 && hasArg)
+            opt.patterns.push_back(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && hasArg)
+            opt.socketPath = argv[++i];
+        else if (strcmp(argv[i], "-m") == 0 && hasArg)
+            opt.shmName = argv[++i];
+        else if (strcmp(argv[i], "-n") == 0 && hasArg)
+            opt.shmSlots = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (strcmp(argv[i], "-x") == 0 && hasArg && strchr(argv[i + 1], '=') && argv[i + 1][0] != '=')
+        {
+            const char* job = argv[++i];
+            const char* eq = strchr(job, '=');
+            opt.jobs.emplace_back(std::string(job, eq), std::string(eq + 1));
+        }
+        else if (strcmp(argv[i], "-j") == 0 && hasArg)
+            opt.jobTimeoutMs = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (strcmp(argv[i], "-w") == 0 && hasArg)
+            opt.workers = static_cast<unsigned>(atoi(argv[++i]));
+        else if (strcmp(argv[i], "-r") == 0 && hasArg)
+            opt.reportSec = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (strcmp(argv[i], "-i") == 0 && hasArg)
+            opt.reader.pollMs = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (strcmp(argv[i], "-a") == 0 && hasArg)
+            opt.reader.absentAfterMs = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (strcmp(argv[i], "-t") == 0 && hasArg)
+            opt.reader.timeoutMs = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (strcmp(argv[i], "-q") == 0)
+            opt.quiet = true;
+        else if (argv[i][0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else
+            opt.ports.push_back(argv[i]);
+    }
+    if (opt.patterns.empty())
+        opt.patterns = {"/dev/ttyACM*", "/dev/ttyUSB*"};
+
+    Reactor reactor;
+    if (!reactor.valid())
+    {
+        perror("epoll");
+        return 1;
+    }
+    gReactor = &reactor;
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    EventBus bus;
+    JsonLineSink stdoutSink(stdout);
+    if (!opt.quiet)
+        bus.attach(&stdoutSink);
+    SocketSink socketSink(reactor);
+    if (!opt.socketPath.empty())
+    {
+        int error = 0;
+        if (!socketSink.listen(opt.socketPath.c_str(), error))
+        {
+            fprintf(stderr, "%s: %s\n", opt.socketPath.c_str(), strerror(error));
+            return 1;
+        }
+        bus.attach(&socketSink);
+    }
+    ShmSink shmSink;
+    if (!opt.shmName.empty())
+    {
+        int error = 0;
+        if (!shmSink.create(opt.shmName.c_str(), opt.shmSlots, error))
+        {
+            fprintf(stderr, "/dev/shm/%s: %s\n", opt.shmName.c_str(), strerror(error));
+            return 1;
+        }
+        bus.attach(&shmSink);
+    }
+
+    // Declared after the reactor: the pool joins first, so no job posts to a destroyed loop.
+    std::unique_ptr<WorkPool> pool;
+    std::unique_ptr<FollowUp> followUp;
+    if (!opt.jobs.empty())
+    {
+        pool = std::make_unique<WorkPool>(opt.workers);
+        followUp = std::make_unique<FollowUp>(reactor, *pool, bus);
+        for (const auto& job : opt.jobs)
+            followUp->add(execJob(job.first, job.second, opt.jobTimeoutMs));
+        bus.attach(followUp.get());
+    }
+
+    Daemon daemon(reactor, opt, bus);
+    HotPlug hotplug(reactor);
+    hotplug.onChange = [&daemon](const std::string& path, bool added) {
+        if (added)
+            daemon.add(path);
+        else
+            daemon.removed(path);
+    };
+    int error = 0;
+    if (!hotplug.watch(opt.patterns, error))
+        fprintf(stderr, "hot-plug disabled: %s\n", strerror(error));
+
+    for (const std::string& path : opt.ports)
+        daemon.add(path);
+    for (const std::string& path : hotplug.scan())
+        daemon.add(path);
+
+    uint64_t last = Reactor::nowUs();
+    std::function<void()> tick = [&] {
+        uint64_t now = Reactor::nowUs();
+        daemon.report(static_cast<double>(now - last) / 1e6);
+        if (followUp)
+            fprintf(stderr,
+                    "followup pending=%zu completed=%llu dropped=%llu truncated=%llu pool threads=%u queued=%zu "
+                    "stolen=%llu\n",
+                    followUp->pending(), static_cast<unsigned long long>(followUp->completed()),
+                    static_cast<unsigned long long>(followUp->dropped()),
+                    static_cast<unsigned long long>(followUp->truncated()), pool->threads(), pool->queued(),
+                    static_cast<unsigned long long>(pool->stolen()));
+        last = now;
+        reactor.after(opt.reportSec * 1000, tick);
+    };
+    if (opt.reportSec > 0)
+        reactor.after(opt.reportSec * 1000, tick);
+
+    reactor.run();
+    daemon.shutdown();
+    fprintf(stderr, "gateway stopped\n");
+    return 0;
+}
@@ -0,0 +1,394 @@
+// Serial link benchmark for the ST25R200 serial RFAL protocol (host-side twin of
+// St25r200Reader::runBenchmark). Floods the device with SysPing and ChipReadReg requests and
+// prints frames/s, RTT percentiles and wire vs. device time per step.
+//
+//   st25-link-bench /dev/ttyACM0 [-b 115200,921600] [-d 1000] [-s 1,8,32] [-w]
+//
+// -w also probes the device's receive window: bursts of back-to-back SysPing frames, doubled until
+// one is not fully answered, then narrowed. The largest fully answered burst is the rx credit a
+// host may keep on the wire at that baud rate (SerRfalAsync::Port::setRxCredit, serSetRxCredit).
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    constexpr uint8_t FrameHeader = 0xAA;
+    constexpr uint16_t SysPingReq = 0xF000;
+    constexpr uint16_t RfalChipReadRegReq = 0x1162;
+    constexpr int ReadTimeoutMs = 200;
+
+    uint64_t nowUs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+    }
+
+    speed_t toSpeed(uint32_t baud)
+    {
+        switch (baud)
+        {
+            case 9600: return B9600;
+            case 19200: return B19200;
+            case 38400: return B38400;
+            case 57600: return B57600;
+            case 115200: return B115200;
+            case 230400: return B230400;
+            case 460800: return B460800;
+            case 921600: return B921600;
+            case 1000000: return B1000000;
+            case 2000000: return B2000000;
+            default: return 0;
+        }
+    }
+
+    bool configurePort(int fd, uint32_t baud)
+    {
+        speed_t speed = toSpeed(baud);
+        if (speed == 0)
+        {
+            fprintf(stderr, "unsupported baud rate %u\n", baud);
+            return false;
+        }
+
+        termios tio;
+        if (tcgetattr(fd, &tio) != 0)
+        {
+            perror("tcgetattr");
+            return false;
+        }
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+        if (tcsetattr(fd, TCSANOW, &tio) != 0)
+        {
+            perror("tcsetattr");
+            return false;
+        }
+        tcflush(fd, TCIOFLUSH);
+        return true;
+    }
+
+    bool writeAll(int fd, const uint8_t* buf, size_t len)
+    {
+        while (len > 0)
+        {
+            ssize_t n = write(fd, buf, len);
+            if (n < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN)
+                    continue;
+                return false;
+            }
+            buf += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool readExact(int fd, uint8_t* buf, size_t len, uint64_t deadlineUs)
+    {
+        while (len > 0)
+        {
+            uint64_t now = nowUs();
+            if (now >= deadlineUs)
+                return false;
+
+            pollfd pfd = {fd, POLLIN, 0};
+            int waitMs = static_cast<int>((deadlineUs - now + 999) / 1000);
+            if (poll(&pfd, 1, waitMs) <= 0)
+                continue;
+
+            ssize_t n = read(fd, buf, len);
+            if (n < 0 && errno != EINTR && errno != EAGAIN)
+                return false;
+            if (n > 0)
+            {
+                buf += n;
+                len -= static_cast<size_t>(n);
+            }
+        }
+        return true;
+    }
+
+    size_t encodeFrame(uint8_t* frame, uint16_t cmdId, const uint8_t* payload, size_t payloadLen)
+    {
+        uint16_t len = static_cast<uint16_t>(2 + payloadLen);
+        frame[0] = FrameHeader;
+        frame[1] = static_cast<uint8_t>(len >> 8);
+        frame[2] = static_cast<uint8_t>(len);
+        frame[3] = static_cast<uint8_t>(cmdId >> 8);
+        frame[4] = static_cast<uint8_t>(cmdId);
+        if (payloadLen)
+            memcpy(frame + 5, payload, payloadLen);
+        return 5 + payloadLen;
+    }
+
+    // Next response frame; true when it answers cmdId.
+    bool readResponse(int fd, uint16_t cmdId, std::vector<uint8_t>& rsp, uint64_t deadline)
+    {
+        uint8_t b = 0;
+        do
+        {
+            if (!readExact(fd, &b, 1, deadline))
+                return false;
+        } while (b != FrameHeader);
+
+        uint8_t hdr[4];
+        if (!readExact(fd, hdr, sizeof(hdr), deadline))
+            return false;
+        uint16_t rspLen = static_cast<uint16_t>((hdr[0] << 8) | hdr[1]);
+        uint16_t rspCmd = static_cast<uint16_t>((hdr[2] << 8) | hdr[3]);
+        if (rspLen < 2)
+            return false;
+
+        rsp.resize(rspLen - 2);
+        if (!readExact(fd, rsp.data(), rsp.size(), deadline))
+            return false;
+        return rspCmd == cmdId + 1;
+    }
+
+    // One request/response exchange; returns the response payload (without cmdId).
+    bool exchange(int fd, uint16_t cmdId, const uint8_t* payload, size_t payloadLen, std::vector<uint8_t>& rsp)
+    {
+        uint8_t frame[5 + 256];
+        if (!writeAll(fd, frame, encodeFrame(frame, cmdId, payload, payloadLen)))
+            return false;
+        return readResponse(fd, cmdId, rsp, nowUs() + ReadTimeoutMs * 1000ULL);
+    }
+
+    bool sysPing(int fd, std::vector<uint8_t>& rsp)
+    {
+        return exchange(fd, SysPingReq, nullptr, 0, rsp);
+    }
+
+    bool chipReadReg(int fd, uint8_t len, std::vector<uint8_t>& rsp)
+    {
+        const uint8_t payload[3] = {0, 0, len};
+        if (!exchange(fd, RfalChipReadRegReq, payload, sizeof(payload), rsp))
+            return false;
+        // ret u16, length u16, register bytes
+        return rsp.size() >= 4u + len && rsp[0] == 0 && rsp[1] == 0 && rsp[3] == len;
+    }
+
+    void benchmarkStep(int fd, uint32_t baud, uint8_t readLen, uint32_t durationMs)
+    {
+        size_t reqBytes = readLen == 0 ? 5 : 5 + 3;
+        size_t rspBytes = readLen == 0 ? 5 : 5 + 4 + readLen;
+
+        std::vector<uint32_t> rtts;
+        std::vector<uint8_t> rsp;
+        uint32_t failures = 0;
+        uint64_t start = nowUs();
+        uint64_t end = start + durationMs * 1000ULL;
+        while (nowUs() < end)
+        {
+            uint64_t t0 = nowUs();
+            bool ok = readLen == 0 ? sysPing(fd, rsp) : chipReadReg(fd, readLen, rsp);
+            if (!ok)
+            {
+                failures++;
+                tcflush(fd, TCIFLUSH);
+                continue;
+            }
+            rtts.push_back(static_cast<uint32_t>(nowUs() - t0));
+        }
+        uint64_t elapsedUs = nowUs() - start;
+
+        std::sort(rtts.begin(), rtts.end());
+        auto pct = [&](unsigned p) -> uint32_t
+        {
+            if (rtts.empty())
+                return 0;
+            size_t idx = (rtts.size() * p + 99) / 100;
+            return rtts[idx ? idx - 1 : 0];
+        };
+        uint64_t sum = 0;
+        for (uint32_t us : rtts)
+            sum += us;
+        uint32_t meanUs = rtts.empty() ? 0 : static_cast<uint32_t>(sum / rtts.size());
+        uint32_t wireUs = static_cast<uint32_t>((reqBytes + rspBytes) * 10ULL * 1000000ULL / baud);
+        double fps = elapsedUs ? rtts.size() * 1000000.0 / elapsedUs : 0.0;
+
+        printf("bench baud=%u cmd=%s req=%zu rsp=%zu frames=%zu fail=%u fps=%.1f rspKBps=%.2f "
+               "rttUs min=%u mean=%u p50=%u p99=%u max=%u wireUs=%u deviceUs=%u\n",
+               baud, readLen == 0 ? "sysPing" : "readReg", reqBytes, rspBytes, rtts.size(), failures, fps,
+               fps * rspBytes / 1000.0, rtts.empty() ? 0 : rtts.front(), meanUs, pct(50), pct(99),
+               rtts.empty() ? 0 : rtts.back(), wireUs, meanUs > wireUs ? meanUs - wireUs : 0);
+    }
+
+    // Writes count SysPing frames in one write(); true when every one is answered.
+    bool pingBurst(int fd, size_t count)
+    {
+        std::vector<uint8_t> burst(count * 5);
+        for (size_t i = 0; i < count; ++i)
+            encodeFrame(burst.data() + i * 5, SysPingReq, nullptr, 0);
+        if (!writeAll(fd, burst.data(), burst.size()))
+            return false;
+        std::vector<uint8_t> rsp;
+        uint64_t deadline = nowUs() + ReadTimeoutMs * 1000ULL;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!readResponse(fd, SysPingReq, rsp, deadline))
+                return false;
+        }
+        return true;
+    }
+
+    // Lost bytes leave the device waiting in the middle of a frame: a few pings complete it, then
+    // whatever it answered is flushed.
+    void resync(int fd)
+    {
+        std::vector<uint8_t> rsp;
+        for (int i = 0; i < 64; ++i)
+        {
+            if (sysPing(fd, rsp))
+                break;
+        }
+        usleep(ReadTimeoutMs * 1000);
+        tcflush(fd, TCIFLUSH);
+    }
+
+    void probeWindow(int fd, uint32_t baud)
+    {
+        constexpr size_t MaxBurst = 4096 / 5;
+        size_t good = 0;
+        size_t bad = 0;
+        for (size_t count = 1; count <= MaxBurst; count *= 2)
+        {
+            if (!pingBurst(fd, count))
+            {
+                bad = count;
+                resync(fd);
+                break;
+            }
+            good = count;
+        }
+        while (bad && bad - good > 1)
+        {
+            size_t count = (good + bad) / 2;
+            if (pingBurst(fd, count))
+                good = count;
+            else
+            {
+                bad = count;
+                resync(fd);
+            }
+        }
+        printf("window baud=%u burstFrames=%zu rxCredit=%zu%s\n", baud, good, good * 5,
+               bad ? "" : " (no limit found)");
+    }
+
+    std::vector<uint32_t> parseList(const char* arg)
+    {
+        std::vector<uint32_t> out;
+        const char* p = arg;
+        while (*p)
+        {
+            char* endp = nullptr;
+            unsigned long v = strtoul(p, &endp, 10);
+            if (endp == p)
+                break;
+            out.push_back(static_cast<uint32_t>(v));
+            p = *endp == ',' ? endp + 1 : endp;
+        }
+        return out;
+    }
+
+    void usage(const char* argv0)
+    {
+        fprintf(stderr, "usage: %s <device> [-b baud[,baud...]] [-d durationMs] [-s readLen[,readLen...]] [-w]\n",
+                argv0);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    const char* device = argv[1];
+    std::vector<uint32_t> bauds = {115200};
+    std::vector<uint32_t> sizes = {1, 8, 32};
+    uint32_t durationMs = 1000;
+    bool window = false;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-w") == 0)
+        {
+            window = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        if (strcmp(argv[i], "-b") == 0)
+            bauds = parseList(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0)
+            durationMs = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        else if (strcmp(argv[i], "-s") == 0)
+            sizes = parseList(argv[++i]);
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    int fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0)
+    {
+        perror(device);
+        return 1;
+    }
+
+    for (uint32_t baud : bauds)
+    {
+        if (!configurePort(fd, baud))
+            continue;
+
+        // Warm-up ping: the device may still be discarding bytes sent at the previous rate.
+        std::vector<uint8_t> rsp;
+        sysPing(fd, rsp);
+        tcflush(fd, TCIFLUSH);
+        if (!sysPing(fd, rsp))
+        {
+            printf("bench baud=%u no answer\n", baud);
+            continue;
+        }
+
+        benchmarkStep(fd, baud, 0, durationMs);
+        for (uint32_t len : sizes)
+        {
+            if (len >= 1 && len <= 247)
+                benchmarkStep(fd, baud, static_cast<uint8_t>(len), durationMs);
+        }
+        if (window)
+            probeWindow(fd, baud);
+    }
+
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,601 @@
+// Serial RFAL device simulator on a pseudo-terminal: answers the frames SerRfalHost sends so the
+// host library, st25-console and gateways run without a reader attached. Tags are served through
+// FlatNfcDevice::Builder, the same wire layout the Arduino reader and SerRfalHost decode.
+//
+//   st25-pty-sim [-l /tmp/st25sim] [-t V:E0040150AABBCCDD] [-t A:04A1B2C3D4E5F6] [-a 2] [-d 0]
+//                [-r 0]
+//
+// -r models the firmware's receive buffer: bytes that arrive while it holds that many unserved
+// bytes are lost, as on the UART, and counted. The default 0 buffers everything.
+//
+// The chip registers are a plain register file, reachable through the rfalChip register calls and
+// SysSpiTxRx register bursts; the simulator prints how many register bytes and direct commands it
+// took on exit.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "FlatNfcDevice.h"
+
+namespace
+{
+    constexpr uint8_t FrameHeader = 0xAA;
+    constexpr size_t MaxFramePayload = 256;    // requests: the firmware receive buffer
+    constexpr size_t MaxRspPayload = 0xFFFF - 2; // responses: what the u16 length allows
+
+    // Rfal::ReturnCode / NfcState / NfcDevType / NfcPollTech values (see arduino/RfalEnums.h).
+    constexpr uint16_t RetNone = 0;
+    constexpr uint16_t RetParam = 7;
+    constexpr uint16_t RetNotImplemented = 15;
+    constexpr uint16_t RetWrongState = 33;
+    constexpr uint32_t StateNotInit = 0;
+
+    // ST25R200 register space and SPI access modes (address byte of a chip select).
+    constexpr size_t RegCount = 0x40;
+    constexpr size_t TestRegCount = 0x100;
+    constexpr uint8_t RegIcIdentity = 0x3F;
+    constexpr uint8_t SimIcIdentity = 0xA5; // any non-zero type/revision, so reads are visible
+    constexpr uint8_t SpiRead = 0x80;
+    constexpr uint32_t StateIdle = 1;
+    constexpr uint32_t StatePollTechDetect = 10;
+    constexpr uint32_t StateActivated = 30;
+    constexpr uint32_t DeactivateDiscovery = 2;
+
+    struct Tag
+    {
+        uint32_t devType;
+        uint16_t pollTech;
+        uint8_t uid[10];
+        uint8_t uidLen;
+    };
+
+    struct Device
+    {
+        std::vector<Tag> tags;
+        uint32_t activateAfter = 2; // GetState polls in discovery before a tag is activated
+        uint32_t delayUs = 0;       // firmware + SPI turnaround per frame
+        size_t rxBytes = 0;         // receive buffer, 0 unlimited
+        size_t analogTableLen = 0;  // rfalAnalogConfigListReadRaw table size
+
+        uint32_t state = StateNotInit;
+        uint16_t techs = 0;
+        uint8_t devLimit = 1;
+        uint32_t polls = 0;
+        uint8_t rfo = 0;
+        uint32_t frames = 0;
+        uint64_t overrun = 0;       // bytes lost to a full receive buffer
+
+        uint8_t regs[RegCount] = {};
+        uint8_t testRegs[TestRegCount] = {};
+        uint64_t regWrites = 0;     // register bytes written, any path
+        uint64_t commands = 0;      // direct commands, any path
+    };
+
+    volatile sig_atomic_t gStop = 0;
+
+    void onSignal(int)
+    {
+        gStop = 1;
+    }
+
+    size_t put16(uint8_t* out, uint16_t v)
+    {
+        out[0] = static_cast<uint8_t>(v >> 8);
+        out[1] = static_cast<uint8_t>(v);
+        return 2;
+    }
+
+    size_t put32(uint8_t* out, uint32_t v)
+    {
+        put16(out, static_cast<uint16_t>(v >> 16));
+        put16(out + 2, static_cast<uint16_t>(v));
+        return 4;
+    }
+
+    // "V:E0040150AABBCCDD" as printed by st25-console (NFC-V and ST25TB UIDs MSB first).
+    bool parseTag(const char* arg, Tag& tag)
+    {
+        static const struct
+        {
+            const char* prefix;
+            uint32_t devType;
+            uint16_t pollTech;
+            uint8_t minLen;
+            uint8_t maxLen;
+        } kTechs[] = {
+            {"A:", 0, 0x0001, 4, 10}, {"B:", 1, 0x0002, 4, 4}, {"F:", 2, 0x0004, 8, 8},
+            {"V:", 3, 0x0008, 8, 8},  {"TB:", 4, 0x0020, 8, 8},
+        };
+
+        for (const auto& t : kTechs)
+        {
+            size_t plen = strlen(t.prefix);
+            if (strncmp(arg, t.prefix, plen) != 0)
+                continue;
+            const char* hex = arg + plen;
+            size_t n = strlen(hex) / 2;
+            if (strlen(hex) % 2 != 0 || n < t.minLen || n > t.maxLen || (t.devType == 0 && n != 4 && n != 7 && n != 10))
+                return false;
+            for (size_t i = 0; i < n; ++i)
+            {
+                char byte[3] = {hex[2 * i], hex[2 * i + 1], 0};
+                char* end = nullptr;
+                uint8_t v = static_cast<uint8_t>(strtoul(byte, &end, 16));
+                if (*end != '\0')
+                    return false;
+                bool lsbFirst = t.devType == 3 || t.devType == 4;
+                tag.uid[lsbFirst ? n - 1 - i : i] = v;
+            }
+            tag.devType = t.devType;
+            tag.pollTech = t.pollTech;
+            tag.uidLen = static_cast<uint8_t>(n);
+            return true;
+        }
+        return false;
+    }
+
+    size_t buildTag(const Tag& tag, uint8_t* out, size_t cap)
+    {
+        using FlatNfcDevice::Field;
+        FlatNfcDevice::Builder b;
+        if (!b.begin(out, cap, tag.devType, tag.devType == 0 ? tag.uidLen : 0))
+            return 0;
+        switch (tag.devType)
+        {
+            case 0:
+                b.at<Field::NfcaSensRes>()[0] = 0x44;
+                *b.at<Field::NfcaSelRes>() = 0x00;
+                memcpy(b.at<Field::NfcaNfcId1>(), tag.uid, tag.uidLen);
+                break;
+            case 1:
+                *b.at<Field::NfcbSensbResLen>() = 12;
+                b.at<Field::NfcbSensbRes>()[0] = 0x50;
+                memcpy(b.at<Field::NfcbSensbRes>() + 1, tag.uid, 4);
+                break;
+            case 2:
+                *b.at<Field::NfcfSensfResLen>() = 18;
+                b.at<Field::NfcfSensfRes>()[0] = 0x01;
+                memcpy(b.at<Field::NfcfSensfRes>() + 1, tag.uid, 8);
+                break;
+            case 3:
+                memcpy(b.at<Field::NfcvUid>(), tag.uid, 8);
+                break;
+            case 4:
+                *b.at<Field::St25tbChipId>() = static_cast<uint8_t>(rand());
+                memcpy(b.at<Field::St25tbUid>(), tag.uid, 8);
+                break;
+        }
+        return b.size();
+    }
+
+    bool anyTagFound(const Device& dev)
+    {
+        for (const Tag& tag : dev.tags)
+        {
+            if (dev.techs & tag.pollTech)
+                return true;
+        }
+        return false;
+    }
+
+    // Register bursts auto-increment; addresses past the register space read 0 and ignore writes.
+    void writeRegs(Device& dev, size_t reg, const uint8_t* values, size_t len)
+    {
+        for (size_t i = 0; i < len && reg + i < RegCount; ++i)
+        {
+            if (reg + i != RegIcIdentity)
+                dev.regs[reg + i] = values[i];
+            dev.regWrites++;
+        }
+    }
+
+    void readRegs(const Device& dev, size_t reg, uint8_t* out, size_t len)
+    {
+        for (size_t i = 0; i < len; ++i)
+            out[i] = reg + i < RegCount ? dev.regs[reg + i] : 0;
+    }
+
+    void startDiscovery(Device& dev)
+    {
+        dev.state = StatePollTechDetect;
+        dev.polls = 0;
+    }
+
+    // Handles one request; returns the response payload length in rsp.
+    size_t handle(Device& dev, uint16_t cmd, const uint8_t* req, size_t reqLen, uint8_t* rsp)
+    {
+        size_t o = 0;
+        switch (cmd)
+        {
+            case 0xF000: // SysPing
+                return 0;
+
+            case 0xF002: // SysGetVersion: versionLen, version, rfalVersion, fwVersion, serHash
+            {
+                static const char kVersion[] = "ST25R200 pty-sim";
+                o += put16(rsp + o, sizeof(kVersion) - 1);
+                memcpy(rsp + o, kVersion, sizeof(kVersion) - 1);
+                o += sizeof(kVersion) - 1;
+                o += put32(rsp + o, 0x00030000);
+                o += put32(rsp + o, 0x00010000);
+                o += put32(rsp + o, 0x5349D000);
+                return o;
+            }
+
+            case 0xF004: // SysGetConfigHashes: ret, original, flash, RAM
+                o += put16(rsp + o, RetNone);
+                for (int i = 0; i < 3; ++i)
+                    o += put32(rsp + o, 0x811C9DC5);
+                return o;
+
+            case 0x2000: // rfalNfcInitialize
+                dev.state = StateIdle;
+                return put16(rsp, RetNone);
+
+            case 0x2002: // rfalNfcDiscover: compMode u32, techs2Find u16, techs2Bail u16, totalDuration u16, devLimit
+                if (dev.state == StateNotInit || reqLen < 11)
+                    return put16(rsp, RetWrongState);
+                dev.techs = static_cast<uint16_t>((req[4] << 8) | req[5]);
+                dev.devLimit = req[10] ? req[10] : 1;
+                startDiscovery(dev);
+                return put16(rsp, RetNone);
+
+            case 0x2004: // rfalNfcGetState
+                if (dev.state == StatePollTechDetect && ++dev.polls > dev.activateAfter && anyTagFound(dev))
+                    dev.state = StateActivated;
+                return put32(rsp, dev.state);
+
+            case 0x2006: // rfalNfcGetDevicesFound: ret, devCnt, records
+            {
+                if (dev.state != StateActivated)
+                {
+                    o += put16(rsp + o, RetWrongState);
+                    rsp[o++] = 0;
+                    return o;
+                }
+                o += put16(rsp + o, RetNone);
+                size_t countAt = o++;
+                uint8_t count = 0;
+                for (const Tag& tag : dev.tags)
+                {
+                    if (count >= dev.devLimit || !(dev.techs & tag.pollTech))
+                        continue;
+                    size_t n = buildTag(tag, rsp + o, MaxFramePayload - o);
+                    if (n == 0)
+                        break;
+                    o += n;
+                    count++;
+                }
+                rsp[countAt] = count;
+                return o;
+            }
+
+            case 0x2010: // rfalNfcDeactivate: type u32
+            {
+                uint32_t type = reqLen >= 4 ? static_cast<uint32_t>(req[3]) : 0;
+                if (type == DeactivateDiscovery)
+                    startDiscovery(dev);
+                else
+                    dev.state = StateIdle;
+                return put16(rsp, RetNone);
+            }
+
+            case 0x1144: // rfalAnalogConfigListReadRaw: ret, size, table
+                o += put16(rsp + o, RetNone);
+                o += put16(rsp + o, static_cast<uint16_t>(dev.analogTableLen));
+                for (size_t i = 0; i < dev.analogTableLen; ++i)
+                    rsp[o++] = static_cast<uint8_t>(i);
+                return o;
+
+            case 0x1160: // rfalChipWriteReg: reg u16, len u16, values
+            {
+                if (reqLen < 4)
+                    return put16(rsp, RetParam);
+                size_t reg = static_cast<size_t>((req[0] << 8) | req[1]);
+                size_t len = static_cast<size_t>((req[2] << 8) | req[3]);
+                if (reqLen < 4 + len)
+                    return put16(rsp, RetParam);
+                writeRegs(dev, reg, req + 4, len);
+                return put16(rsp, RetNone);
+            }
+
+            case 0x1162: // rfalChipReadReg: reg u16, len u8 -> ret, length, bytes
+            {
+                size_t reg = reqLen >= 2 ? static_cast<size_t>((req[0] << 8) | req[1]) : 0;
+                uint8_t len = reqLen >= 3 ? req[2] : 0;
+                if (len > MaxFramePayload - 4)
+                    len = MaxFramePayload - 4;
+                o += put16(rsp + o, RetNone);
+                o += put16(rsp + o, len);
+                readRegs(dev, reg, rsp + o, len);
+                return o + len;
+            }
+
+            case 0x1164: // rfalChipChangeRegBits: reg u16, mask, value
+            case 0x116A: // rfalChipChangeTestRegBits: reg u16, mask, value
+            {
+                if (reqLen < 4)
+                    return put16(rsp, RetParam);
+                size_t reg = static_cast<size_t>((req[0] << 8) | req[1]);
+                uint8_t* file = cmd == 0x1164 ? dev.regs : dev.testRegs;
+                if (reg >= (cmd == 0x1164 ? RegCount : TestRegCount))
+                    return put16(rsp, RetParam);
+                file[reg] = static_cast<uint8_t>((file[reg] & ~req[2]) | (req[3] & req[2]));
+                dev.regWrites++;
+                return put16(rsp, RetNone);
+            }
+
+            case 0x1166: // rfalChipWriteTestReg: reg u16, value
+                if (reqLen < 3 || static_cast<size_t>((req[0] << 8) | req[1]) >= TestRegCount)
+                    return put16(rsp, RetParam);
+                dev.testRegs[(req[0] << 8) | req[1]] = req[2];
+                dev.regWrites++;
+                return put16(rsp, RetNone);
+
+            case 0x1168: // rfalChipReadTestReg: reg u16 -> ret, value
+            {
+                size_t reg = reqLen >= 2 ? static_cast<size_t>((req[0] << 8) | req[1]) : TestRegCount;
+                if (reg >= TestRegCount)
+                    return put16(rsp, RetParam);
+                o += put16(rsp + o, RetNone);
+                rsp[o++] = dev.testRegs[reg];
+                return o;
+            }
+
+            case 0x116C: // rfalChipExecCmd: cmd u16
+                dev.commands++;
+                return put16(rsp, RetNone);
+
+            case 0xF00E: // SysSpiTxRx: len u16, bytes of one chip select -> ret, len, bytes clocked in
+            {
+                size_t len = reqLen >= 2 ? static_cast<size_t>((req[0] << 8) | req[1]) : 0;
+                if (len == 0 || reqLen < 2 + len || len > MaxFramePayload - 4)
+                    return put16(rsp, RetParam);
+                const uint8_t* tx = req + 2;
+                o += put16(rsp + o, RetNone);
+                o += put16(rsp + o, static_cast<uint16_t>(len));
+                memset(rsp + o, 0, len);
+                if (tx[0] < RegCount)
+                    writeRegs(dev, tx[0], tx + 1, len - 1);
+                else if ((tx[0] & ~SpiRead) < RegCount && (tx[0] & SpiRead))
+                    readRegs(dev, tx[0] & ~SpiRead, rsp + o + 1, len - 1);
+                else if (len == 1)
+                    dev.commands++;
+                return o + len;
+            }
+
+            case 0x116E: // rfalChipSetRFO
+                dev.rfo = reqLen >= 1 ? req[0] : 0;
+                return put16(rsp, RetNone);
+
+            case 0x1170: // rfalChipGetRFO
+            case 0x1172: // rfalChipMeasureAmplitude
+            case 0x1174: // rfalChipMeasurePhase
+                o += put16(rsp + o, RetNone);
+                rsp[o++] = cmd == 0x1170 ? dev.rfo : cmd == 0x1172 ? static_cast<uint8_t>(120 - 4 * dev.rfo) : 80;
+                return o;
+
+            case 0xF016: // SysNfcReset
+                dev.state = StateNotInit;
+                return put16(rsp, RetNone);
+
+            case 0x1000: // rfalInitialize
+            case 0x1014: // rfalFieldOff
+            case 0x1142: // rfalAnalogConfigListWriteRaw
+            case 0x1152: // rfalDpoTableWrite
+            case 0x1156: // rfalDpoSetEnable
+            case 0x1196: // rfalWakeUpModeStop
+                return put16(rsp, RetNone);
+
+            default:
+                return put16(rsp, RetNotImplemented);
+        }
+    }
+
+    bool writeAll(int fd, const uint8_t* buf, size_t len)
+    {
+        while (len > 0)
+        {
+            ssize_t n = write(fd, buf, len);
+            if (n < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN)
+                {
+                    pollfd pfd = {fd, POLLOUT, 0};
+                    poll(&pfd, 1, 100);
+                    continue;
+                }
+                return false;
+            }
+            buf += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Consumes every complete frame in buf[0, len) and answers it; returns the bytes used.
+    size_t serve(Device& dev, int fd, const uint8_t* buf, size_t len)
+    {
+        size_t ofs = 0;
+        while (ofs < len)
+        {
+            if (buf[ofs] != FrameHeader)
+            {
+                ofs++;
+                continue;
+            }
+            if (len - ofs < 5)
+                break;
+            size_t frameLen = static_cast<size_t>((buf[ofs + 1] << 8) | buf[ofs + 2]);
+            if (frameLen < 2 || frameLen - 2 > MaxFramePayload)
+            {
+                ofs++;
+                continue;
+            }
+            if (len - ofs < 3 + frameLen)
+                break;
+
+            uint16_t cmd = static_cast<uint16_t>((buf[ofs + 3] << 8) | buf[ofs + 4]);
+            static uint8_t frame[5 + MaxRspPayload];
+            size_t rspLen = handle(dev, cmd, buf + ofs + 5, frameLen - 2, frame + 5);
+            frame[0] = FrameHeader;
+            frame[1] = static_cast<uint8_t>((rspLen + 2) >> 8);
+            frame[2] = static_cast<uint8_t>(rspLen + 2);
+            frame[3] = static_cast<uint8_t>((cmd + 1) >> 8);
+            frame[4] = static_cast<uint8_t>(cmd + 1);
+            if (dev.delayUs)
+                usleep(dev.delayUs);
+            writeAll(fd, frame, 5 + rspLen);
+            dev.frames++;
+            ofs += 3 + frameLen;
+        }
+        return ofs;
+    }
+
+    void usage(const char* argv0)
+    {
+        fprintf(stderr, "usage: %s [-l link] [-t tech:uid]... [-a polls] [-d delayUs] [-r rxBytes]\n"
+                        "          [-g tableBytes]\n"
+                        "  tech: A, B, F, V, TB; UIDs as st25-console prints them\n",
+                argv0);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Device dev;
+    dev.regs[RegIcIdentity] = SimIcIdentity;
+    const char* link = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        if (strcmp(argv[i], "-l") == 0)
+            link = argv[++i];
+        else if (strcmp(argv[i], "-a") == 0)
+            dev.activateAfter = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        else if (strcmp(argv[i], "-d") == 0)
+            dev.delayUs = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        else if (strcmp(argv[i], "-r") == 0)
+            dev.rxBytes = strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "-g") == 0)
+            dev.analogTableLen = strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "-t") == 0)
+        {
+            Tag tag = {};
+            if (!parseTag(argv[++i], tag))
+            {
+                fprintf(stderr, "bad tag %s\n", argv[i]);
+                return 2;
+            }
+            dev.tags.push_back(tag);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (dev.rxBytes && (dev.rxBytes < 5 + MaxFramePayload || dev.rxBytes > 4096))
+    {
+        fprintf(stderr, "-r must be between %zu and 4096\n", 5 + MaxFramePayload);
+        return 2;
+    }
+    if (dev.analogTableLen > MaxRspPayload - 4)
+    {
+        fprintf(stderr, "-g must be at most %zu\n", MaxRspPayload - 4);
+        return 2;
+    }
+    if (dev.tags.empty())
+    {
+        Tag tag = {};
+        parseTag("V:E0040150AABBCCDD", tag);
+        dev.tags.push_back(tag);
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        perror("posix_openpt");
+        return 1;
+    }
+    const char* slavePath = ptsname(master);
+
+    // Holding the slave open keeps the master readable across client reopens (no EIO/HUP), and
+    // sets the line discipline raw before the first client arrives.
+    int slave = open(slavePath, O_RDWR | O_NOCTTY);
+    termios tio;
+    if (slave < 0 || tcgetattr(slave, &tio) != 0)
+    {
+        perror(slavePath);
+        return 1;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    if (link)
+    {
+        unlink(link);
+        if (symlink(slavePath, link) != 0)
+        {
+            perror(link);
+            return 1;
+        }
+    }
+    printf("pty %s%s%s tags=%zu\n", slavePath, link ? " link " : "", link ? link : "", dev.tags.size());
+    fflush(stdout);
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    uint8_t buf[4096];
+    size_t len = 0;
+    while (!gStop)
+    {
+        pollfd pfd = {master, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0)
+            continue;
+        ssize_t n = read(master, buf + len, sizeof(buf) - len);
+        if (n <= 0)
+            continue;
+        len += static_cast<size_t>(n);
+        if (dev.rxBytes && len > dev.rxBytes)
+        {
+            dev.overrun += len - dev.rxBytes;
+            len = dev.rxBytes;
+        }
+        size_t used = serve(dev, master, buf, len);
+        memmove(buf, buf + used, len - used);
+        len -= used;
+        if (len == sizeof(buf))
+            len = 0; // garbage without a frame header
+    }
+
+    printf("served %u frames", dev.frames);
+    if (dev.rxBytes)
+        printf(" overrun %llu bytes", static_cast<unsigned long long>(dev.overrun));
+    if (dev.regWrites)
+        printf(" register writes %llu bytes", static_cast<unsigned long long>(dev.regWrites));
+    if (dev.commands)
+        printf(" direct commands %llu", static_cast<unsigned long long>(dev.commands));
+    printf("\n");
+    if (link)
+        unlink(link);
+    close(slave);
+    close(master);
+    return 0;
+}
@@ -0,0 +1,333 @@
+// Register access tool for tuning sessions: applies register writes, bit changes and a tuning sweep
+// through RegShadow, then dumps the register space and prints the serial cost, so a run with the
+// shadow can be compared with one that issues every rfalChip call directly (-n).
+//
+//   st25-regtool [/dev/ttyACM0] [-w reg=val]... [-c reg=mask:val]... [-s reg:mask:first-last]
+//                [-p passes] [-n] [-x script]
+//
+// Values are hex. -w and -c run in command-line order, -p times over (a tuning loop re-applying
+// its settings). -s then steps the masked bits of reg from first to last and measures the antenna
+// amplitude at each step.
+//
+// -x runs a raw SPI script last, as one SpiTransaction: comma-separated rREG[:LEN] reads,
+// wREG=BYTES writes and cCMD direct commands, e.g. -x r00:10,w02=8150,c61,r30:2.
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <optional>
+#include <vector>
+
+#include "RegShadow.h"
+#include "SerRfalWire.h"
+#include "SpiTransaction.h"
+
+namespace
+{
+    struct Op
+    {
+        uint16_t reg;
+        uint8_t mask; // 0xFF with value: plain write
+        uint8_t value;
+        bool change;
+    };
+
+    struct Sweep
+    {
+        uint16_t reg;
+        uint8_t mask;
+        uint8_t first;
+        uint8_t last;
+    };
+
+    struct ScriptRead
+    {
+        SpiTransaction::Read read;
+        uint8_t reg;
+        uint8_t len;
+    };
+
+    uint64_t nowUs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+    }
+
+    void usage(const char* argv0)
+    {
+        fprintf(stderr,
+                "usage: %s [port] [-w reg=val]... [-c reg=mask:val]... [-s reg:mask:first-last] [-p passes] [-n]\n"
+                "          [-x script]\n"
+                "  script: comma-separated rREG[:LEN], wREG=BYTES, cCMD (hex)\n",
+                argv0);
+    }
+
+    bool parseHex(const char*& s, uint32_t max, uint32_t& value)
+    {
+        char* end = nullptr;
+        unsigned long v = strtoul(s, &end, 16);
+        if (end == s || v > max)
+            return false;
+        value = static_cast<uint32_t>(v);
+        s = end;
+        return true;
+    }
+
+    bool parseOp(const char* s, bool change, Op& op)
+    {
+        uint32_t reg, mask = 0xFF, value;
+        if (!parseHex(s, 0xFFFF, reg) || *s++ != '=')
+            return false;
+        if (change && (!parseHex(s, 0xFF, mask) || *s++ != ':'))
+            return false;
+        if (!parseHex(s, 0xFF, value) || *s != '\0')
+            return false;
+        op = {static_cast<uint16_t>(reg), static_cast<uint8_t>(mask), static_cast<uint8_t>(value), change};
+        return true;
+    }
+
+    bool parseSweep(const char* s, Sweep& sweep)
+    {
+        uint32_t reg, mask, first, last;
+        if (!parseHex(s, 0xFFFF, reg) || *s++ != ':' || !parseHex(s, 0xFF, mask) || *s++ != ':' ||
+            !parseHex(s, 0xFF, first) || *s++ != '-' || !parseHex(s, 0xFF, last) || *s != '\0' || first > last)
+            return false;
+        sweep = {static_cast<uint16_t>(reg), static_cast<uint8_t>(mask), static_cast<uint8_t>(first),
+                 static_cast<uint8_t>(last)};
+        return true;
+    }
+
+    bool parseScript(const char* s, SpiTransaction& t, std::vector<ScriptRead>& reads)
+    {
+        for (;;)
+        {
+            char op = *s++;
+            uint32_t reg, len = 1;
+            if (op == 'r')
+            {
+                if (!parseHex(s, 0xFF, reg) || (*s == ':' && !parseHex(++s, 0xFF, len)))
+                    return false;
+                reads.push_back({t.readReg(static_cast<uint8_t>(reg), static_cast<uint8_t>(len)),
+                                 static_cast<uint8_t>(reg), static_cast<uint8_t>(len)});
+            }
+            else if (op == 'w')
+            {
+                if (!parseHex(s, 0xFF, reg) || *s++ != '=')
+                    return false;
+                // Pairs of hex digits, so that one argument can fill a burst.
+                uint8_t values[SerRfalWire::SpiMaxSelect];
+                size_t n = 0;
+                while (isxdigit(static_cast<unsigned char>(s[0])) && isxdigit(static_cast<unsigned char>(s[1])) &&
+                       n < sizeof(values))
+                {
+                    char byte[3] = {s[0], s[1], '\0'};
+                    values[n++] = static_cast<uint8_t>(strtoul(byte, nullptr, 16));
+                    s += 2;
+                }
+                if (n == 0 || n > 0xFF)
+                    return false;
+                t.writeReg(static_cast<uint8_t>(reg), values, static_cast<uint8_t>(n));
+            }
+            else if (op == 'c')
+            {
+                if (!parseHex(s, 0xFF, reg))
+                    return false;
+                t.command(static_cast<uint8_t>(reg));
+            }
+            else
+                return false;
+            if (*s == '\0')
+                return t.valid();
+            if (*s++ != ',')
+                return false;
+        }
+    }
+
+    // One access path for both modes; direct mode is what tuning code does without the shadow.
+    class Regs
+    {
+    public:
+        explicit Regs(bool shadow)
+        {
+            if (shadow)
+                _shadow.emplace();
+        }
+
+        bool apply(const Op& op, ReturnCode* ret)
+        {
+            if (!op.change)
+                return _shadow ? _shadow->write(op.reg, &op.value, 1, ret)
+                               : serExecRfalChipWriteReg(ret, op.reg, const_cast<uint8_t*>(&op.value), 1);
+            return _shadow ? _shadow->changeBits(op.reg, op.mask, op.value, ret)
+                           : serExecRfalChipChangeRegBits(ret, op.reg, op.mask, op.value);
+        }
+
+        bool flush(ReturnCode* ret) { return _shadow ? _shadow->flush(ret) : true; }
+
+        bool read(uint16_t reg, uint8_t* values, uint8_t len, ReturnCode* ret)
+        {
+            if (_shadow)
+                return _shadow->read(reg, values, len, ret);
+            uint8_t* rsp = nullptr;
+            uint8_t got = 0;
+            if (!serExecRfalChipReadReg(ret, reg, len, &rsp, &got) || got != len)
+                return false;
+            memcpy(values, rsp, len);
+            return true;
+        }
+
+        const RegShadow* shadow() const { return _shadow ? &*_shadow : nullptr; }
+
+    private:
+        std::optional<RegShadow> _shadow;
+    };
+
+    // ret by reference: it is read after the call that sets it, whatever the argument order.
+    bool check(const char* what, bool ok, const ReturnCode& ret)
+    {
+        if (!ok)
+            fprintf(stderr, "%s: no response\n", what);
+        else if (ret != RFAL_ERR_NONE)
+            fprintf(stderr, "%s: ret %u\n", what, static_cast<unsigned>(ret));
+        return ok && ret == RFAL_ERR_NONE;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* comPort = "/dev/ttyACM0";
+    std::vector<Op> ops;
+    Sweep sweep = {};
+    bool sweeping = false;
+    int passes = 1;
+    bool shadow = true;
+    SpiTransaction script;
+    std::vector<ScriptRead> scriptReads;
+    bool scripted = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool ok = true;
+        if (strcmp(argv[i], "-n") == 0)
+            shadow = false;
+        else if (argv[i][0] != '-')
+            comPort = argv[i];
+        else if (i + 1 >= argc)
+            ok = false;
+        else if (strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "-c") == 0)
+        {
+            Op op;
+            ok = parseOp(argv[i + 1], argv[i][1] == 'c', op);
+            ops.push_back(op);
+            i++;
+        }
+        else if (strcmp(argv[i], "-s") == 0)
+            ok = sweeping = parseSweep(argv[++i], sweep);
+        else if (strcmp(argv[i], "-x") == 0)
+            ok = scripted = parseScript(argv[++i], script, scriptReads);
+        else if (strcmp(argv[i], "-p") == 0)
+            ok = (passes = atoi(argv[++i])) > 0;
+        else
+            ok = false;
+        if (!ok)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    int32_t error = 0;
+    if (!serComOpen(comPort, error))
+    {
+        fprintf(stderr, "cannot open %s: %s\n", comPort, strerror(error));
+        return 1;
+    }
+    serSetTraceMode(0);
+
+    Regs regs(shadow);
+    serLinkStats before;
+    serGetLinkStats(before, true);
+    uint64_t t0 = nowUs();
+    ReturnCode ret = RFAL_ERR_NONE;
+    bool ok = true;
+
+    for (int pass = 0; pass < passes && ok; ++pass)
+    {
+        for (const Op& op : ops)
+        {
+            ok = check("write", regs.apply(op, &ret), ret);
+            if (!ok)
+                break;
+        }
+    }
+
+    if (ok && sweeping)
+    {
+        for (unsigned v = sweep.first; v <= sweep.last && ok; ++v)
+        {
+            Op op = {sweep.reg, sweep.mask, static_cast<uint8_t>(v), true};
+            uint8_t amplitude = 0;
+            // The setting has to be on the chip before it is measured.
+            ok = check("sweep", regs.apply(op, &ret), ret) && check("flush", regs.flush(&ret), ret) &&
+                 check("measure", serExecRfalChipMeasureAmplitude(&ret, &amplitude), ret);
+            if (ok)
+                printf("reg %02X bits %02X = %02X: amplitude %u\n", sweep.reg, sweep.mask, v & sweep.mask, amplitude);
+        }
+    }
+
+    uint8_t dump[RegShadow::RegCount];
+    ok = ok && check("flush", regs.flush(&ret), ret) && check("read", regs.read(0, dump, sizeof(dump), &ret), ret);
+    uint64_t elapsedUs = nowUs() - t0;
+    if (ok)
+    {
+        for (size_t row = 0; row < sizeof(dump); row += 16)
+        {
+            printf("%02zX:", row);
+            for (size_t i = 0; i < 16; ++i)
+                printf(" %02X", dump[row + i]);
+            printf("\n");
+        }
+    }
+
+    if (ok && scripted)
+    {
+        serLinkStats mark;
+        serGetLinkStats(mark);
+        uint64_t t1 = nowUs();
+        ok = check("script", script.run(&ret), ret);
+        if (ok)
+        {
+            serLinkStats after;
+            serGetLinkStats(after);
+            for (const ScriptRead& r : scriptReads)
+            {
+                printf("spi %02X:", r.reg);
+                for (uint8_t i = 0; i < r.len; ++i)
+                    printf(" %02X", script.value(r.read, i));
+                printf("\n");
+            }
+            printf("spi: %zu operations, %zu chip selects, %u exchanges, %.1f ms\n", script.operations(),
+                   script.chipSelects(), after.exchanges - mark.exchanges, (nowUs() - t1) / 1000.0);
+        }
+    }
+
+    serLinkStats stats;
+    serGetLinkStats(stats);
+    printf("%s: %u exchanges, %u failures, %.1f ms\n", shadow ? "shadow" : "direct", stats.exchanges, stats.failures,
+           elapsedUs / 1000.0);
+    if (const RegShadow* s = regs.shadow())
+    {
+        const RegShadow::Stats& st = s->stats();
+        printf("shadow: hits %llu misses %llu elided %llu merged %llu written %llu invalidations %llu (%s)\n",
+               static_cast<unsigned long long>(st.hits), static_cast<unsigned long long>(st.misses),
+               static_cast<unsigned long long>(st.elided), static_cast<unsigned long long>(st.merged),
+               static_cast<unsigned long long>(st.written), static_cast<unsigned long long>(st.invalidations),
+               s->spiWrites() ? "SysSpiTxRx" : "rfalChipWriteReg");
+    }
+    serComClose(error);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+// Follows the gateway's shared-memory event ring (ShmEventRing.h) as one more independent consumer
+// and prints each event, with its publish-to-read latency on request. With -g it is the producer
+// instead: it publishes synthetic events, so consumers can be measured without readers attached.
+//
+//   st25-shm-tail [-n name] [-o] [-s] [-l]
+//   st25-shm-tail [-n name] -g count [-i intervalUs] [-c capacity]
+//
+// -n ring name (default st25-gateway), -o start at the oldest event still in the ring, -s spin on
+// the ring instead of sleeping on its futex, -l print latency and a summary on exit. When the
+// producer exits, the ring is reopened once a new one appears. -g publishes count events every
+// -i µs (default 1000) into a ring of -c slots (default 4096).
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "ShmEventRing.h"
+
+using namespace ShmEventRing;
+
+namespace
+{
+    struct Options
+    {
+        std::string name = "st25-gateway";
+        bool oldest = false;
+        bool spin = false;
+        bool latency = false;
+        uint64_t generate = 0;
+        uint32_t intervalUs = 1000;
+        uint32_t capacity = 4096;
+    };
+
+    volatile sig_atomic_t gStop = 0;
+
+    void onSignal(int)
+    {
+        gStop = 1;
+    }
+
+    void usage()
+    {
+        fprintf(stderr, "usage: st25-shm-tail [-n name] [-o] [-s] [-l]\n"
+                        "       st25-shm-tail [-n name] -g count [-i intervalUs] [-c capacity]\n");
+    }
+
+    const char* kindName(uint8_t kind)
+    {
+        switch (static_cast<Kind>(kind))
+        {
+            case Kind::Placed: return "placed";
+            case Kind::Removed: return "removed";
+            case Kind::TagData: return "data";
+            default: return "?";
+        }
+    }
+
+    void printEvent(const Event& e, const std::string& reader, int64_t latencyNs, bool latency)
+    {
+        static const char* techs[] = {"A", "B", "F", "V", "TB"};
+        printf("%s %s %s:", kindName(e.kind), reader.c_str(), e.tech < 5 ? techs[e.tech] : "?");
+        for (uint8_t i = 0; i < e.uidLen && i < sizeof(e.uid); ++i)
+            printf("%02X", e.uid[i]);
+        printf(" ts=%llu", static_cast<unsigned long long>(e.timeNs / 1000000));
+        if (static_cast<Kind>(e.kind) == Kind::Removed)
+            printf(" dwellMs=%u", e.dwellMs);
+        if (e.dataLen)
+        {
+            printf(" data=");
+            for (uint8_t i = 0; i < e.dataLen && i < sizeof(e.data); ++i)
+                printf("%02X", e.data[i]);
+        }
+        if (latency)
+            printf(" latencyUs=%.2f", latencyNs / 1000.0);
+        printf("\n");
+    }
+
+    int generate(const Options& opt)
+    {
+        Producer ring;
+        int error = 0;
+        if (!ring.create(opt.name.c_str(), opt.capacity, error))
+        {
+            fprintf(stderr, "/dev/shm/%s: %s\n", opt.name.c_str(), strerror(error));
+            return 1;
+        }
+        uint16_t reader = ring.readerIndex("st25-shm-tail");
+        Event e = {};
+        e.reader = reader;
+        e.tech = 3;
+        e.uidLen = 8;
+        const uint8_t uid[8] = {0xE0, 0x04, 0x01, 0x50, 0x00, 0x00, 0x00, 0x00};
+        memcpy(e.uid, uid, sizeof(uid));
+        timespec interval = {static_cast<time_t>(opt.intervalUs / 1000000),
+                             static_cast<long>(opt.intervalUs % 1000000) * 1000};
+        for (uint64_t n = 0; n < opt.generate && !gStop; ++n)
+        {
+            e.kind = static_cast<uint8_t>(n % 2 ? Kind::Removed : Kind::Placed);
+            e.uid[7] = static_cast<uint8_t>(n / 2);
+            e.dwellMs = n % 2 ? opt.intervalUs / 1000 : 0;
+            e.timeNs = realtimeNs();
+            ring.publish(e);
+            if (opt.intervalUs)
+                nanosleep(&interval, nullptr);
+        }
+        // Keep the ring for a moment so consumers can drain the tail before it is unlinked.
+        timespec linger = {1, 0};
+        nanosleep(&linger, nullptr);
+        fprintf(stderr, "published %llu events\n", static_cast<unsigned long long>(ring.published()));
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasArg = i + 1 < argc;
+        if (strcmp(argv[i], "-n") == 0 && hasArg)
+            opt.name = argv[++i];
+        else if (strcmp(argv[i], "-o") == 0)
+            opt.oldest = true;
+        else if (strcmp(argv[i], "-s") == 0)
+            opt.spin = true;
+        else if (strcmp(argv[i], "-l") == 0)
+            opt.latency = true;
+        else if (strcmp(argv[i], "-g") == 0 && hasArg)
+            opt.generate = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "-i") == 0 && hasArg)
+            opt.intervalUs = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (strcmp(argv[i], "-c") == 0 && hasArg)
+            opt.capacity = static_cast<uint32_t>(atoi(argv[++i]));
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    if (opt.generate)
+        return generate(opt);
+
+    Consumer ring;
+    int error = 0;
+    if (!ring.open(opt.name.c_str(), error, opt.oldest))
+    {
+        fprintf(stderr, "/dev/shm/%s: %s\n", opt.name.c_str(), strerror(error));
+        return 1;
+    }
+
+    std::vector<int64_t> latencies;
+    uint64_t events = 0;
+    Event e;
+    while (!gStop)
+    {
+        if (!ring.next(e))
+        {
+            if (!opt.spin && !ring.wait(200) && !ring.producerAlive())
+            {
+                // A restarted gateway starts a new ring; follow it from its first event.
+                timespec retry = {0, 200000000};
+                while (!gStop && !ring.open(opt.name.c_str(), error, true))
+                    nanosleep(&retry, nullptr);
+            }
+            continue;
+        }
+        int64_t latencyNs = static_cast<int64_t>(realtimeNs() - e.timeNs);
+        events++;
+        if (opt.latency)
+            latencies.push_back(latencyNs);
+        printEvent(e, ring.readerName(e.reader), latencyNs, opt.latency);
+        fflush(stdout);
+    }
+
+    fprintf(stderr, "events=%llu lost=%llu", static_cast<unsigned long long>(events),
+            static_cast<unsigned long long>(ring.lost()));
+    if (!latencies.empty())
+    {
+        std::sort(latencies.begin(), latencies.end());
+        fprintf(stderr, " latencyUs min=%.2f p50=%.2f p99=%.2f max=%.2f", latencies.front() / 1000.0,
+                latencies[latencies.size() / 2] / 1000.0, latencies[latencies.size() * 99 / 100] / 1000.0,
+                latencies.back() / 1000.0);
+    }
+    fprintf(stderr, "\n");
+    return 0;
+}
@@ -0,0 +1,106 @@
+// Work-stealing thread pool; see WorkPool.h.
+
+#include "WorkPool.h"
+
+namespace
+{
+    // Which pool and worker the current thread belongs to, so nested submits stay local.
+    thread_local const WorkPool* tPool = nullptr;
+    thread_local unsigned tWorker = 0;
+}
+
+WorkPool::WorkPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+    for (unsigned i = 0; i < threads; ++i)
+        _workers.push_back(std::make_unique<Worker>());
+    for (unsigned i = 0; i < threads; ++i)
+        _workers[i]->thread = std::thread([this, i] { loop(i); });
+}
+
+WorkPool::~WorkPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_idleLock);
+        _stop = true;
+    }
+    // Queued jobs are dropped: shutdown waits only for the ones already running.
+    for (auto& w : _workers)
+    {
+        std::lock_guard<std::mutex> lock(w->lock);
+        _queued.fetch_sub(w->jobs.size(), std::memory_order_relaxed);
+        w->jobs.clear();
+    }
+    _idle.notify_all();
+    for (auto& w : _workers)
+        w->thread.join();
+}
+
+void WorkPool::submit(std::function<void()> job)
+{
+    unsigned index = tPool == this ? tWorker
+                                   : _nextWorker.fetch_add(1, std::memory_order_relaxed) % _workers.size();
+    // Counted before it is visible, so a worker that takes it never sees the count at zero.
+    _queued.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(_workers[index]->lock);
+        _workers[index]->jobs.push_back(std::move(job));
+    }
+    // Taking the idle lock orders this against a worker between its check and its wait.
+    {
+        std::lock_guard<std::mutex> lock(_idleLock);
+    }
+    _idle.notify_one();
+}
+
+bool WorkPool::take(unsigned index, std::function<void()>& job)
+{
+    {
+        Worker& own = *_workers[index];
+        std::lock_guard<std::mutex> lock(own.lock);
+        if (!own.jobs.empty())
+        {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+    for (size_t k = 1; k < _workers.size(); ++k)
+    {
+        Worker& victim = *_workers[(index + k) % _workers.size()];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (!victim.jobs.empty())
+        {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            _stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkPool::loop(unsigned index)
+{
+    tPool = this;
+    tWorker = index;
+    std::function<void()> job;
+    for (;;)
+    {
+        if (take(index, job))
+        {
+            _queued.fetch_sub(1, std::memory_order_relaxed);
+            job();
+            job = nullptr;
+            _executed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(_idleLock);
+        _idle.wait(lock, [this] { return _stop || _queued.load(std::memory_order_acquire) > 0; });
+        if (_stop)
+            return;
+    }
+}
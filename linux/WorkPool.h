@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool for jobs that must stay off a Reactor thread: blocking backend calls
+// and CPU-heavy checks. Each worker owns a deque and runs its own jobs newest first, so a job
+// submitted from inside a job runs next on the same core; a worker that runs dry steals the oldest
+// job of another. Jobs submitted from other threads are spread round-robin. A job hands its result
+// back to the loop with Reactor::post().
+class WorkPool
+{
+public:
+    // threads 0: one per core.
+    explicit WorkPool(unsigned threads = 0);
+    // Drops the jobs still queued, waits for the running ones, then joins the workers.
+    ~WorkPool();
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator=(const WorkPool&) = delete;
+
+    void submit(std::function<void()> job);
+
+    unsigned threads() const { return static_cast<unsigned>(_workers.size()); }
+    size_t queued() const { return _queued.load(std::memory_order_relaxed); }
+    uint64_t executed() const { return _executed.load(std::memory_order_relaxed); }
+    uint64_t stolen() const { return _stolen.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker
+    {
+        std::mutex lock;
+        std::deque<std::function<void()>> jobs;
+        std::thread thread;
+    };
+
+    void loop(unsigned index);
+    bool take(unsigned index, std::function<void()>& job);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::mutex _idleLock;
+    std::condition_variable _idle;
+    std::atomic<size_t> _queued{0}; // in some deque, not yet taken
+    std::atomic<unsigned> _nextWorker{0};
+    std::atomic<uint64_t> _executed{0};
+    std::atomic<uint64_t> _stolen{0};
+    bool _stop = false; // guarded by _idleLock
+};